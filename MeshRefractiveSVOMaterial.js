@@ -16,12 +16,11 @@ export class MeshRefractiveSVOMaterial extends MeshRefractiveMaterial
             defs["CONTOURING_AVERAGE_NORMALS"] = 1;
         else if(svo.method === ContouringMethod.DualContouring)
             defs["CONTOURING_DUAL_CONTOURING"] = 1;
+        if(svo.splitStreams)
+            defs["SVO_SPLIT_STREAMS"] = 1;
         super(defs, materialParameters);
-        this.uniforms.svoMin = {value: null};
-        this.uniforms.svoMax = {value: null};
-        this.uniforms.svoDepth = {value: null};
-        this.uniforms.svoData = {value: null};
-        this.uniforms.svoTexSize = {value: null};
+        for(const key in svo.getUniforms())
+            this.uniforms[key] = {value: null};
         this.setSVO(svo);
     }
 
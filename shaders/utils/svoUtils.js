@@ -3,14 +3,22 @@ export const svoUtilsGLSL = {name: "svoUtils", code: `
 #else
 #define USE_SVO
 #define MAX_DEPTH 23
-#define STACK_SZ 8
+// One parent per level; constructSVO builds at most 21 levels below the root.
+#define STACK_SZ 22
 #include <primitiveIntersections>
 
 uniform vec3 svoMin;
 uniform vec3 svoMax;
 uniform int svoDepth;
 uniform highp ivec2 svoTexSize;
+#ifdef SVO_SPLIT_STREAMS
+// Topology words and attribute words from constructSVOStreams, one R32UI texel each.
+uniform highp usampler2D svoTopology;
+uniform highp usampler2D svoAttributes;
+uniform highp ivec2 svoAttributeTexSize;
+#else
 uniform sampler2D svoData;
+#endif
 
 struct ChildDescriptor
 {
@@ -19,8 +27,64 @@ struct ChildDescriptor
     int isLeaf;
     vec3 normal;
     int childOffset;
+#ifdef SVO_SPLIT_STREAMS
+    int attributeIndex;
+#endif
 };
 
+#ifdef SVO_SPLIT_STREAMS
+uint get_topology(int index)
+{
+    return texelFetch(svoTopology, ivec2(index % svoTexSize.x, index / svoTexSize.x), 0).r;
+}
+
+// Only the topology word is read here; the attribute of a leaf is fetched once by
+// get_attribute when the traversal stops on it.
+ChildDescriptor get_cd(int index)
+{
+    uint word = get_topology(index);
+    ChildDescriptor res;
+    res.index = index;
+    res.isLeaf = int((word >> 8u) & 1u);
+    res.normal = vec3(0.0);
+    if(res.isLeaf == 1)
+    {
+        res.childMask = 0;
+        res.childOffset = 0;
+        res.attributeIndex = int((word & 0xFFu) | ((word >> 9u) << 8u));
+        return res;
+    }
+    res.childMask = int(word & 0xFFu);
+    res.childOffset = int((word >> 9u) & 0x3FFFFFu);
+    res.attributeIndex = -1;
+    if((word >> 31u) == 1u)
+    {
+        res.childOffset = int(get_topology(index + res.childOffset)) - index;
+    }
+    return res;
+}
+
+// Octahedral normal for average normals, for dual contouring the vertex inside the leaf
+// cube [cubeMin, cubeMin + cubeSize] in the same space as the cube.
+vec3 get_attribute(ChildDescriptor cd, vec3 cubeMin, float cubeSize)
+{
+    int index = cd.attributeIndex;
+    uint packed = texelFetch(svoAttributes, ivec2(index % svoAttributeTexSize.x, index / svoAttributeTexSize.x), 0).r;
+#ifdef CONTOURING_DUAL_CONTOURING
+    vec3 relative = vec3(float(packed & 0x7FFu) / 2047.0, float((packed >> 11u) & 0x7FFu) / 2047.0, float(packed >> 22u) / 1023.0);
+    return cubeMin + relative * cubeSize;
+#else
+    vec2 oct = vec2(float((packed >> 1u) & 0x7FFFu), float((packed >> 16u) & 0x7FFFu)) / 32767.0 * 2.0 - 1.0;
+    vec3 n = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+    if(n.z < 0.0)
+    {
+        vec2 signs = vec2(n.x < 0.0 ? -1.0 : 1.0, n.y < 0.0 ? -1.0 : 1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+#endif
+}
+#else
 ChildDescriptor get_cd(int index)
 {
     vec4 cd = texelFetch(svoData, ivec2(index % svoTexSize.x, index / svoTexSize.x), 0);
@@ -29,13 +93,21 @@ ChildDescriptor get_cd(int index)
     res.index = index;
     res.childMask = cdx & 0xFF;
     res.isLeaf = (cdx >> 8) & 0x1;
-    res.childOffset = (cdx >> 9) & 0x7FFFFF;
+    res.childOffset = (cdx >> 9) & 0x3FFFFF;
+    if(cdx < 0)
+    {
+        // Far pointer: the offset leads to a slot holding the absolute index of the first child.
+        int slot = index + res.childOffset;
+        vec4 far = texelFetch(svoData, ivec2(slot % svoTexSize.x, slot / svoTexSize.x), 0);
+        res.childOffset = floatBitsToInt(far.x) - index;
+    }
     float normalX = cd.y;
     float normalY = cd.z;
     float normalZ = cd.w;
     res.normal = vec3(normalX, normalY, normalZ);
     return res;
 }
+#endif
 
 ChildDescriptor get_child_of(ChildDescriptor cd, int childIdx)
 {
@@ -295,7 +367,11 @@ intersectionResult castRay(ray r)
     // Output results.
     res.t = t_min + scale_exp2 * 0.5;
     res.point = r.origin + r.direction * t_min;
+#ifdef SVO_SPLIT_STREAMS
+    res.normal = cd.isLeaf == 1 ? get_attribute(cd, pos, scale_exp2) : vec3(0.0);
+#else
     res.normal = cd.normal;
+#endif
     return res;
 }
 
@@ -329,6 +405,9 @@ intersectionResult rayCast(vec3 rayOrigin, vec3 rayDir, float tMin, float tMax)
     {
         insres.point = svoCenter + (insres.point - vec3(1.5, 1.5, 1.5)) * scale;
         insres.t = distance(insres.point, rayOrigin);
+#if defined(SVO_SPLIT_STREAMS) && defined(CONTOURING_DUAL_CONTOURING)
+        insres.normal = svoCenter + (insres.normal - vec3(1.5, 1.5, 1.5)) * scale;
+#endif
     }
     return insres;
 }
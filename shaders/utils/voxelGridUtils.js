@@ -123,6 +123,23 @@ vec3 getVoxelDualContourPos(int x, int y, int z)
     return data.xyz;
 }
 
+// Decodes a voxel packed by constructCompactVoxelGrid: bit 0 is the filled flag,
+// followed by the octahedral x and y coordinates with bitsPerAxis bits each.
+int decodeOctahedralVoxel(uint packed, int bitsPerAxis, out vec3 normal)
+{
+    float maxValue = float((1u << uint(bitsPerAxis)) - 1u);
+    uint axisMask = (1u << uint(bitsPerAxis)) - 1u;
+    vec2 oct = vec2(float((packed >> 1u) & axisMask), float((packed >> uint(1 + bitsPerAxis)) & axisMask)) / maxValue * 2.0 - 1.0;
+    vec3 n = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+    if(n.z < 0.0)
+    {
+        vec2 signs = vec2(n.x < 0.0 ? -1.0 : 1.0, n.y < 0.0 ? -1.0 : 1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    normal = normalize(n);
+    return int(packed & 1u);
+}
+
 intersectionResult dualContouringIntersect(vec3 rayOrigin, vec3 rayDir, int edgeMask, ivec3 coords, float tMin, float tMax)
 {
     intersectionResult closestRes;
@@ -4,6 +4,7 @@ import * as THREE from 'three';
 
 let bvhWASM = null;
 let constructBVH = null;
+let castRaysBVH = null;
 
 /**
  * @returns {Promise<void>}
@@ -13,8 +14,13 @@ const loadBVHModule = async () => {
         return await Promise.resolve();
     bvhWASM = await bvhModule();
     constructBVH = bvhWASM.cwrap('constructLinearBVH', 'number', ['number', 'number', 'number']);
+    // bvh.wasm builds from before castRaysBVH lack it; BVH.castRays then traverses in JS.
+    castRaysBVH = bvhWASM['_castRaysBVH'] ? bvhWASM.cwrap('castRaysBVH', 'number', ['number', 'number', 'number', 'number']) : null;
 }
 
+// Vec3::invApproximate of mathutils.h for one component.
+const invApproximate = (v) => 1 / (Math.abs(v) <= 0.0001 ? (v < 0 ? -0.0001 : 0.0001) : v);
+
 export class BVH
 {
     constructor()
@@ -164,6 +170,158 @@ export class BVH
         bvhWASM._free(bvhLoc);
     }
 
+    /**
+     * CPU reference ray casts through the BVH, for comparing traversal costs with the kd-tree.
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, triangle: Int32Array, normals: Float32Array, nodesPerRay: number, triangleTestsPerRay: number}>} t and triangle are -1 on a miss, triangle indexes primData
+     */
+    async castRays(rays)
+    {
+        await loadBVHModule();
+        if(!castRaysBVH)
+            return this.castRaysJS(rays);
+        const rayCount = rays.length / 6;
+        const bvhLoc = bvhWASM._malloc((2 + this.linearData.length + this.boundsData.length + this.primData.length) * 4);
+        const fpointer = bvhLoc >> 2;
+        bvhWASM.HEAP32[fpointer] = this.linearData.length / 2;
+        bvhWASM.HEAP32[fpointer + 1] = this.primData.length / 9;
+        bvhWASM.HEAPF32.set(this.linearData, fpointer + 2);
+        bvhWASM.HEAPF32.set(this.boundsData, fpointer + 2 + this.linearData.length);
+        bvhWASM.HEAPF32.set(this.primData, fpointer + 2 + this.linearData.length + this.boundsData.length);
+        const rayLoc = bvhWASM._malloc(rays.length * 4);
+        bvhWASM.HEAPF32.set(rays, rayLoc >> 2);
+        const statsLoc = bvhWASM._malloc(8);
+        const dataLoc = castRaysBVH(bvhLoc, rayLoc, rayCount, statsLoc);
+        const t = new Float32Array(rayCount);
+        const triangle = new Int32Array(rayCount);
+        const normals = new Float32Array(rayCount * 3);
+        for(let i = 0; i < rayCount; i++)
+        {
+            const pointer = (dataLoc >> 2) + i * 5;
+            t[i] = bvhWASM.HEAPF32[pointer];
+            triangle[i] = bvhWASM.HEAP32[pointer + 1];
+            normals.set(bvhWASM.HEAPF32.subarray(pointer + 2, pointer + 5), i * 3);
+        }
+        const nodesPerRay = bvhWASM.HEAPF32[statsLoc >> 2];
+        const triangleTestsPerRay = bvhWASM.HEAPF32[(statsLoc >> 2) + 1];
+        bvhWASM._free(bvhLoc);
+        bvhWASM._free(rayLoc);
+        bvhWASM._free(statsLoc);
+        bvhWASM._free(dataLoc);
+        return {t, triangle, normals, nodesPerRay, triangleTestsPerRay};
+    }
+
+    /**
+     * castRays in JS, the same traversal as castRaysBVH in bvh.cpp for builds without it.
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {{t: Float32Array, triangle: Int32Array, normals: Float32Array, nodesPerRay: number, triangleTestsPerRay: number}}
+     */
+    castRaysJS(rays)
+    {
+        const rayCount = rays.length / 6;
+        const nodes = new Int32Array(this.linearData.buffer, this.linearData.byteOffset, this.linearData.length);
+        const bounds = this.boundsData;
+        const prims = this.primData;
+        const t = new Float32Array(rayCount).fill(-1);
+        const triangle = new Int32Array(rayCount).fill(-1);
+        const normals = new Float32Array(rayCount * 3);
+        const origin = [0, 0, 0], direction = [0, 0, 0], invDir = [0, 0, 0];
+        const stack = [];
+        let visitedNodes = 0;
+        let triangleTests = 0;
+        for(let r = 0; r < rayCount; r++)
+        {
+            for(let a = 0; a < 3; a++)
+            {
+                origin[a] = rays[r * 6 + a];
+                direction[a] = rays[r * 6 + 3 + a];
+                invDir[a] = invApproximate(direction[a]);
+            }
+            let bestT = Infinity;
+            stack.length = 0;
+            stack.push(0);
+            while(stack.length > 0)
+            {
+                const node = stack.pop();
+                visitedNodes++;
+                let tmin = 0, tmax = bestT;
+                for(let a = 0; a < 3; a++)
+                {
+                    const near = invDir[a] < 0 ? bounds[node * 6 + 3 + a] : bounds[node * 6 + a];
+                    const far = invDir[a] < 0 ? bounds[node * 6 + a] : bounds[node * 6 + 3 + a];
+                    tmin = Math.max(tmin, (near - origin[a]) * invDir[a]);
+                    tmax = Math.min(tmax, (far - origin[a]) * invDir[a]);
+                }
+                if(tmin > tmax)
+                    continue;
+                const nPrims = nodes[node * 2 + 1] >> 2;
+                const splitAxis = nodes[node * 2 + 1] & 0x3;
+                if(nPrims > 0)
+                {
+                    const primOffset = nodes[node * 2];
+                    for(let i = primOffset; i < primOffset + nPrims; i++)
+                    {
+                        triangleTests++;
+                        const hitT = this.intersectTriangle(prims, i, origin, direction, bestT, normals, r * 3);
+                        if(hitT < 0)
+                            continue;
+                        bestT = hitT;
+                        t[r] = hitT;
+                        triangle[r] = i;
+                    }
+                    continue;
+                }
+                // Visit the child on the side the ray comes from first.
+                const secondChild = nodes[node * 2];
+                if(direction[splitAxis] < 0)
+                    stack.push(node + 1, secondChild);
+                else
+                    stack.push(secondChild, node + 1);
+            }
+        }
+        return {
+            t, triangle, normals,
+            nodesPerRay: rayCount > 0 ? visitedNodes / rayCount : 0,
+            triangleTestsPerRay: rayCount > 0 ? triangleTests / rayCount : 0
+        };
+    }
+
+    /**
+     * Triangle::intersectRay of mathutils.h on triangle i of prims. Writes the normal of a hit
+     * to normals at normalOffset.
+     * @returns {number} t of the hit, or -1 when it misses or lies beyond tMax
+     */
+    intersectTriangle(prims, i, origin, direction, tMax, normals, normalOffset)
+    {
+        const v = i * 9;
+        const e1x = prims[v + 6] - prims[v], e1y = prims[v + 7] - prims[v + 1], e1z = prims[v + 8] - prims[v + 2];
+        const e2x = prims[v + 3] - prims[v], e2y = prims[v + 4] - prims[v + 1], e2z = prims[v + 5] - prims[v + 2];
+        const px = direction[1] * e2z - direction[2] * e2y;
+        const py = direction[2] * e2x - direction[0] * e2z;
+        const pz = direction[0] * e2y - direction[1] * e2x;
+        const det = e1x * px + e1y * py + e1z * pz;
+        if(det > -0.0001 && det < 0.0001)
+            return -1;
+        const invDet = 1 / det;
+        const tx = origin[0] - prims[v], ty = origin[1] - prims[v + 1], tz = origin[2] - prims[v + 2];
+        const u = (tx * px + ty * py + tz * pz) * invDet;
+        if(u < 0 || u > 1)
+            return -1;
+        const qx = ty * e1z - tz * e1y, qy = tz * e1x - tx * e1z, qz = tx * e1y - ty * e1x;
+        const w = (direction[0] * qx + direction[1] * qy + direction[2] * qz) * invDet;
+        if(w < 0 || u + w > 1)
+            return -1;
+        const hitT = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+        if(hitT < 0 || hitT > tMax)
+            return -1;
+        const nx = e1y * e2z - e1z * e2y, ny = e1z * e2x - e1x * e2z, nz = e1x * e2y - e1y * e2x;
+        const length = Math.hypot(nx, ny, nz);
+        normals[normalOffset] = nx / length;
+        normals[normalOffset + 1] = ny / length;
+        normals[normalOffset + 2] = nz / length;
+        return hitT;
+    }
+
     /**
      * @returns {Blob}
      */
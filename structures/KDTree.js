@@ -0,0 +1,117 @@
+let kdtreeWASM = null;
+let constructKDTree = null;
+let castRaysKDTree = null;
+
+/**
+ * Imports kdtree.js on first use, so this module loads even where it has not been built.
+ * @returns {Promise<void>}
+ */
+const loadKDTreeModule = async () => {
+    if(kdtreeWASM)
+        return await Promise.resolve();
+    let kdtreeModule;
+    try
+    {
+        kdtreeModule = (await import("../wasm/kdtree/kdtree")).default;
+    }
+    catch(error)
+    {
+        throw new Error('wasm/kdtree/kdtree.js could not be loaded, build it with the kdtree command in wasm/emscriptencommand.txt', {cause: error});
+    }
+    kdtreeWASM = await kdtreeModule();
+    constructKDTree = kdtreeWASM.cwrap('constructKDTree', 'number', ['number', 'number', 'number']);
+    castRaysKDTree = kdtreeWASM.cwrap('castRaysKDTree', 'number', ['number', 'number', 'number', 'number', 'number']);
+}
+
+/**
+ * SAH kd-tree over a triangle soup, for comparing ray traversal costs with the BVH. Nodes
+ * are two uints each: the split position as float bits (or the leaf's triangle / index
+ * offset) and the split axis (3 for leaves) in the low two bits of the right child index
+ * or leaf triangle count. The left child follows its parent.
+ */
+export class KDTree
+{
+    constructor()
+    {
+        /** @type {Float32Array} */
+        this.bounds = null;
+        /** @type {Uint32Array} */
+        this.nodes = null;
+        /** @type {Uint32Array} */
+        this.indices = null;
+    }
+
+    /**
+     * @param {Float32Array} triarr
+     * @param {number} [maxDepth=0] maxDepth, 0 to pick it from the triangle count
+     */
+    async construct(triarr, maxDepth = 0)
+    {
+        await loadKDTreeModule();
+        const triLoc = kdtreeWASM._malloc(triarr.length * 4);
+        kdtreeWASM.HEAPF32.set(triarr, triLoc >> 2);
+        const treeLoc = constructKDTree(triLoc, triarr.length / 9, maxDepth);
+        kdtreeWASM._free(triLoc);
+        if(treeLoc === 0)
+        {
+            throw new Error(`KD-tree of ${triarr.length / 9} triangles could not be built, see the console for details`);
+        }
+        const fpointer = treeLoc >> 2;
+        const nodeCount = kdtreeWASM.HEAP32[fpointer + 6];
+        const indexCount = kdtreeWASM.HEAP32[fpointer + 7];
+        const nodesEnd = fpointer + 8 + nodeCount * 2;
+        this.bounds = kdtreeWASM.HEAPF32.slice(fpointer, fpointer + 6);
+        this.nodes = kdtreeWASM.HEAPU32.slice(fpointer + 8, nodesEnd);
+        this.indices = kdtreeWASM.HEAPU32.slice(nodesEnd, nodesEnd + indexCount);
+        kdtreeWASM._free(treeLoc);
+    }
+
+    /**
+     * CPU reference ray casts through the tree.
+     * @param {Float32Array} triarr the triangles the tree was built from
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, triangle: Int32Array, normals: Float32Array, nodesPerRay: number, triangleTestsPerRay: number}>} t and triangle are -1 on a miss
+     */
+    async castRays(triarr, rays)
+    {
+        await loadKDTreeModule();
+        const rayCount = rays.length / 6;
+        const treeLoc = kdtreeWASM._malloc((8 + this.nodes.length + this.indices.length) * 4);
+        kdtreeWASM.HEAPF32.set(this.bounds, treeLoc >> 2);
+        kdtreeWASM.HEAP32[(treeLoc >> 2) + 6] = this.nodes.length / 2;
+        kdtreeWASM.HEAP32[(treeLoc >> 2) + 7] = this.indices.length;
+        kdtreeWASM.HEAPU32.set(this.nodes, (treeLoc >> 2) + 8);
+        kdtreeWASM.HEAPU32.set(this.indices, (treeLoc >> 2) + 8 + this.nodes.length);
+        const triLoc = kdtreeWASM._malloc(triarr.length * 4);
+        kdtreeWASM.HEAPF32.set(triarr, triLoc >> 2);
+        const rayLoc = kdtreeWASM._malloc(rays.length * 4);
+        kdtreeWASM.HEAPF32.set(rays, rayLoc >> 2);
+        const statsLoc = kdtreeWASM._malloc(8);
+        const dataLoc = castRaysKDTree(treeLoc, triLoc, rayLoc, rayCount, statsLoc);
+        const t = new Float32Array(rayCount);
+        const triangle = new Int32Array(rayCount);
+        const normals = new Float32Array(rayCount * 3);
+        for(let i = 0; i < rayCount; i++)
+        {
+            const pointer = (dataLoc >> 2) + i * 5;
+            t[i] = kdtreeWASM.HEAPF32[pointer];
+            triangle[i] = kdtreeWASM.HEAP32[pointer + 1];
+            normals.set(kdtreeWASM.HEAPF32.subarray(pointer + 2, pointer + 5), i * 3);
+        }
+        const nodesPerRay = kdtreeWASM.HEAPF32[statsLoc >> 2];
+        const triangleTestsPerRay = kdtreeWASM.HEAPF32[(statsLoc >> 2) + 1];
+        kdtreeWASM._free(treeLoc);
+        kdtreeWASM._free(triLoc);
+        kdtreeWASM._free(rayLoc);
+        kdtreeWASM._free(statsLoc);
+        kdtreeWASM._free(dataLoc);
+        return {t, triangle, normals, nodesPerRay, triangleTestsPerRay};
+    }
+
+    dispose()
+    {
+        this.bounds = null;
+        this.nodes = null;
+        this.indices = null;
+    }
+}
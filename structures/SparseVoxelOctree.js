@@ -9,6 +9,11 @@ import { VoxelUtils } from './VoxelUtilsCPP';
 let voxelGridWASM = null;
 let constructVoxelGrid = null;
 
+// Nodes of progressive refinement per call and milliseconds of it per task, so refining
+// a deep level never blocks the main thread for long.
+const PROGRESSIVE_STEP_NODES = 4096;
+const PROGRESSIVE_TASK_MS = 8;
+
 /**
  * @returns {Promise<void>}
  */
@@ -60,6 +65,15 @@ export class SparseVoxelOctree
         this.svoDataTexture = null;
         /** @type {[number, number]} */
         this.svoDataTextureSize = [0,0];
+
+        /** Set by constructStreams: the topology and attributes live in separate R32UI textures. */
+        this.splitStreams = false;
+        /** @type {THREE.DataTexture} */
+        this.svoTopologyTexture = null;
+        /** @type {THREE.DataTexture} */
+        this.svoAttributeTexture = null;
+        /** @type {[number, number]} */
+        this.svoAttributeTextureSize = [0,0];
     }
 
     /**
@@ -99,6 +113,18 @@ export class SparseVoxelOctree
     /** @returns {{svoMin: THREE.Vector3, svoMax: THREE.Vector3, svoDepth: number, svoTexSize: [number, number], svoData: THREE.DataTexture}} */
     getUniforms()
     {
+        if(this.splitStreams)
+        {
+            return {
+                svoMin: this.gridMin,
+                svoMax: this.gridMax,
+                svoDepth: this.svoDepth,
+                svoTopology: this.svoTopologyTexture,
+                svoTexSize: this.svoDataTextureSize,
+                svoAttributes: this.svoAttributeTexture,
+                svoAttributeTexSize: this.svoAttributeTextureSize
+            };
+        }
         const data = {
             svoMin: this.gridMin,
             svoMax: this.gridMax,
@@ -139,19 +165,129 @@ export class SparseVoxelOctree
      * @param {THREE.Object3D} target
      * @param {number} svoDepth 
      * @param {ContouringMethod} [contouringMethod=ContouringMethod.AverageNormals] contouringMethod 
+     * @param {{maxNormalAngle: number, maxGeometricError: number, targetNodeCount?: number}} [simplification] see VoxelUtils.createSVO
      */
-    async construct(target, svoDepth, contouringMethod=ContouringMethod.AverageNormals)
+    async construct(target, svoDepth, contouringMethod=ContouringMethod.AverageNormals, simplification)
     {
         /** @type {ContouringMethod} */
         this.method = contouringMethod;
         const triarr = this.getObjectTriangles(target);
-        const svo = await VoxelUtils.createSVO(triarr, svoDepth, contouringMethod);
+        const svo = await VoxelUtils.createSVO(triarr, svoDepth, contouringMethod, simplification);
         this.gridMin = svo.min;
         this.gridMax = svo.max;
         this.svoDepth = svoDepth;
         this.createGridData(svo.voxelData, svo.nodeCount);
     }
 
+    /**
+     * Like construct, but keeps the nodes as a 4 byte topology stream with the normals (or
+     * dual contouring vertices) in a separate attribute stream, see VoxelUtils.createSVOStreams.
+     * @param {THREE.Object3D} target
+     * @param {number} svoDepth
+     * @param {ContouringMethod} [contouringMethod=ContouringMethod.AverageNormals] contouringMethod
+     */
+    async constructStreams(target, svoDepth, contouringMethod=ContouringMethod.AverageNormals)
+    {
+        /** @type {ContouringMethod} */
+        this.method = contouringMethod;
+        const triarr = this.getObjectTriangles(target);
+        const svo = await VoxelUtils.createSVOStreams(triarr, svoDepth, contouringMethod);
+        this.gridMin = svo.min;
+        this.gridMax = svo.max;
+        this.svoDepth = svoDepth;
+        this.splitStreams = true;
+        [this.svoTopologyTexture, this.svoDataTextureSize] = this.createWordTexture(svo.topology);
+        [this.svoAttributeTexture, this.svoAttributeTextureSize] = this.createWordTexture(svo.attributes);
+    }
+
+    /**
+     * Like construct, but returns as soon as the levels down to firstDepth are built and
+     * keeps refining afterwards in tasks of a few milliseconds. onLevel is called with this
+     * octree after every level, including the first, and must hand it to
+     * MeshRefractiveSVOMaterial.setSVO (or otherwise stop using the previous texture): the
+     * texture of the level before is disposed once it returns. refined resolves once
+     * svoDepth is reached and rejects with the first error of a refinement task; the
+     * native handle is released either way.
+     * @param {THREE.Object3D} target
+     * @param {number} svoDepth
+     * @param {ContouringMethod | undefined} contouringMethod undefined for average normals
+     * @param {number | undefined} firstDepth undefined for 5
+     * @param {(svo: SparseVoxelOctree) => void} onLevel
+     */
+    async constructProgressive(target, svoDepth, contouringMethod=ContouringMethod.AverageNormals, firstDepth=5, onLevel)
+    {
+        if(typeof onLevel !== 'function')
+            throw new Error('constructProgressive needs an onLevel callback that swaps in the new texture');
+        /** @type {ContouringMethod} */
+        this.method = contouringMethod;
+        const triarr = this.getObjectTriangles(target);
+        const handle = await VoxelUtils.createProgressiveSVO(triarr, svoDepth, contouringMethod, firstDepth);
+        const showLevel = () => {
+            const svo = VoxelUtils.getProgressiveSVO(handle);
+            const previousTexture = this.svoDataTexture;
+            this.gridMin = svo.min;
+            this.gridMax = svo.max;
+            this.svoDepth = svo.depth;
+            this.createGridData(svo.voxelData, svo.nodeCount);
+            onLevel(this);
+            if(previousTexture)
+                previousTexture.dispose();
+        };
+        try
+        {
+            showLevel();
+        }
+        catch(error)
+        {
+            VoxelUtils.destroyProgressiveSVO(handle);
+            throw error;
+        }
+        /** @type {Promise<void>} */
+        this.refined = new Promise((resolve, reject) => {
+            const refineNext = () => {
+                try
+                {
+                    if(this.svoDepth >= svoDepth)
+                    {
+                        VoxelUtils.destroyProgressiveSVO(handle);
+                        resolve();
+                        return;
+                    }
+                    const start = performance.now();
+                    let depth = this.svoDepth;
+                    while(depth === this.svoDepth && performance.now() - start < PROGRESSIVE_TASK_MS)
+                        depth = VoxelUtils.refineProgressiveSVO(handle, PROGRESSIVE_STEP_NODES);
+                    if(depth !== this.svoDepth)
+                        showLevel();
+                    setTimeout(refineNext, 0);
+                }
+                catch(error)
+                {
+                    VoxelUtils.destroyProgressiveSVO(handle);
+                    reject(error);
+                }
+            };
+            setTimeout(refineNext, 0);
+        });
+    }
+
+    /**
+     * @param {Uint32Array} words
+     * @returns {[THREE.DataTexture, [number, number]]}
+     */
+    createWordTexture(words)
+    {
+        const maxTexSize = Math.floor((Capabilities.maxTextureSize ?? 2048));
+        const width = Math.max(1, Math.min(maxTexSize, words.length));
+        const height = Math.max(1, Math.ceil(words.length / maxTexSize));
+        const data = new Uint32Array(width * height);
+        data.set(words);
+        const tex = new THREE.DataTexture(data, width, height, THREE.RedIntegerFormat, THREE.UnsignedIntType);
+        tex.internalFormat = 'R32UI';
+        tex.needsUpdate = true;
+        return [tex, [width, height]];
+    }
+
     /** 
      * @param {Float32Array} voxelData
      * @param {number} nodeCount
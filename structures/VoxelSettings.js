@@ -2,4 +2,14 @@
 export const ContouringMethod = {
     AverageNormals: 0,
     DualContouring: 1
-};
\ No newline at end of file
+};
+
+/**
+ * Entry order of an encoded SVO, see SVONodeLayout in voxelGrid.cpp.
+ * @enum {number}
+ */
+export const SVONodeLayout = {
+    BreadthFirst: 0,
+    SubtreeBlocks: 1,
+    VanEmdeBoas: 2
+};
@@ -1,6 +1,6 @@
 import voxelUtilsModule from "../wasm/voxelGrid/voxelUtils";
-import { ContouringMethod } from "./VoxelSettings";
-import { voxelizeMesh, voxelizeMeshSVO } from "./temp/gridVoxelization";
+import { ContouringMethod, SVONodeLayout } from "./VoxelSettings";
+import { voxelizeMesh } from "./temp/gridVoxelization";
 import * as THREE from 'three';
 
 const intAsFloat = (num) => {
@@ -17,19 +17,125 @@ const floatAsInt = (num) => {
     return intView[0];
 }
 
+// cwrap for an export of voxelUtils.wasm. The checked-in binary only has the exports it was
+// last built with; until it is rebuilt with the voxelGrid command in wasm/emscriptencommand.txt,
+// calling a newer export throws here instead of aborting the module.
+const cwrapExport = (module, name, returnType, argTypes) => {
+    if(module['_' + name])
+        return module.cwrap(name, returnType, argTypes);
+    return () => {
+        throw new Error(`voxelUtils.wasm has no ${name} export, rebuild it with the voxelGrid command in wasm/emscriptencommand.txt`);
+    };
+}
+
+// Parameter count of an export of voxelUtils.wasm, 0 when the build does not tell. Builds
+// with wasmExports in EXPORTED_RUNTIME_METHODS give the wasm function itself; otherwise
+// release builds wrap it with one named parameter per argument, while ASSERTIONS builds
+// like the checked-in one take ...args. Reading an unexported wasmExports aborts the
+// module, so only a plain data property is used.
+const exportArity = (module, name) => {
+    const exports = Object.getOwnPropertyDescriptor(module, 'wasmExports');
+    if(exports && 'value' in exports && exports.value[name])
+        return exports.value[name].length;
+    return module['_' + name] ? module['_' + name].length : 0;
+}
+
+// Reads and frees the rewritten ranges returned by the dynamic SVO edits.
+const readSVOEditRanges = (module, dataLoc) => {
+    const pointer = dataLoc >> 2;
+    const rangeCount = module.HEAP32[pointer];
+    const ranges = [];
+    let dataPointer = pointer + 1 + rangeCount * 2;
+    for(let i = 0; i < rangeCount; i++)
+    {
+        const byteOffset = module.HEAP32[pointer + 1 + i * 2];
+        const byteLength = module.HEAP32[pointer + 2 + i * 2];
+        ranges.push({byteOffset, data: module.HEAPF32.slice(dataPointer, dataPointer + byteLength / 4)});
+        dataPointer += byteLength / 4;
+    }
+    module._free(dataLoc);
+    return ranges;
+}
+
 export class VoxelUtils
 {
     static module;
     static createVoxelGridAvgNormalsCPP;
     static createSVOAvgNormalsCPP;
+    static createSimplifiedSVOCPP;
+    static createSVOWithLayoutCPP;
+    static createSVOStreamsCPP;
+    static createPagedSVOCPP;
+    static getPagedSVOTopTreeCPP;
+    static requestSVOPagesCPP;
+    static destroyPagedSVOCPP;
+    static createProgressiveSVOCPP;
+    static refineProgressiveSVOLevelCPP;
+    static getProgressiveSVOCPP;
+    static destroyProgressiveSVOCPP;
+    static createDynamicSVOCPP;
+    static getDynamicSVOCPP;
+    static insertSVOVoxelsCPP;
+    static removeSVOVoxelsCPP;
+    static setSVONormalsCPP;
+    static destroyDynamicSVOCPP;
+    static createSVODAGCPP;
+    static castRaysSVODAGCPP;
+    static castRaysSVOCPP;
+    static createSVOWithRopesCPP;
+    static castRaysSVORopesCPP;
+    static createHybridSVOCPP;
+    static castRaysSVOHybridCPP;
+    static createTriangleGridCPP;
+    static castRaysTriangleGridCPP;
+    static createSolidVoxelGridCPP;
+    static createCompactVoxelGridCPP;
+    static createSignedDistanceFieldCPP;
+    static createVoxelGridMipsCPP;
+    static createVoxelGridHandleCPP;
+    static updateVoxelGridRegionCPP;
+    static destroyVoxelGridHandleCPP;
 
     static async loadModule()
     {
         if(VoxelUtils.module)
             return await Promise.resolve(VoxelUtils.module);
         VoxelUtils.module = await voxelUtilsModule();
-        VoxelUtils.createVoxelGridAvgNormalsCPP = VoxelUtils.module.cwrap('constructVoxelGrid', 'number', ['number', 'number', 'number']);
-        VoxelUtils.createSVOAvgNormalsCPP = VoxelUtils.module.cwrap('constructSVO', 'number', ['number', 'number', 'number']);
+        VoxelUtils.createVoxelGridAvgNormalsCPP = cwrapExport(VoxelUtils.module, 'constructVoxelGrid', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.createSVOAvgNormalsCPP = cwrapExport(VoxelUtils.module, 'constructSVO', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.createSVOStreamsCPP = cwrapExport(VoxelUtils.module, 'constructSVOStreams', 'number', ['number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.createPagedSVOCPP = cwrapExport(VoxelUtils.module, 'createPagedSVO', 'number', ['number', 'number', 'number', 'number', 'number', 'string', 'number']);
+        VoxelUtils.getPagedSVOTopTreeCPP = cwrapExport(VoxelUtils.module, 'getPagedSVOTopTree', 'number', ['number']);
+        VoxelUtils.requestSVOPagesCPP = cwrapExport(VoxelUtils.module, 'requestSVOPages', 'number', ['number', 'number', 'number']);
+        VoxelUtils.destroyPagedSVOCPP = cwrapExport(VoxelUtils.module, 'destroyPagedSVO', null, ['number']);
+        VoxelUtils.createProgressiveSVOCPP = cwrapExport(VoxelUtils.module, 'createProgressiveSVO', 'number', ['number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.refineProgressiveSVOLevelCPP = cwrapExport(VoxelUtils.module, 'refineProgressiveSVOLevel', 'number', ['number', 'number']);
+        VoxelUtils.getProgressiveSVOCPP = cwrapExport(VoxelUtils.module, 'getProgressiveSVO', 'number', ['number']);
+        VoxelUtils.destroyProgressiveSVOCPP = cwrapExport(VoxelUtils.module, 'destroyProgressiveSVO', null, ['number']);
+        VoxelUtils.createDynamicSVOCPP = cwrapExport(VoxelUtils.module, 'createDynamicSVO', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.getDynamicSVOCPP = cwrapExport(VoxelUtils.module, 'getDynamicSVO', 'number', ['number']);
+        VoxelUtils.insertSVOVoxelsCPP = cwrapExport(VoxelUtils.module, 'insertSVOVoxels', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.removeSVOVoxelsCPP = cwrapExport(VoxelUtils.module, 'removeSVOVoxels', 'number', ['number', 'number', 'number']);
+        VoxelUtils.setSVONormalsCPP = cwrapExport(VoxelUtils.module, 'setSVONormals', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.destroyDynamicSVOCPP = cwrapExport(VoxelUtils.module, 'destroyDynamicSVO', null, ['number']);
+        VoxelUtils.createSVODAGCPP = cwrapExport(VoxelUtils.module, 'constructSVODAG', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.castRaysSVOCPP = cwrapExport(VoxelUtils.module, 'castRaysSVO', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.castRaysSVODAGCPP = cwrapExport(VoxelUtils.module, 'castRaysSVODAG', 'number', ['number', 'number', 'number']);
+        VoxelUtils.createSVOWithRopesCPP = cwrapExport(VoxelUtils.module, 'constructSVOWithRopes', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.castRaysSVORopesCPP = cwrapExport(VoxelUtils.module, 'castRaysSVORopes', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.createHybridSVOCPP = cwrapExport(VoxelUtils.module, 'constructHybridSVO', 'number', ['number', 'number', 'number']);
+        VoxelUtils.castRaysSVOHybridCPP = cwrapExport(VoxelUtils.module, 'castRaysSVOHybrid', 'number', ['number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.createTriangleGridCPP = cwrapExport(VoxelUtils.module, 'constructTriangleGrid', 'number', ['number', 'number', 'number']);
+        VoxelUtils.castRaysTriangleGridCPP = cwrapExport(VoxelUtils.module, 'castRaysTriangleGrid', 'number', ['number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.createSVOWithLayoutCPP = cwrapExport(VoxelUtils.module, 'constructSVOWithLayout', 'number', ['number', 'number', 'number', 'number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.createSimplifiedSVOCPP = cwrapExport(VoxelUtils.module, 'constructSimplifiedSVO', 'number', ['number', 'number', 'number', 'number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.createSolidVoxelGridCPP = cwrapExport(VoxelUtils.module, 'constructSolidVoxelGrid', 'number', ['number', 'number', 'number']);
+        VoxelUtils.createCompactVoxelGridCPP = cwrapExport(VoxelUtils.module, 'constructCompactVoxelGrid', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.createSignedDistanceFieldCPP = cwrapExport(VoxelUtils.module, 'constructSignedDistanceField', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.createVoxelGridMipsCPP = cwrapExport(VoxelUtils.module, 'constructVoxelGridMips', 'number', ['number', 'number', 'number', 'number']);
+        VoxelUtils.createVoxelGridHandleCPP = cwrapExport(VoxelUtils.module, 'createVoxelGridHandle', 'number', ['number', 'number', 'number']);
+        VoxelUtils.updateVoxelGridRegionCPP = cwrapExport(VoxelUtils.module, 'updateVoxelGridRegion', 'number', ['number', 'number', 'number', 'number', 'number', 'number']);
+        VoxelUtils.destroyVoxelGridHandleCPP = cwrapExport(VoxelUtils.module, 'destroyVoxelGridHandle', null, ['number']);
     }
 
     /**
@@ -41,13 +147,19 @@ export class VoxelUtils
     static async createVoxelGrid(triarr, gridSize, contouringMethod)
     {
         await VoxelUtils.loadModule();
-        if(contouringMethod != ContouringMethod.AverageNormals)
+        // voxelUtils.wasm builds whose constructVoxelGrid predates contouringMethod abort when
+        // it is passed, so other methods fall back to the JS voxelizer with them.
+        if(contouringMethod != ContouringMethod.AverageNormals && exportArity(VoxelUtils.module, 'constructVoxelGrid') < 4)
         {
-            return await Promise.resolve(voxelizeMesh(triarr, gridSize, contouringMethod));
+            return voxelizeMesh(triarr, gridSize, contouringMethod);
         }
         const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
         VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
-        const dataLoc = VoxelUtils.createVoxelGridAvgNormalsCPP(triLoc, triarr.length / 9, gridSize);
+        // Average normals are the default of contouringMethod; leaving it off keeps them working
+        // with those builds as well.
+        const dataLoc = contouringMethod == ContouringMethod.AverageNormals ?
+            VoxelUtils.createVoxelGridAvgNormalsCPP(triLoc, triarr.length / 9, gridSize) :
+            VoxelUtils.createVoxelGridAvgNormalsCPP(triLoc, triarr.length / 9, gridSize, contouringMethod);
         const fpointer = dataLoc >> 2;
         const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 7);
         const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
@@ -63,22 +175,767 @@ export class VoxelUtils
     }
 
     /**
-     * 
+     * Voxelizes the mesh with octahedral-encoded normals and the filled flag packed into
+     * 32 (R32UI / RG16UI) or 16 (R16UI) bits per voxel. Decode with decodeOctahedralVoxel.
+     * @param {Float32Array} triarr
+     * @param {number} gridSize
+     * @param {16 | 32} [bitsPerVoxel=32] bitsPerVoxel
+     * @returns {Promise<{minPoint: THREE.Vector3, size: [number, number, number], voxelSize: number, voxelData: Uint32Array | Uint16Array}>}
+     */
+    static async createCompactVoxelGrid(triarr, gridSize, bitsPerVoxel=32)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createCompactVoxelGridCPP(triLoc, triarr.length / 9, gridSize, bitsPerVoxel);
+        if(dataLoc === 0)
+        {
+            VoxelUtils.module._free(triLoc);
+            throw new Error(`Compact voxel grids take 16 or 32 bits per voxel, not ${bitsPerVoxel}`);
+        }
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 7);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const size = [floatAsInt(dat[3]), floatAsInt(dat[4]), floatAsInt(dat[5])];
+        const voxelSize = dat[6];
+        const totalGridSize = size[0] * size[1] * size[2];
+        const voxelDataStart = fpointer + 7;
+        const voxelDataEnd = voxelDataStart + Math.ceil(totalGridSize * bitsPerVoxel / 32);
+        const words = VoxelUtils.module.HEAPU32.slice(voxelDataStart, voxelDataEnd);
+        const voxelData = bitsPerVoxel == 16 ? new Uint16Array(words.buffer, 0, totalGridSize) : words;
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {minPoint, size, voxelSize, voxelData};
+    }
+
+    /**
+     * Signed distances from voxel centers to the mesh, negative inside.
+     * @param {Float32Array} triarr
+     * @param {number} gridSize
+     * @param {number} [bandWidth=0] bandWidth in voxels; distances are clamped to it. 0 computes the full field.
+     * @returns {Promise<{minPoint: THREE.Vector3, size: [number, number, number], voxelSize: number, distances: Float32Array}>}
+     */
+    static async createSignedDistanceField(triarr, gridSize, bandWidth=0)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createSignedDistanceFieldCPP(triLoc, triarr.length / 9, gridSize, bandWidth);
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 7);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const size = [floatAsInt(dat[3]), floatAsInt(dat[4]), floatAsInt(dat[5])];
+        const voxelSize = dat[6];
+        const totalGridSize = size[0] * size[1] * size[2];
+        const distances = VoxelUtils.module.HEAPF32.slice(fpointer + 7, fpointer + 7 + totalGridSize);
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {minPoint, size, voxelSize, distances};
+    }
+
+    /**
+     * Voxelizes the mesh and builds a mip chain on top of it. Each level stores 4 floats per voxel:
+     * the coverage-weighted average normal and the coverage in [0, 1]; coverage > 0 means occupied.
+     * Level l has voxel size voxelSize * 2^l.
+     * @param {Float32Array} triarr
+     * @param {number} gridSize
+     * @param {number} [maxLevels=0] maxLevels 0 builds the full chain
+     * @returns {Promise<{minPoint: THREE.Vector3, voxelSize: number, levels: {size: [number, number, number], voxelData: Float32Array}[]}>}
+     */
+    static async createVoxelGridMips(triarr, gridSize, maxLevels=0)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createVoxelGridMipsCPP(triLoc, triarr.length / 9, gridSize, maxLevels);
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 7);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const voxelSize = dat[6];
+        const levelCount = VoxelUtils.module.HEAP32[fpointer + 7];
+        const levels = [];
+        for(let l = 0; l < levelCount; l++)
+        {
+            const info = VoxelUtils.module.HEAP32.subarray(fpointer + 8 + l * 4, fpointer + 12 + l * 4);
+            const size = [info[0], info[1], info[2]];
+            const start = fpointer + info[3];
+            const voxelData = VoxelUtils.module.HEAPF32.slice(start, start + size[0] * size[1] * size[2] * 4);
+            levels.push({size, voxelData});
+        }
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {minPoint, voxelSize, levels};
+    }
+
+    /**
+     * Creates a persistent voxel grid that can be edited with updateVoxelGridRegion.
+     * Release it with destroyVoxelGridHandle.
+     * @param {Float32Array} triarr
+     * @param {number} gridSize
+     * @returns {Promise<number>} handle
+     */
+    static async createVoxelGridHandle(triarr, gridSize)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const handle = VoxelUtils.createVoxelGridHandleCPP(triLoc, triarr.length / 9, gridSize);
+        VoxelUtils.module._free(triLoc);
+        return handle;
+    }
+
+    /**
+     * Replaces (or appends) the triangles at changedIndices and removes the ones at removedIndices.
+     * Returns the inclusive dirty voxel range and its voxels in the createVoxelGrid layout, x fastest.
+     * @param {number} handle
+     * @param {Int32Array} changedIndices
+     * @param {Float32Array} changedTriangles 9 floats per changed index
+     * @param {Int32Array} removedIndices
+     * @returns {{min: [number, number, number], max: [number, number, number], voxelData: Float32Array}}
+     */
+    static updateVoxelGridRegion(handle, changedIndices, changedTriangles, removedIndices)
+    {
+        const changedIndexLoc = VoxelUtils.module._malloc(Math.max(changedIndices.length, 1) * 4);
+        const changedTriLoc = VoxelUtils.module._malloc(Math.max(changedTriangles.length, 1) * 4);
+        const removedIndexLoc = VoxelUtils.module._malloc(Math.max(removedIndices.length, 1) * 4);
+        VoxelUtils.module.HEAP32.set(changedIndices, changedIndexLoc >> 2);
+        VoxelUtils.module.HEAPF32.set(changedTriangles, changedTriLoc >> 2);
+        VoxelUtils.module.HEAP32.set(removedIndices, removedIndexLoc >> 2);
+        const dataLoc = VoxelUtils.updateVoxelGridRegionCPP(handle, changedIndexLoc, changedTriLoc, changedIndices.length, removedIndexLoc, removedIndices.length);
+        const ipointer = dataLoc >> 2;
+        const range = VoxelUtils.module.HEAP32.subarray(ipointer, ipointer + 6);
+        const min = [range[0], range[1], range[2]];
+        const max = [range[3], range[4], range[5]];
+        const dirtyCount = Math.max(0, max[0] - min[0] + 1) * Math.max(0, max[1] - min[1] + 1) * Math.max(0, max[2] - min[2] + 1);
+        const voxelData = VoxelUtils.module.HEAPF32.slice(ipointer + 6, ipointer + 6 + dirtyCount * 4);
+        VoxelUtils.module._free(changedIndexLoc);
+        VoxelUtils.module._free(changedTriLoc);
+        VoxelUtils.module._free(removedIndexLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {min, max, voxelData};
+    }
+
+    /** @param {number} handle */
+    static destroyVoxelGridHandle(handle)
+    {
+        VoxelUtils.destroyVoxelGridHandleCPP(handle);
+    }
+
+    /**
+     * Voxelizes the mesh like createVoxelGrid and additionally fills its interior.
+     * Bit (i & 31) of occupancy[i >> 5] is set for voxel i = z * size[0] * size[1] + y * size[0] + x
+     * when it lies on the surface or inside the mesh.
+     * @param {Float32Array} triarr
+     * @param {number} gridSize
+     * @returns {Promise<{minPoint: THREE.Vector3, size: [number, number, number], voxelSize: number, voxelData: Float32Array, occupancy: Uint32Array}>}
+     */
+    static async createSolidVoxelGrid(triarr, gridSize)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createSolidVoxelGridCPP(triLoc, triarr.length / 9, gridSize);
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 7);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const size = [floatAsInt(dat[3]), floatAsInt(dat[4]), floatAsInt(dat[5])];
+        const voxelSize = dat[6];
+        const totalGridSize = size[0] * size[1] * size[2];
+        const voxelDataStart = fpointer + 7;
+        const voxelDataEnd = voxelDataStart + totalGridSize * 4;
+        const voxelData = VoxelUtils.module.HEAPF32.slice(voxelDataStart, voxelDataEnd);
+        const occupancy = VoxelUtils.module.HEAPU32.slice(voxelDataEnd, voxelDataEnd + Math.ceil(totalGridSize / 32));
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {minPoint, size, voxelSize, voxelData, occupancy};
+    }
+
+    /**
+     * Without simplification every leaf sits at the full depth. With it, subtrees collapse
+     * into single leaves while the merged normal stays within maxNormalAngle (radians) of
+     * every original leaf normal and the surface moves at most maxGeometricError (world
+     * units). A positive targetNodeCount instead collapses until the tree fits in that many
+     * nodes, using the two budgets only as relative weights.
      * @param {Float32Array} triarr 
      * @param {number} depth 
      * @param {ContouringMethod} contouringMethod 
-     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, nodeCount: number, voxelData: Float32Array}>}
+     * @param {{maxNormalAngle: number, maxGeometricError: number, targetNodeCount?: number}} [simplification]
+     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array, removedNodeCount: number}>}
+     */
+    static async createSVO(triarr, depth, contouringMethod, simplification)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        let dataLoc;
+        let removedNodeCount = 0;
+        if(simplification)
+        {
+            const removedLoc = VoxelUtils.module._malloc(4);
+            dataLoc = VoxelUtils.createSimplifiedSVOCPP(triLoc, triarr.length / 9, depth, contouringMethod,
+                simplification.maxNormalAngle, simplification.maxGeometricError, simplification.targetNodeCount ?? 0, removedLoc);
+            removedNodeCount = VoxelUtils.module.HEAP32[removedLoc >> 2];
+            VoxelUtils.module._free(removedLoc);
+        }
+        else
+        {
+            dataLoc = VoxelUtils.createSVOAvgNormalsCPP(triLoc, triarr.length / 9, depth, contouringMethod);
+        }
+        if(dataLoc === 0)
+        {
+            VoxelUtils.module._free(triLoc);
+            throw new Error(`SVO of depth ${depth} exceeds the limits of the encoding, see the console for details`);
+        }
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 8);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const maxPoint = new THREE.Vector3(dat[3], dat[4], dat[5]);
+        const size = floatAsInt(dat[6]);
+        const dataSize = floatAsInt(dat[7]);
+        const voxelDataStart = fpointer + 8;
+        const voxelDataEnd = voxelDataStart + dataSize * 4;
+        const voxelData = VoxelUtils.module.HEAPF32.slice(voxelDataStart, voxelDataEnd);
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {min: minPoint, max: maxPoint, size, nodeCount: dataSize, voxelData, removedNodeCount};
+    }
+
+    /**
+     * Builds the SVO like createSVO with its entries in the given order. SubtreeBlocks keeps
+     * the first topLevels levels breadth-first and packs everything below into blocks of up
+     * to blockSize entries (256 entries are 4 KiB), so a ray descending a subtree stays in
+     * few pages. Probe rays are cast through the result to measure the layout: the average
+     * entry reads per ray, the average distance in entries between consecutive reads and
+     * the fraction of reads within 256 entries of the previous one.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {ContouringMethod} contouringMethod
+     * @param {SVONodeLayout} layout
+     * @param {{topLevels?: number, blockSize?: number}} [blockOptions]
+     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array, fetchesPerRay: number, fetchDistance: number, nearFetchRatio: number}>}
+     */
+    static async createSVOWithLayout(triarr, depth, contouringMethod, layout = SVONodeLayout.SubtreeBlocks, blockOptions = {})
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const statsLoc = VoxelUtils.module._malloc(12);
+        const dataLoc = VoxelUtils.createSVOWithLayoutCPP(triLoc, triarr.length / 9, depth, contouringMethod, layout,
+            blockOptions.topLevels ?? 3, blockOptions.blockSize ?? 256, statsLoc);
+        VoxelUtils.module._free(triLoc);
+        if(dataLoc === 0)
+        {
+            VoxelUtils.module._free(statsLoc);
+            throw new Error(`SVO of depth ${depth} exceeds the limits of the encoding, see the console for details`);
+        }
+        const stats = VoxelUtils.module.HEAPF32.slice(statsLoc >> 2, (statsLoc >> 2) + 3);
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 8);
+        const nodeCount = floatAsInt(dat[7]);
+        const result = {
+            min: new THREE.Vector3(dat[0], dat[1], dat[2]),
+            max: new THREE.Vector3(dat[3], dat[4], dat[5]),
+            size: floatAsInt(dat[6]),
+            nodeCount,
+            voxelData: VoxelUtils.module.HEAPF32.slice(fpointer + 8, fpointer + 8 + nodeCount * 4),
+            fetchesPerRay: stats[0],
+            fetchDistance: stats[1],
+            nearFetchRatio: stats[2]
+        };
+        VoxelUtils.module._free(statsLoc);
+        VoxelUtils.module._free(dataLoc);
+        return result;
+    }
+
+    /**
+     * Builds the SVO as a 4 byte per entry topology stream and a separate attribute stream.
+     * Topology words match the first word of every createSVO entry, except that a leaf holds
+     * its attribute index in every bit but bit 8. Attributes are octahedral normals
+     * (decodeOctahedralVoxel with 15 bits per axis), or for dual contouring the vertex as
+     * 11:11:10 bit fractions of its cube. They cover the leaves only in breadth-first order,
+     * or every entry when includeInteriorAttributes is set.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {ContouringMethod} contouringMethod
+     * @param {boolean} [includeInteriorAttributes=false]
+     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, size: number, depth: number, nodeCount: number, attributeFormat: number, topology: Uint32Array, attributes: Uint32Array}>}
+     */
+    static async createSVOStreams(triarr, depth, contouringMethod, includeInteriorAttributes = false)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createSVOStreamsCPP(triLoc, triarr.length / 9, depth, contouringMethod, includeInteriorAttributes ? 1 : 0);
+        if(dataLoc === 0)
+        {
+            VoxelUtils.module._free(triLoc);
+            throw new Error(`SVO of depth ${depth} exceeds the limits of the encoding, see the console for details`);
+        }
+        const fpointer = dataLoc >> 2;
+        const header = VoxelUtils.module.HEAPF32.slice(fpointer, fpointer + 11);
+        const nodeCount = floatAsInt(header[8]);
+        const attributeCount = floatAsInt(header[9]);
+        const topologyStart = fpointer + 11;
+        const topology = VoxelUtils.module.HEAPU32.slice(topologyStart, topologyStart + nodeCount);
+        const attributes = VoxelUtils.module.HEAPU32.slice(topologyStart + nodeCount, topologyStart + nodeCount + attributeCount);
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {
+            min: new THREE.Vector3(header[0], header[1], header[2]),
+            max: new THREE.Vector3(header[3], header[4], header[5]),
+            size: floatAsInt(header[6]),
+            depth: floatAsInt(header[7]),
+            nodeCount,
+            attributeFormat: floatAsInt(header[10]),
+            topology, attributes
+        };
+    }
+
+    /**
+     * Builds an SVO whose subtrees below cutLevel are pages in a file at pagePath (in the
+     * module's file system); only the top tree and up to cachePageCount pages stay in memory.
+     * The top tree is in the createSVOStreams layout and its leaves are the page roots, so a
+     * top leaf's attribute index is its page id. Pages are fetched with requestSVOPages.
+     * The module mounts no persistent file system, so pagePath is in Emscripten's in-memory
+     * MEMFS. The page file stays in JS memory, and the cache only bounds the decoded pages
+     * held at once, not the total footprint.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {number} cutLevel
+     * @param {ContouringMethod} contouringMethod
+     * @param {string} pagePath
+     * @param {number} cachePageCount
+     * @returns {Promise<{handle: number, min: THREE.Vector3, max: THREE.Vector3, size: number, depth: number, cutLevel: number, pageCount: number, maxPageWordCount: number, attributeFormat: number, topology: Uint32Array, attributes: Uint32Array}>}
+     */
+    static async createPagedSVO(triarr, depth, cutLevel, contouringMethod, pagePath, cachePageCount)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const handle = VoxelUtils.createPagedSVOCPP(triLoc, triarr.length / 9, depth, cutLevel, contouringMethod, pagePath, cachePageCount);
+        VoxelUtils.module._free(triLoc);
+        if(handle === 0)
+            throw new Error(`Paged SVO of depth ${depth} cut at level ${cutLevel} could not be built, see the console for details`);
+        const dataLoc = VoxelUtils.getPagedSVOTopTreeCPP(handle);
+        const fpointer = dataLoc >> 2;
+        const header = VoxelUtils.module.HEAPF32.slice(fpointer, fpointer + 14);
+        const entryCount = floatAsInt(header[11]);
+        const attributeCount = floatAsInt(header[12]);
+        const topologyStart = fpointer + 14;
+        const topology = VoxelUtils.module.HEAPU32.slice(topologyStart, topologyStart + entryCount);
+        const attributes = VoxelUtils.module.HEAPU32.slice(topologyStart + entryCount, topologyStart + entryCount + attributeCount);
+        VoxelUtils.module._free(dataLoc);
+        return {
+            handle,
+            min: new THREE.Vector3(header[0], header[1], header[2]),
+            max: new THREE.Vector3(header[3], header[4], header[5]),
+            size: floatAsInt(header[6]),
+            depth: floatAsInt(header[7]),
+            cutLevel: floatAsInt(header[8]),
+            pageCount: floatAsInt(header[9]),
+            maxPageWordCount: floatAsInt(header[10]),
+            attributeFormat: floatAsInt(header[13]),
+            topology, attributes
+        };
+    }
+
+    /**
+     * Reports the pages the renderer needed, most important first, and returns the ones that
+     * were not resident yet along with the pages evicted to make room for them.
+     * @param {number} handle
+     * @param {Int32Array} pageIds
+     * @returns {{loaded: {pageId: number, topology: Uint32Array, attributes: Uint32Array}[], evicted: Int32Array, skippedCount: number}}
+     */
+    static requestSVOPages(handle, pageIds)
+    {
+        const idLoc = VoxelUtils.module._malloc(Math.max(pageIds.length, 1) * 4);
+        VoxelUtils.module.HEAP32.set(pageIds, idLoc >> 2);
+        const dataLoc = VoxelUtils.requestSVOPagesCPP(handle, idLoc, pageIds.length);
+        let pointer = dataLoc >> 2;
+        const loadedCount = VoxelUtils.module.HEAP32[pointer];
+        const evictedCount = VoxelUtils.module.HEAP32[pointer + 1];
+        const skippedCount = VoxelUtils.module.HEAP32[pointer + 2];
+        pointer += 3;
+        const evicted = VoxelUtils.module.HEAP32.slice(pointer, pointer + evictedCount);
+        pointer += evictedCount;
+        const loaded = [];
+        for(let i = 0; i < loadedCount; i++)
+        {
+            const pageId = VoxelUtils.module.HEAP32[pointer];
+            const topologyCount = VoxelUtils.module.HEAPU32[pointer + 1];
+            const attributeCount = VoxelUtils.module.HEAPU32[pointer + 2];
+            const topologyStart = pointer + 3;
+            const topology = VoxelUtils.module.HEAPU32.slice(topologyStart, topologyStart + topologyCount);
+            const attributes = VoxelUtils.module.HEAPU32.slice(topologyStart + topologyCount, topologyStart + topologyCount + attributeCount);
+            loaded.push({pageId, topology, attributes});
+            pointer = topologyStart + topologyCount + attributeCount;
+        }
+        VoxelUtils.module._free(idLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {loaded, evicted, skippedCount};
+    }
+
+    /**
+     * @param {number} handle
+     */
+    static destroyPagedSVO(handle)
+    {
+        VoxelUtils.destroyPagedSVOCPP(handle);
+    }
+
+    /**
+     * Starts building an SVO top-down and returns once levels 0..firstDepth exist. The tree
+     * built so far is read with getProgressiveSVO and grows by one level whenever
+     * refineProgressiveSVO completes one; at full depth it equals createSVO's.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {ContouringMethod} contouringMethod
+     * @param {number} [firstDepth=5]
+     * @returns {Promise<number>} handle
      */
-    static async createSVO(triarr, depth, contouringMethod)
+    static async createProgressiveSVO(triarr, depth, contouringMethod, firstDepth = 5)
     {
         await VoxelUtils.loadModule();
-        if(contouringMethod != ContouringMethod.AverageNormals)
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const handle = VoxelUtils.createProgressiveSVOCPP(triLoc, triarr.length / 9, depth, firstDepth, contouringMethod);
+        VoxelUtils.module._free(triLoc);
+        if(handle === 0)
+            throw new Error(`SVO depth ${depth} is outside the supported range`);
+        return handle;
+    }
+
+    /**
+     * Does up to maxNodes nodes of work on the next level of a progressive SVO, all of it
+     * when maxNodes is 0, so the caller can yield between calls.
+     * @param {number} handle
+     * @param {number} [maxNodes=0]
+     * @returns {number} depth of the tree built so far, one more once the level is complete
+     */
+    static refineProgressiveSVO(handle, maxNodes = 0)
+    {
+        return VoxelUtils.refineProgressiveSVOLevelCPP(handle, maxNodes);
+    }
+
+    /**
+     * The tree built so far in the createSVO layout; its deepest level holds the leaves.
+     * Reading each level right after it is built only encodes the new level.
+     * @param {number} handle
+     * @returns {{min: THREE.Vector3, max: THREE.Vector3, size: number, depth: number, nodeCount: number, voxelData: Float32Array}}
+     */
+    static getProgressiveSVO(handle)
+    {
+        const dataLoc = VoxelUtils.getProgressiveSVOCPP(handle);
+        if(dataLoc === 0)
+            throw new Error(`Progressive SVO exceeds the limits of the encoding, see the console for details`);
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 8);
+        const size = floatAsInt(dat[6]);
+        const nodeCount = floatAsInt(dat[7]);
+        const result = {
+            min: new THREE.Vector3(dat[0], dat[1], dat[2]),
+            max: new THREE.Vector3(dat[3], dat[4], dat[5]),
+            size,
+            depth: Math.round(Math.log2(size)),
+            nodeCount,
+            voxelData: VoxelUtils.module.HEAPF32.slice(fpointer + 8, fpointer + 8 + nodeCount * 4)
+        };
+        VoxelUtils.module._free(dataLoc);
+        return result;
+    }
+
+    /**
+     * @param {number} handle
+     */
+    static destroyProgressiveSVO(handle)
+    {
+        VoxelUtils.destroyProgressiveSVOCPP(handle);
+    }
+
+    /**
+     * Builds an SVO like createSVO that stays editable with insertSVOVoxels, removeSVOVoxels
+     * and setSVONormals. Its entries keep slack for new children, so it has more of them
+     * than createSVO's; unused ones are never reached from the root.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {ContouringMethod} contouringMethod
+     * @returns {Promise<number>} handle
+     */
+    static async createDynamicSVO(triarr, depth, contouringMethod)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const handle = VoxelUtils.createDynamicSVOCPP(triLoc, triarr.length / 9, depth, contouringMethod);
+        VoxelUtils.module._free(triLoc);
+        if(handle === 0)
+            throw new Error(`SVO depth ${depth} is outside the supported range`);
+        return handle;
+    }
+
+    /**
+     * The whole encoding in the createSVO layout. The edits return the byte ranges of this
+     * buffer (header included) that they rewrote.
+     * @param {number} handle
+     * @returns {{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array}}
+     */
+    static getDynamicSVO(handle)
+    {
+        const dataLoc = VoxelUtils.getDynamicSVOCPP(handle);
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 8);
+        const nodeCount = floatAsInt(dat[7]);
+        const result = {
+            min: new THREE.Vector3(dat[0], dat[1], dat[2]),
+            max: new THREE.Vector3(dat[3], dat[4], dat[5]),
+            size: floatAsInt(dat[6]),
+            nodeCount,
+            voxelData: VoxelUtils.module.HEAPF32.slice(fpointer + 8, fpointer + 8 + nodeCount * 4)
+        };
+        VoxelUtils.module._free(dataLoc);
+        return result;
+    }
+
+    /**
+     * Sets the leaves at the given voxel coordinates (0..size-1, three per voxel) to the
+     * normals, creating them as needed. Returns the rewritten byte ranges of the
+     * getDynamicSVO buffer with their new contents.
+     * @param {number} handle
+     * @param {Int32Array} voxels
+     * @param {Float32Array} normals
+     * @returns {{byteOffset: number, data: Float32Array}[]}
+     */
+    static insertSVOVoxels(handle, voxels, normals)
+    {
+        const voxelLoc = VoxelUtils.module._malloc(Math.max(voxels.length, 1) * 4);
+        const normalLoc = VoxelUtils.module._malloc(Math.max(normals.length, 1) * 4);
+        VoxelUtils.module.HEAP32.set(voxels, voxelLoc >> 2);
+        VoxelUtils.module.HEAPF32.set(normals, normalLoc >> 2);
+        const dataLoc = VoxelUtils.insertSVOVoxelsCPP(handle, voxelLoc, normalLoc, voxels.length / 3);
+        VoxelUtils.module._free(voxelLoc);
+        VoxelUtils.module._free(normalLoc);
+        if(dataLoc === 0)
+            throw new Error(`Inserting ${voxels.length / 3} voxels could exceed the limits of the encoding, see the console for details`);
+        return readSVOEditRanges(VoxelUtils.module, dataLoc);
+    }
+
+    /**
+     * Removes the leaves at the given voxel coordinates and the nodes left empty.
+     * @param {number} handle
+     * @param {Int32Array} voxels
+     * @returns {{byteOffset: number, data: Float32Array}[]} see insertSVOVoxels
+     */
+    static removeSVOVoxels(handle, voxels)
+    {
+        const voxelLoc = VoxelUtils.module._malloc(Math.max(voxels.length, 1) * 4);
+        VoxelUtils.module.HEAP32.set(voxels, voxelLoc >> 2);
+        const dataLoc = VoxelUtils.removeSVOVoxelsCPP(handle, voxelLoc, voxels.length / 3);
+        VoxelUtils.module._free(voxelLoc);
+        return readSVOEditRanges(VoxelUtils.module, dataLoc);
+    }
+
+    /**
+     * Replaces the normals of existing leaves.
+     * @param {number} handle
+     * @param {Int32Array} voxels
+     * @param {Float32Array} normals
+     * @returns {{byteOffset: number, data: Float32Array}[]} see insertSVOVoxels
+     */
+    static setSVONormals(handle, voxels, normals)
+    {
+        const voxelLoc = VoxelUtils.module._malloc(Math.max(voxels.length, 1) * 4);
+        const normalLoc = VoxelUtils.module._malloc(Math.max(normals.length, 1) * 4);
+        VoxelUtils.module.HEAP32.set(voxels, voxelLoc >> 2);
+        VoxelUtils.module.HEAPF32.set(normals, normalLoc >> 2);
+        const dataLoc = VoxelUtils.setSVONormalsCPP(handle, voxelLoc, normalLoc, voxels.length / 3);
+        VoxelUtils.module._free(voxelLoc);
+        VoxelUtils.module._free(normalLoc);
+        return readSVOEditRanges(VoxelUtils.module, dataLoc);
+    }
+
+    /**
+     * @param {number} handle
+     */
+    static destroyDynamicSVO(handle)
+    {
+        VoxelUtils.destroyDynamicSVOCPP(handle);
+    }
+
+    /**
+     * Builds the SVO and merges identical subtrees into a sparse voxel DAG. nodes holds the
+     * variable sized node words described in svodag.h, attributes one word per leaf in
+     * depth-first order: octahedral normals (decodeOctahedralVoxel with 15 bits per axis), or
+     * for dual contouring the vertex as 11:11:10 bit fractions of its leaf cube.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {ContouringMethod} contouringMethod
+     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, size: number, depth: number, attributeFormat: number, header: Float32Array, nodes: Uint32Array, attributes: Uint32Array}>}
+     */
+    static async createSVODAG(triarr, depth, contouringMethod)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createSVODAGCPP(triLoc, triarr.length / 9, depth, contouringMethod);
+        if(dataLoc === 0)
+        {
+            VoxelUtils.module._free(triLoc);
+            throw new Error(`SVO depth ${depth} is outside the supported range`);
+        }
+        const fpointer = dataLoc >> 2;
+        const header = VoxelUtils.module.HEAPF32.slice(fpointer, fpointer + 11);
+        const nodeWordCount = floatAsInt(header[8]);
+        const attributeCount = floatAsInt(header[9]);
+        const nodesStart = fpointer + 11;
+        const nodes = VoxelUtils.module.HEAPU32.slice(nodesStart, nodesStart + nodeWordCount);
+        const attributes = VoxelUtils.module.HEAPU32.slice(nodesStart + nodeWordCount, nodesStart + nodeWordCount + attributeCount);
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {
+            min: new THREE.Vector3(header[0], header[1], header[2]),
+            max: new THREE.Vector3(header[3], header[4], header[5]),
+            size: floatAsInt(header[6]),
+            depth: floatAsInt(header[7]),
+            attributeFormat: floatAsInt(header[10]),
+            header, nodes, attributes
+        };
+    }
+
+    /**
+     * Casts rays on the CPU against an SVO from createSVO, reading the same entries the
+     * shaders do.
+     * @param {{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array}} svo
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, node: Int32Array, normals: Float32Array, fetchesPerRay: number, fetchDistance: number, nearFetchRatio: number}>} t and node are -1 on a miss
+     */
+    static async castRaysSVO(svo, rays)
+    {
+        await VoxelUtils.loadModule();
+        const rayCount = rays.length / 6;
+        const svoLoc = VoxelUtils.module._malloc((8 + svo.voxelData.length) * 4);
+        const header = new Float32Array([svo.min.x, svo.min.y, svo.min.z, svo.max.x, svo.max.y, svo.max.z, intAsFloat(svo.size), intAsFloat(svo.nodeCount)]);
+        VoxelUtils.module.HEAPF32.set(header, svoLoc >> 2);
+        VoxelUtils.module.HEAPF32.set(svo.voxelData, (svoLoc >> 2) + 8);
+        const rayLoc = VoxelUtils.module._malloc(rays.length * 4);
+        VoxelUtils.module.HEAPF32.set(rays, rayLoc >> 2);
+        const statsLoc = VoxelUtils.module._malloc(12);
+        const dataLoc = VoxelUtils.castRaysSVOCPP(svoLoc, rayLoc, rayCount, statsLoc);
+        const t = new Float32Array(rayCount);
+        const node = new Int32Array(rayCount);
+        const normals = new Float32Array(rayCount * 3);
+        for(let i = 0; i < rayCount; i++)
         {
-            const res = await Promise.resolve(voxelizeMeshSVO(triarr, depth, contouringMethod));
+            const pointer = (dataLoc >> 2) + i * 5;
+            t[i] = VoxelUtils.module.HEAPF32[pointer];
+            node[i] = VoxelUtils.module.HEAP32[pointer + 1];
+            normals.set(VoxelUtils.module.HEAPF32.subarray(pointer + 2, pointer + 5), i * 3);
         }
+        const fetchesPerRay = VoxelUtils.module.HEAPF32[statsLoc >> 2];
+        const fetchDistance = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 1];
+        const nearFetchRatio = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 2];
+        VoxelUtils.module._free(svoLoc);
+        VoxelUtils.module._free(rayLoc);
+        VoxelUtils.module._free(statsLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {t, node, normals, fetchesPerRay, fetchDistance, nearFetchRatio};
+    }
+
+    /**
+     * Builds the SVO like createSVO together with six neighbor ropes per entry, in the order
+     * -x, +x, -y, +y, -z, +z. A rope holds the index of the neighbor entry in its low 27 bits
+     * and how many levels coarser than the entry it is in the top 5; 0xFFFFFFFF marks a face
+     * on the boundary of the root.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @param {ContouringMethod} contouringMethod
+     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array, ropes: Uint32Array}>}
+     */
+    static async createSVOWithRopes(triarr, depth, contouringMethod)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createSVOWithRopesCPP(triLoc, triarr.length / 9, depth, contouringMethod);
+        VoxelUtils.module._free(triLoc);
+        if(dataLoc === 0)
+        {
+            throw new Error(`SVO of depth ${depth} exceeds the limits of the rope encoding, see the console for details`);
+        }
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 8);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const maxPoint = new THREE.Vector3(dat[3], dat[4], dat[5]);
+        const size = floatAsInt(dat[6]);
+        const dataSize = floatAsInt(dat[7]);
+        const voxelDataStart = fpointer + 8;
+        const voxelDataEnd = voxelDataStart + dataSize * 4;
+        const voxelData = VoxelUtils.module.HEAPF32.slice(voxelDataStart, voxelDataEnd);
+        const ropes = VoxelUtils.module.HEAPU32.slice(voxelDataEnd, voxelDataEnd + dataSize * 6);
+        VoxelUtils.module._free(dataLoc);
+        return {min: minPoint, max: maxPoint, size, nodeCount: dataSize, voxelData, ropes};
+    }
+
+    /**
+     * castRaysSVO for an SVO from createSVOWithRopes, walking from leaf to leaf along the
+     * ropes instead of keeping a stack.
+     * @param {{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array, ropes: Uint32Array}} svo
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, node: Int32Array, normals: Float32Array, fetchesPerRay: number, fetchDistance: number, nearFetchRatio: number, ropeFetchesPerRay: number}>} t and node are -1 on a miss
+     */
+    static async castRaysSVORopes(svo, rays)
+    {
+        await VoxelUtils.loadModule();
+        const rayCount = rays.length / 6;
+        const svoLoc = VoxelUtils.module._malloc((8 + svo.voxelData.length + svo.ropes.length) * 4);
+        const header = new Float32Array([svo.min.x, svo.min.y, svo.min.z, svo.max.x, svo.max.y, svo.max.z, intAsFloat(svo.size), intAsFloat(svo.nodeCount)]);
+        VoxelUtils.module.HEAPF32.set(header, svoLoc >> 2);
+        VoxelUtils.module.HEAPF32.set(svo.voxelData, (svoLoc >> 2) + 8);
+        VoxelUtils.module.HEAPU32.set(svo.ropes, (svoLoc >> 2) + 8 + svo.voxelData.length);
+        const rayLoc = VoxelUtils.module._malloc(rays.length * 4);
+        VoxelUtils.module.HEAPF32.set(rays, rayLoc >> 2);
+        const statsLoc = VoxelUtils.module._malloc(16);
+        const dataLoc = VoxelUtils.castRaysSVORopesCPP(svoLoc, rayLoc, rayCount, statsLoc);
+        const t = new Float32Array(rayCount);
+        const node = new Int32Array(rayCount);
+        const normals = new Float32Array(rayCount * 3);
+        for(let i = 0; i < rayCount; i++)
+        {
+            const pointer = (dataLoc >> 2) + i * 5;
+            t[i] = VoxelUtils.module.HEAPF32[pointer];
+            node[i] = VoxelUtils.module.HEAP32[pointer + 1];
+            normals.set(VoxelUtils.module.HEAPF32.subarray(pointer + 2, pointer + 5), i * 3);
+        }
+        const fetchesPerRay = VoxelUtils.module.HEAPF32[statsLoc >> 2];
+        const fetchDistance = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 1];
+        const nearFetchRatio = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 2];
+        const ropeFetchesPerRay = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 3];
+        VoxelUtils.module._free(svoLoc);
+        VoxelUtils.module._free(rayLoc);
+        VoxelUtils.module._free(statsLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {t, node, normals, fetchesPerRay, fetchDistance, nearFetchRatio, ropeFetchesPerRay};
+    }
+
+    /**
+     * Builds an SVO with average normals whose leaves reference the triangles of triarr
+     * overlapping them. A leaf entry holds the leaf bit, the start of its list in
+     * triangleIndices and its triangle count as uints, and its octahedral packed normal
+     * (15 bits per axis); interior entries are the same as createSVO's.
+     * @param {Float32Array} triarr
+     * @param {number} depth
+     * @returns {Promise<{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array, triangleIndices: Uint32Array}>}
+     */
+    static async createHybridSVO(triarr, depth)
+    {
+        await VoxelUtils.loadModule();
         const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
         VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
-        const dataLoc = VoxelUtils.createSVOAvgNormalsCPP(triLoc, triarr.length / 9, depth);
+        const dataLoc = VoxelUtils.createHybridSVOCPP(triLoc, triarr.length / 9, depth);
+        VoxelUtils.module._free(triLoc);
+        if(dataLoc === 0)
+        {
+            throw new Error(`Hybrid SVO of depth ${depth} exceeds the limits of the encoding, see the console for details`);
+        }
         const fpointer = dataLoc >> 2;
         const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 8);
         const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
@@ -88,8 +945,155 @@ export class VoxelUtils
         const voxelDataStart = fpointer + 8;
         const voxelDataEnd = voxelDataStart + dataSize * 4;
         const voxelData = VoxelUtils.module.HEAPF32.slice(voxelDataStart, voxelDataEnd);
+        const indexCount = VoxelUtils.module.HEAP32[voxelDataEnd];
+        const triangleIndices = VoxelUtils.module.HEAPU32.slice(voxelDataEnd + 1, voxelDataEnd + 1 + indexCount);
+        VoxelUtils.module._free(dataLoc);
+        return {min: minPoint, max: maxPoint, size, nodeCount: dataSize, voxelData, triangleIndices};
+    }
+
+    /**
+     * Exact ray casts against the triangles through a hybrid SVO: triangles are only tested
+     * in the leaves the ray passes, front to back.
+     * @param {{min: THREE.Vector3, max: THREE.Vector3, size: number, nodeCount: number, voxelData: Float32Array, triangleIndices: Uint32Array}} svo
+     * @param {Float32Array} triarr the triangles the SVO was built from
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, triangle: Int32Array, normals: Float32Array, fetchesPerRay: number, triangleTestsPerRay: number}>} t and triangle are -1 on a miss
+     */
+    static async castRaysSVOHybrid(svo, triarr, rays)
+    {
+        await VoxelUtils.loadModule();
+        const rayCount = rays.length / 6;
+        const svoLoc = VoxelUtils.module._malloc((9 + svo.voxelData.length + svo.triangleIndices.length) * 4);
+        const header = new Float32Array([svo.min.x, svo.min.y, svo.min.z, svo.max.x, svo.max.y, svo.max.z, intAsFloat(svo.size), intAsFloat(svo.nodeCount)]);
+        VoxelUtils.module.HEAPF32.set(header, svoLoc >> 2);
+        VoxelUtils.module.HEAPF32.set(svo.voxelData, (svoLoc >> 2) + 8);
+        VoxelUtils.module.HEAP32[(svoLoc >> 2) + 8 + svo.voxelData.length] = svo.triangleIndices.length;
+        VoxelUtils.module.HEAPU32.set(svo.triangleIndices, (svoLoc >> 2) + 9 + svo.voxelData.length);
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const rayLoc = VoxelUtils.module._malloc(rays.length * 4);
+        VoxelUtils.module.HEAPF32.set(rays, rayLoc >> 2);
+        const statsLoc = VoxelUtils.module._malloc(8);
+        const dataLoc = VoxelUtils.castRaysSVOHybridCPP(svoLoc, triLoc, rayLoc, rayCount, statsLoc);
+        const t = new Float32Array(rayCount);
+        const triangle = new Int32Array(rayCount);
+        const normals = new Float32Array(rayCount * 3);
+        for(let i = 0; i < rayCount; i++)
+        {
+            const pointer = (dataLoc >> 2) + i * 5;
+            t[i] = VoxelUtils.module.HEAPF32[pointer];
+            triangle[i] = VoxelUtils.module.HEAP32[pointer + 1];
+            normals.set(VoxelUtils.module.HEAPF32.subarray(pointer + 2, pointer + 5), i * 3);
+        }
+        const fetchesPerRay = VoxelUtils.module.HEAPF32[statsLoc >> 2];
+        const triangleTestsPerRay = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 1];
+        VoxelUtils.module._free(svoLoc);
+        VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(rayLoc);
+        VoxelUtils.module._free(statsLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {t, triangle, normals, fetchesPerRay, triangleTestsPerRay};
+    }
+
+    /**
+     * Builds a uniform grid of triangle lists: cellStarts[c] up to cellStarts[c + 1] index the
+     * triangles of triarr overlapping cell c, with cells x-major ((x * size[1] + y) * size[2] + z).
+     * @param {Float32Array} triarr
+     * @param {number} gridSize cells along the longest axis, 0 to pick it from the triangle count
+     * @returns {Promise<{minPoint: THREE.Vector3, size: [number, number, number], voxelSize: number, cellStarts: Uint32Array, triangleIndices: Uint32Array}>}
+     */
+    static async createTriangleGrid(triarr, gridSize = 0)
+    {
+        await VoxelUtils.loadModule();
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const dataLoc = VoxelUtils.createTriangleGridCPP(triLoc, triarr.length / 9, gridSize);
+        VoxelUtils.module._free(triLoc);
+        if(dataLoc === 0)
+        {
+            throw new Error(`Triangle grid of size ${gridSize} could not be built, see the console for details`);
+        }
+        const fpointer = dataLoc >> 2;
+        const dat = VoxelUtils.module.HEAPF32.subarray(fpointer, fpointer + 7);
+        const minPoint = new THREE.Vector3(dat[0], dat[1], dat[2]);
+        const size = [floatAsInt(dat[3]), floatAsInt(dat[4]), floatAsInt(dat[5])];
+        const voxelSize = dat[6];
+        const cellCount = size[0] * size[1] * size[2];
+        const cellStarts = VoxelUtils.module.HEAPU32.slice(fpointer + 7, fpointer + 8 + cellCount);
+        const triangleIndices = VoxelUtils.module.HEAPU32.slice(fpointer + 8 + cellCount, fpointer + 8 + cellCount + cellStarts[cellCount]);
+        VoxelUtils.module._free(dataLoc);
+        return {minPoint, size, voxelSize, cellStarts, triangleIndices};
+    }
+
+    /**
+     * CPU reference ray casts through a triangle grid with a 3D-DDA, for comparing triangle
+     * tests per ray against the other acceleration structures.
+     * @param {{minPoint: THREE.Vector3, size: [number, number, number], voxelSize: number, cellStarts: Uint32Array, triangleIndices: Uint32Array}} grid
+     * @param {Float32Array} triarr the triangles the grid was built from
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, triangle: Int32Array, normals: Float32Array, cellsPerRay: number, triangleTestsPerRay: number}>} t and triangle are -1 on a miss
+     */
+    static async castRaysTriangleGrid(grid, triarr, rays)
+    {
+        await VoxelUtils.loadModule();
+        const rayCount = rays.length / 6;
+        const gridLoc = VoxelUtils.module._malloc((7 + grid.cellStarts.length + grid.triangleIndices.length) * 4);
+        const header = new Float32Array([grid.minPoint.x, grid.minPoint.y, grid.minPoint.z, intAsFloat(grid.size[0]), intAsFloat(grid.size[1]), intAsFloat(grid.size[2]), grid.voxelSize]);
+        VoxelUtils.module.HEAPF32.set(header, gridLoc >> 2);
+        VoxelUtils.module.HEAPU32.set(grid.cellStarts, (gridLoc >> 2) + 7);
+        VoxelUtils.module.HEAPU32.set(grid.triangleIndices, (gridLoc >> 2) + 7 + grid.cellStarts.length);
+        const triLoc = VoxelUtils.module._malloc(triarr.length * 4);
+        VoxelUtils.module.HEAPF32.set(triarr, triLoc >> 2);
+        const rayLoc = VoxelUtils.module._malloc(rays.length * 4);
+        VoxelUtils.module.HEAPF32.set(rays, rayLoc >> 2);
+        const statsLoc = VoxelUtils.module._malloc(8);
+        const dataLoc = VoxelUtils.castRaysTriangleGridCPP(gridLoc, triLoc, rayLoc, rayCount, statsLoc);
+        const t = new Float32Array(rayCount);
+        const triangle = new Int32Array(rayCount);
+        const normals = new Float32Array(rayCount * 3);
+        for(let i = 0; i < rayCount; i++)
+        {
+            const pointer = (dataLoc >> 2) + i * 5;
+            t[i] = VoxelUtils.module.HEAPF32[pointer];
+            triangle[i] = VoxelUtils.module.HEAP32[pointer + 1];
+            normals.set(VoxelUtils.module.HEAPF32.subarray(pointer + 2, pointer + 5), i * 3);
+        }
+        const cellsPerRay = VoxelUtils.module.HEAPF32[statsLoc >> 2];
+        const triangleTestsPerRay = VoxelUtils.module.HEAPF32[(statsLoc >> 2) + 1];
+        VoxelUtils.module._free(gridLoc);
         VoxelUtils.module._free(triLoc);
+        VoxelUtils.module._free(rayLoc);
+        VoxelUtils.module._free(statsLoc);
+        VoxelUtils.module._free(dataLoc);
+        return {t, triangle, normals, cellsPerRay, triangleTestsPerRay};
+    }
+
+    /**
+     * CPU reference ray casts against a DAG from createSVODAG.
+     * @param {{header: Float32Array, nodes: Uint32Array}} dag
+     * @param {Float32Array} rays origin and direction per ray
+     * @returns {Promise<{t: Float32Array, attributeIndex: Int32Array}>} t is -1 and attributeIndex -1 on a miss
+     */
+    static async castRaysSVODAG(dag, rays)
+    {
+        await VoxelUtils.loadModule();
+        const rayCount = rays.length / 6;
+        const dagLoc = VoxelUtils.module._malloc((dag.header.length + dag.nodes.length) * 4);
+        VoxelUtils.module.HEAPF32.set(dag.header, dagLoc >> 2);
+        VoxelUtils.module.HEAPU32.set(dag.nodes, (dagLoc >> 2) + dag.header.length);
+        const rayLoc = VoxelUtils.module._malloc(rays.length * 4);
+        VoxelUtils.module.HEAPF32.set(rays, rayLoc >> 2);
+        const dataLoc = VoxelUtils.castRaysSVODAGCPP(dagLoc, rayLoc, rayCount);
+        const t = new Float32Array(rayCount);
+        const attributeIndex = new Int32Array(rayCount);
+        for(let i = 0; i < rayCount; i++)
+        {
+            t[i] = VoxelUtils.module.HEAPF32[(dataLoc >> 2) + i * 2];
+            attributeIndex[i] = VoxelUtils.module.HEAP32[(dataLoc >> 2) + i * 2 + 1];
+        }
+        VoxelUtils.module._free(dagLoc);
+        VoxelUtils.module._free(rayLoc);
         VoxelUtils.module._free(dataLoc);
-        return {min: minPoint, max: maxPoint, nodeCount: dataSize, voxelData};
+        return {t, attributeIndex};
     }
 }
\ No newline at end of file
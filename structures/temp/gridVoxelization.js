@@ -304,7 +304,7 @@ export const voxelizeMeshSVO = (triarr, svoDepth, contouringMethod) => {
         const node = linearSVOs[i];
         const cmBits = node.childMask & 0xFF;
         const leafBit = node.isLeaf ? 0x100 : 0;
-        const offsetBits = (node.childOffset & 0x7FFFFF) << 9;
+        const offsetBits = (node.childOffset & 0x3FFFFF) << 9;
         const packedInt = cmBits | leafBit | offsetBits;
         float32arr[i * 4] = intAsFloat(packedInt);
         float32arr[i * 4 + 1] = node.avgNormal.x;
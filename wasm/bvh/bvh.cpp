@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <cstring>
+#include <vector>
 #include "./includes/mathutils.h"
 extern "C"
 {
@@ -327,4 +328,87 @@ int* constructLinearBVH(float* primArray, int primCount, int leafChildCount)
     delete[] primArray;
     return finalArray;
 }
+
+/**
+ * CPU reference ray casts through a constructLinearBVH result, for comparing traversal costs
+ * per asset with the triangle grid and kd-tree casts. Rays are an origin and a direction
+ * each. Per ray the result holds t (-1 on a miss), the index of the hit triangle in the
+ * BVH's reordered triangles as an int and the normal. traversalStats, when not null,
+ * receives the average nodes visited and triangle tests per ray.
+ */
+float* castRaysBVH(int* bvh, float* rays, int rayCount, float* traversalStats)
+{
+    int nodeCount = bvh[0];
+    const int* linearNodes = bvh + 2;
+    const float* bounds = (const float*)(bvh + 2 + nodeCount * 2);
+    const float* triangles = bounds + nodeCount * 6;
+    float* result = new float[rayCount * 5];
+    long long visitedNodes = 0;
+    long long triangleTests = 0;
+    std::vector<int> stack;
+    for(int r = 0; r < rayCount; r++)
+    {
+        const float* ray = rays + r * 6;
+        Vec3 origin = {ray[0], ray[1], ray[2]};
+        Vec3 direction = {ray[3], ray[4], ray[5]};
+        Vec3 invDir = direction.invApproximate();
+        Intersection best;
+        best.hit = false;
+        best.t = INFINITY;
+        int bestTriangle = -1;
+        stack.clear();
+        stack.push_back(0);
+        while(!stack.empty())
+        {
+            int node = stack.back();
+            stack.pop_back();
+            visitedNodes++;
+            const float* b = bounds + node * 6;
+            Bounds nodeBounds;
+            nodeBounds.min = {b[0], b[1], b[2]};
+            nodeBounds.max = {b[3], b[4], b[5]};
+            if(!nodeBounds.intersectRayInvDir(origin, invDir, 0.f, best.t).hit) continue;
+            int nPrims = linearNodes[node * 2 + 1] >> 2;
+            int splitAxis = linearNodes[node * 2 + 1] & 0x3;
+            if(nPrims > 0)
+            {
+                int primOffset = linearNodes[node * 2];
+                for(int i = primOffset; i < primOffset + nPrims; i++)
+                {
+                    const float* v = triangles + i * 9;
+                    Triangle triangle = {{v[0], v[1], v[2]}, {v[3], v[4], v[5]}, {v[6], v[7], v[8]}};
+                    Intersection hit = triangle.intersectRay(origin, direction, 0.f, best.t);
+                    triangleTests++;
+                    if(!hit.hit) continue;
+                    best = hit;
+                    bestTriangle = i;
+                }
+                continue;
+            }
+            // Visit the child on the side the ray comes from first.
+            int secondChild = linearNodes[node * 2];
+            if(direction[splitAxis] < 0)
+            {
+                stack.push_back(node + 1);
+                stack.push_back(secondChild);
+            }
+            else
+            {
+                stack.push_back(secondChild);
+                stack.push_back(node + 1);
+            }
+        }
+        result[r * 5] = best.hit ? best.t : -1.f;
+        std::memcpy(result + r * 5 + 1, &bestTriangle, sizeof(int));
+        result[r * 5 + 2] = best.hit ? best.normal.x : 0.f;
+        result[r * 5 + 3] = best.hit ? best.normal.y : 0.f;
+        result[r * 5 + 4] = best.hit ? best.normal.z : 0.f;
+    }
+    if(traversalStats != nullptr)
+    {
+        traversalStats[0] = rayCount > 0 ? (float)visitedNodes / rayCount : 0.f;
+        traversalStats[1] = rayCount > 0 ? (float)triangleTests / rayCount : 0.f;
+    }
+    return result;
+}
 }
@@ -3,6 +3,18 @@
 #define EPSILON 0.0001
 #include <cmath>
 
+// Float4 holds four float lanes, with SSE natively and simd128 in wasm (emcc -msimd128);
+// the ray-box slab test and triangleboxbatch.h use it. Define MATHUTILS_NO_SIMD for the
+// scalar paths. Vec3 stays three packed floats either way, since grids store it per voxel
+// and encoders copy it as floats.
+#if !defined(MATHUTILS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define MATHUTILS_SSE
+#include <emmintrin.h>
+#elif !defined(MATHUTILS_NO_SIMD) && defined(__wasm_simd128__)
+#define MATHUTILS_WASM_SIMD
+#include <wasm_simd128.h>
+#endif
+
 struct Vec3
 {
     float x, y, z;
@@ -10,14 +22,17 @@ struct Vec3
     Vec3(): x(0), y(0), z(0) {}
     Vec3(float x, float y, float z): x(x), y(y), z(z) {}
     
+    // Indexed through a member table, so the component is one load instead of two branches.
     float operator[](int i) const
     {
-        return i == 0 ? x : (i == 1 ? y : z);
+        static constexpr float Vec3::* components[3] = {&Vec3::x, &Vec3::y, &Vec3::z};
+        return this->*components[i];
     }
 
     float& operator[](int i)
     {
-        return i == 0 ? x : (i == 1 ? y : z);
+        static constexpr float Vec3::* components[3] = {&Vec3::x, &Vec3::y, &Vec3::z};
+        return this->*components[i];
     }
 
     void set(float number)
@@ -188,6 +203,84 @@ Vec3 normalize(const Vec3& a)
     return a.normalized();
 }
 
+#if defined(MATHUTILS_SSE)
+typedef __m128 Float4;
+
+// The w lane repeats z, so reductions over all four lanes equal those over x, y and z.
+inline Float4 float4Load(const Vec3& v)
+{
+    Float4 xy = _mm_castpd_ps(_mm_load_sd((const double*)&v.x));
+    Float4 z = _mm_load1_ps(&v.z);
+    return _mm_movelh_ps(xy, z);
+}
+
+inline Float4 float4Load(const float* values) { return _mm_loadu_ps(values); }
+inline Float4 float4Splat(float value) { return _mm_set1_ps(value); }
+inline Float4 float4Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 float4Sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 float4Mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+// Min and max return b in lanes where either operand is NaN.
+inline Float4 float4Min(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+inline Float4 float4Max(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+inline Float4 float4LessMask(Float4 a, Float4 b) { return _mm_cmplt_ps(a, b); }
+// a in the lanes set in mask, b in the others.
+inline Float4 float4Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+// Bit i is set when lo[i] <= a[i] <= hi[i].
+inline int float4InRangeMask(Float4 a, Float4 lo, Float4 hi)
+{
+    return _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(a, lo), _mm_cmple_ps(a, hi)));
+}
+
+inline float float4HorizontalMin(Float4 a)
+{
+    a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+    a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(a);
+}
+
+inline float float4HorizontalMax(Float4 a)
+{
+    a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+    a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(a);
+}
+#elif defined(MATHUTILS_WASM_SIMD)
+typedef v128_t Float4;
+
+inline Float4 float4Load(const Vec3& v) { return wasm_f32x4_make(v.x, v.y, v.z, v.z); }
+inline Float4 float4Load(const float* values) { return wasm_v128_load(values); }
+inline Float4 float4Splat(float value) { return wasm_f32x4_splat(value); }
+inline Float4 float4Add(Float4 a, Float4 b) { return wasm_f32x4_add(a, b); }
+inline Float4 float4Sub(Float4 a, Float4 b) { return wasm_f32x4_sub(a, b); }
+inline Float4 float4Mul(Float4 a, Float4 b) { return wasm_f32x4_mul(a, b); }
+// pmin and pmax skip the NaN handling of min and max, so they lower to single instructions.
+// pmin(b, a) is a < b ? a : b, which returns b on NaN lanes like the SSE versions.
+inline Float4 float4Min(Float4 a, Float4 b) { return wasm_f32x4_pmin(b, a); }
+inline Float4 float4Max(Float4 a, Float4 b) { return wasm_f32x4_pmax(b, a); }
+inline Float4 float4LessMask(Float4 a, Float4 b) { return wasm_f32x4_lt(a, b); }
+inline Float4 float4Select(Float4 mask, Float4 a, Float4 b) { return wasm_v128_bitselect(a, b, mask); }
+
+inline int float4InRangeMask(Float4 a, Float4 lo, Float4 hi)
+{
+    return (int)wasm_i32x4_bitmask(wasm_v128_and(wasm_f32x4_ge(a, lo), wasm_f32x4_le(a, hi)));
+}
+
+inline float float4HorizontalMin(Float4 a)
+{
+    a = wasm_f32x4_pmin(a, wasm_i32x4_shuffle(a, a, 2, 3, 0, 1));
+    a = wasm_f32x4_pmin(a, wasm_i32x4_shuffle(a, a, 1, 0, 3, 2));
+    return wasm_f32x4_extract_lane(a, 0);
+}
+
+inline float float4HorizontalMax(Float4 a)
+{
+    a = wasm_f32x4_pmax(a, wasm_i32x4_shuffle(a, a, 2, 3, 0, 1));
+    a = wasm_f32x4_pmax(a, wasm_i32x4_shuffle(a, a, 1, 0, 3, 2));
+    return wasm_f32x4_extract_lane(a, 0);
+}
+#endif
+
 struct Intersection
 {
     bool hit;
@@ -266,12 +359,31 @@ struct Bounds
         return intersectRayInvDir(rayOrigin, invDir, tmin, tmax);
     }
 
+    /**
+     * With SIMD the slab test has no branches: a lane select on the sign of invDir picks the
+     * entry and exit plane of every axis. An origin on a plane of an axis with an infinite
+     * inverse gives a NaN distance, which the clamps against tmin and tmax drop like the
+     * scalar comparisons do.
+     */
     Intersection intersectRayInvDir(Vec3 rayOrigin, Vec3 invDir, float tmin, float tmax) const
     {
-        Vec3 corners[2] = {min, max};
         Intersection result;
         result.hit = false;
 
+#if defined(MATHUTILS_SSE) || defined(MATHUTILS_WASM_SIMD)
+        Float4 origin = float4Load(rayOrigin);
+        Float4 inverse = float4Load(invDir);
+        Float4 t0 = float4Mul(float4Sub(float4Load(min), origin), inverse);
+        Float4 t1 = float4Mul(float4Sub(float4Load(max), origin), inverse);
+        Float4 negative = float4LessMask(inverse, float4Splat(0.f));
+        Float4 entries = float4Select(negative, t1, t0);
+        Float4 exits = float4Select(negative, t0, t1);
+        float tNear = float4HorizontalMax(float4Max(entries, float4Splat(tmin)));
+        float tFar = float4HorizontalMin(float4Min(exits, float4Splat(tmax)));
+        tmin = tNear;
+        tmax = tFar;
+#else
+        Vec3 corners[2] = {min, max};
         for (int d = 0; d < 3; ++d) {
             int sign = invDir[d] < 0. ? 1 : 0;
             float bmin = corners[sign][d];
@@ -283,6 +395,7 @@ struct Bounds
             tmin = dmin > tmin ? dmin : tmin;
             tmax = dmax < tmax ? dmax : tmax;
         }
+#endif
 
         result.hit = tmin <= tmax;
         result.t = tmin;
@@ -309,6 +422,100 @@ struct Triangle
         return boundingBox().centroid();
     }
 
+    /**
+     * The bounds of the part of the triangle inside box, found by clipping the triangle
+     * against the six planes of box. Returns false when no part of it is inside.
+     */
+    bool clippedBounds(const Bounds& box, Bounds* result) const
+    {
+        // Each plane adds at most one vertex to the polygon.
+        Vec3 polygon[9] = {p1, p2, p3};
+        Vec3 clipped[9];
+        int count = 3;
+        for(int plane = 0; plane < 6 && count > 0; plane++)
+        {
+            int axis = plane % 3;
+            float sign = plane < 3 ? 1.f : -1.f;
+            float bound = plane < 3 ? box.min[axis] : box.max[axis];
+            int clippedCount = 0;
+            for(int i = 0; i < count; i++)
+            {
+                Vec3 a = polygon[i];
+                Vec3 b = polygon[(i + 1) % count];
+                float da = sign * (a[axis] - bound);
+                float db = sign * (b[axis] - bound);
+                if(da >= 0.f) clipped[clippedCount++] = a;
+                if((da < 0.f && db > 0.f) || (da > 0.f && db < 0.f))
+                {
+                    Vec3 p = a + (b - a) * (da / (da - db));
+                    p[axis] = bound;
+                    clipped[clippedCount++] = p;
+                }
+            }
+            count = clippedCount;
+            for(int i = 0; i < count; i++) polygon[i] = clipped[i];
+        }
+        if(count == 0) return false;
+        Bounds b;
+        b.min = polygon[0];
+        b.max = polygon[0];
+        for(int i = 1; i < count; i++) b.unionWithPoint(polygon[i]);
+        for(int axis = 0; axis < 3; axis++)
+        {
+            b.min[axis] = b.min[axis] > box.min[axis] ? b.min[axis] : box.min[axis];
+            b.max[axis] = b.max[axis] < box.max[axis] ? b.max[axis] : box.max[axis];
+        }
+        *result = b;
+        return true;
+    }
+
+    Vec3 closestPoint(Vec3 point) const
+    {
+        Vec3 ab = p2 - p1;
+        Vec3 ac = p3 - p1;
+        Vec3 ap = point - p1;
+        float d1 = dot(ab, ap);
+        float d2 = dot(ac, ap);
+        if(d1 <= 0.0f && d2 <= 0.0f) return p1;
+
+        Vec3 bp = point - p2;
+        float d3 = dot(ab, bp);
+        float d4 = dot(ac, bp);
+        if(d3 >= 0.0f && d4 <= d3) return p2;
+
+        float vc = d1 * d4 - d3 * d2;
+        if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            float v = d1 / (d1 - d3);
+            return p1 + ab * v;
+        }
+
+        Vec3 cp = point - p3;
+        float d5 = dot(ab, cp);
+        float d6 = dot(ac, cp);
+        if(d6 >= 0.0f && d5 <= d6) return p3;
+
+        float vb = d5 * d2 - d1 * d6;
+        if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            float w = d2 / (d2 - d6);
+            return p1 + ac * w;
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        {
+            float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return p2 + (p3 - p2) * w;
+        }
+
+        float denom = 1.0f / (va + vb + vc);
+        if(!(denom == denom) || std::isinf(denom)) return p1;
+        float v = vb * denom;
+        float w = vc * denom;
+        return p1 + ab * v + ac * w;
+    }
+
     Intersection intersectRay(Vec3 rayOrigin, Vec3 rayDir, float tMin, float tMax) {
         Vec3 edge1 = p3 - p1;
         Vec3 edge2 = p2 - p1;
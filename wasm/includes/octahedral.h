@@ -0,0 +1,63 @@
+#ifndef OCTAHEDRAL_H
+#define OCTAHEDRAL_H
+#include "mathutils.h"
+#include <cmath>
+
+/**
+ * Octahedral unit vector encoding with an occupancy bit folded into bit 0.
+ *
+ * A packed voxel is laid out as [occupied:1][x:bitsPerAxis][y:bitsPerAxis] from the least
+ * significant bit up. With bitsPerAxis = 15 a voxel fills one R32UI texel, and read as
+ * RG16UI the R channel holds (x << 1 | occupied) while G holds y. With bitsPerAxis = 7 a
+ * voxel fills one R16UI texel. Empty voxels always pack to 0.
+ */
+
+float octahedralSign(float v)
+{
+    return v < 0.f ? -1.f : 1.f;
+}
+
+Vec3 octahedralToUnit(float u, float v)
+{
+    Vec3 n(u, v, 1.f - std::fabs(u) - std::fabs(v));
+    if(n.z < 0)
+    {
+        float x = n.x;
+        n.x = (1.f - std::fabs(n.y)) * octahedralSign(x);
+        n.y = (1.f - std::fabs(x)) * octahedralSign(n.y);
+    }
+    float l = n.length();
+    return l > 0 ? n / l : Vec3(0, 0, 1);
+}
+
+unsigned int packOctahedral(Vec3 normal, bool occupied, int bitsPerAxis)
+{
+    if(!occupied) return 0;
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    float u = 0, v = 0;
+    if(l1 > 0)
+    {
+        u = normal.x / l1;
+        v = normal.y / l1;
+        if(normal.z < 0)
+        {
+            float pu = u;
+            u = (1.f - std::fabs(v)) * octahedralSign(pu);
+            v = (1.f - std::fabs(pu)) * octahedralSign(v);
+        }
+    }
+    unsigned int maxValue = (1u << bitsPerAxis) - 1;
+    unsigned int qu = (unsigned int)std::lround((u * 0.5f + 0.5f) * maxValue);
+    unsigned int qv = (unsigned int)std::lround((v * 0.5f + 0.5f) * maxValue);
+    return 1u | (qu << 1) | (qv << (1 + bitsPerAxis));
+}
+
+bool unpackOctahedral(unsigned int packed, int bitsPerAxis, Vec3* normal)
+{
+    unsigned int maxValue = (1u << bitsPerAxis) - 1;
+    float u = (float)((packed >> 1) & maxValue) / maxValue * 2.f - 1.f;
+    float v = (float)((packed >> (1 + bitsPerAxis)) & maxValue) / maxValue * 2.f - 1.f;
+    *normal = octahedralToUnit(u, v);
+    return (packed & 1u) != 0;
+}
+#endif
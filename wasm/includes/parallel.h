@@ -0,0 +1,159 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <atomic>
+
+// Worker threads are only available natively or in emscripten builds with -pthread;
+// a plain wasm build runs every parallelFor on the calling thread.
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define PARALLEL_USE_THREADS
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+int parallelThreadCount()
+{
+#ifdef PARALLEL_USE_THREADS
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : (int)count;
+#else
+    return 1;
+#endif
+}
+
+#ifdef PARALLEL_USE_THREADS
+/**
+ * parallelThreadCount() - 1 threads started on first use that live until exit, so that
+ * callers like the slab by slab distance field sweep can run thousands of short
+ * parallelFor calls without starting threads for each. run() hands the same job to every
+ * worker and the calling thread and returns once all of them are done with it. Jobs run
+ * one at a time; a parallelFor from inside a job runs on the thread that calls it.
+ */
+class ParallelPool
+{
+public:
+    static ParallelPool& instance()
+    {
+        static ParallelPool pool(parallelThreadCount() - 1);
+        return pool;
+    }
+
+    static bool insideJob()
+    {
+        return jobDepth() > 0;
+    }
+
+    void run(const std::function<void()>& job)
+    {
+        std::lock_guard<std::mutex> runLock(runMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &job;
+            pending = (int)threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        execute(job);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return pending == 0; });
+        current = nullptr;
+    }
+
+    ~ParallelPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+private:
+    explicit ParallelPool(int workerCount)
+    {
+        for(int t = 0; t < workerCount; t++)
+        {
+            threads.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    static int& jobDepth()
+    {
+        static thread_local int depth = 0;
+        return depth;
+    }
+
+    static void execute(const std::function<void()>& job)
+    {
+        jobDepth()++;
+        job();
+        jobDepth()--;
+    }
+
+    void workerLoop()
+    {
+        unsigned long long seen = 0;
+        while(true)
+        {
+            const std::function<void()>* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if(stopping) return;
+                seen = generation;
+                job = current;
+            }
+            execute(*job);
+            std::lock_guard<std::mutex> lock(mutex);
+            if(--pending == 0) done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex runMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void()>* current = nullptr;
+    unsigned long long generation = 0;
+    int pending = 0;
+    bool stopping = false;
+};
+#endif
+
+/**
+ * Calls fn(i) for every i in [begin, end). Indices are handed out in chunks of grainSize
+ * from a shared counter, so uneven iterations balance across the workers of ParallelPool.
+ */
+template <typename F>
+void parallelFor(int begin, int end, F fn, int grainSize = 1)
+{
+    if(end <= begin) return;
+    std::atomic<int> next(begin);
+    std::function<void()> worker = [&]()
+    {
+        while(true)
+        {
+            int start = next.fetch_add(grainSize);
+            if(start >= end) break;
+            int stop = start + grainSize < end ? start + grainSize : end;
+            for(int i = start; i < stop; i++) fn(i);
+        }
+    };
+#ifdef PARALLEL_USE_THREADS
+    int chunkCount = (end - begin + grainSize - 1) / grainSize;
+    if(chunkCount > 1 && parallelThreadCount() > 1 && !ParallelPool::insideJob())
+    {
+        ParallelPool::instance().run(worker);
+        return;
+    }
+#endif
+    worker();
+}
+#endif
@@ -0,0 +1,220 @@
+#ifndef QEF_H
+#define QEF_H
+#include "mathutils.h"
+#include <cmath>
+
+#define QEF_SVD_SWEEPS 8
+#define QEF_PSEUDO_INVERSE_TOLERANCE 0.001
+
+/**
+ * Quadratic error function sum((n_i . (x - p_i))^2) over Hermite samples (p_i, n_i), kept
+ * as the normal equations AtA, Atb and btb so it takes constant memory per voxel.
+ */
+struct QEF
+{
+    double ata[3][3];
+    double atb[3];
+    double btb;
+    Vec3 pointSum;
+    int pointCount;
+
+    QEF()
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            for(int j = 0; j < 3; j++) ata[i][j] = 0;
+            atb[i] = 0;
+        }
+        btb = 0;
+        pointCount = 0;
+    }
+
+    void addPlane(Vec3 point, Vec3 normal)
+    {
+        double n[3] = {normal.x, normal.y, normal.z};
+        double d = normal.dot(point);
+        for(int i = 0; i < 3; i++)
+        {
+            for(int j = 0; j < 3; j++) ata[i][j] += n[i] * n[j];
+            atb[i] += n[i] * d;
+        }
+        btb += d * d;
+    }
+
+    void addIntersection(Vec3 point, Vec3 normal)
+    {
+        addPlane(point, normal);
+        pointSum.add(point);
+        pointCount++;
+    }
+
+    Vec3 massPoint() const
+    {
+        return pointCount > 0 ? pointSum / (float)pointCount : Vec3(0, 0, 0);
+    }
+
+    // Pulls the solution towards the mass point with three axis-aligned planes through it.
+    void addMassPointBias(float strength)
+    {
+        Vec3 mass = massPoint();
+        addPlane(mass, Vec3(strength, 0, 0));
+        addPlane(mass, Vec3(0, strength, 0));
+        addPlane(mass, Vec3(0, 0, strength));
+    }
+
+    double evaluate(Vec3 point) const
+    {
+        double x[3] = {point.x, point.y, point.z};
+        double error = btb;
+        for(int i = 0; i < 3; i++)
+        {
+            error -= 2 * x[i] * atb[i];
+            for(int j = 0; j < 3; j++) error += x[i] * ata[i][j] * x[j];
+        }
+        return error;
+    }
+
+    /**
+     * Minimizes the QEF with the axes set in fixedMask held at fixedValues. The free axes are
+     * solved around the mass point with a truncated pseudo-inverse from a Jacobi SVD of the
+     * (symmetric) reduced AtA, so rank deficient systems such as flat or creased surfaces
+     * stay stable.
+     */
+    Vec3 solve(int fixedMask = 0, Vec3 fixedValues = Vec3()) const
+    {
+        Vec3 mass = massPoint();
+        double center[3] = {mass.x, mass.y, mass.z};
+        double fixed[3] = {fixedValues.x, fixedValues.y, fixedValues.z};
+        int freeAxes[3];
+        int n = 0;
+        for(int i = 0; i < 3; i++)
+        {
+            if(fixedMask & (1 << i)) center[i] = fixed[i];
+            else freeAxes[n++] = i;
+        }
+        Vec3 result((float)center[0], (float)center[1], (float)center[2]);
+        if(n == 0) return result;
+
+        // Reduced system in coordinates relative to the center: A_ff y = Atb_f - (AtA c)_f
+        double a[3][3], rhs[3];
+        for(int r = 0; r < n; r++)
+        {
+            int i = freeAxes[r];
+            rhs[r] = atb[i];
+            for(int k = 0; k < 3; k++) rhs[r] -= ata[i][k] * center[k];
+            for(int c = 0; c < n; c++) a[r][c] = ata[i][freeAxes[c]];
+        }
+
+        double v[3][3];
+        for(int i = 0; i < n; i++)
+        {
+            for(int j = 0; j < n; j++) v[i][j] = i == j ? 1 : 0;
+        }
+        for(int sweep = 0; sweep < QEF_SVD_SWEEPS; sweep++)
+        {
+            double offDiagonal = 0;
+            for(int p = 0; p < n; p++)
+            {
+                for(int q = p + 1; q < n; q++) offDiagonal += a[p][q] * a[p][q];
+            }
+            if(offDiagonal < 1e-24) break;
+            for(int p = 0; p < n; p++)
+            {
+                for(int q = p + 1; q < n; q++)
+                {
+                    if(a[p][q] == 0) continue;
+                    double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                    double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                    double c = 1 / std::sqrt(t * t + 1);
+                    double s = t * c;
+                    for(int k = 0; k < n; k++)
+                    {
+                        double akp = a[k][p];
+                        double akq = a[k][q];
+                        a[k][p] = c * akp - s * akq;
+                        a[k][q] = s * akp + c * akq;
+                    }
+                    for(int k = 0; k < n; k++)
+                    {
+                        double apk = a[p][k];
+                        double aqk = a[q][k];
+                        a[p][k] = c * apk - s * aqk;
+                        a[q][k] = s * apk + c * aqk;
+                    }
+                    for(int k = 0; k < n; k++)
+                    {
+                        double vkp = v[k][p];
+                        double vkq = v[k][q];
+                        v[k][p] = c * vkp - s * vkq;
+                        v[k][q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+
+        double maxSingular = 0;
+        for(int i = 0; i < n; i++) maxSingular = std::fmax(maxSingular, std::fabs(a[i][i]));
+        double y[3] = {0, 0, 0};
+        for(int k = 0; k < n; k++)
+        {
+            double sigma = a[k][k];
+            if(std::fabs(sigma) <= QEF_PSEUDO_INVERSE_TOLERANCE * maxSingular || sigma == 0) continue;
+            double projection = 0;
+            for(int i = 0; i < n; i++) projection += v[i][k] * rhs[i];
+            projection /= sigma;
+            for(int i = 0; i < n; i++) y[i] += v[i][k] * projection;
+        }
+        double solution[3] = {center[0], center[1], center[2]};
+        for(int r = 0; r < n; r++) solution[freeAxes[r]] += y[r];
+        return Vec3((float)solution[0], (float)solution[1], (float)solution[2]);
+    }
+
+    /**
+     * Solves the QEF inside the cube [-halfSize, halfSize]^3. If the free minimizer is
+     * outside, the best constrained minimizer on the cube faces, then edges, then corners is
+     * used, and the result is clamped to the cube.
+     */
+    Vec3 solveInCube(float halfSize) const
+    {
+        auto inside = [halfSize](Vec3 p)
+        {
+            return std::fabs(p.x) <= halfSize && std::fabs(p.y) <= halfSize && std::fabs(p.z) <= halfSize;
+        };
+        Vec3 best = solve();
+        if(!inside(best))
+        {
+            bool found = false;
+            double bestError = 0;
+            for(int fixedCount = 1; fixedCount <= 3 && !found; fixedCount++)
+            {
+                for(int mask = 1; mask < 8; mask++)
+                {
+                    int bits = (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1);
+                    if(bits != fixedCount) continue;
+                    for(int signs = 0; signs < 8; signs++)
+                    {
+                        if((signs & ~mask) != 0) continue;
+                        Vec3 fixedValues(
+                            (signs & 1) ? halfSize : -halfSize,
+                            (signs & 2) ? halfSize : -halfSize,
+                            (signs & 4) ? halfSize : -halfSize);
+                        Vec3 candidate = solve(mask, fixedValues);
+                        if(!inside(candidate)) continue;
+                        double error = evaluate(candidate);
+                        if(!found || error < bestError)
+                        {
+                            best = candidate;
+                            bestError = error;
+                            found = true;
+                        }
+                    }
+                }
+            }
+        }
+        best.x = std::fmax(-halfSize, std::fmin(halfSize, best.x));
+        best.y = std::fmax(-halfSize, std::fmin(halfSize, best.y));
+        best.z = std::fmax(-halfSize, std::fmin(halfSize, best.z));
+        return best;
+    }
+};
+#endif
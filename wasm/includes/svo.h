@@ -1,135 +1,304 @@
 #ifndef SVO_H
 #define SVO_H
 #include "mathutils.h"
+#include "octahedral.h"
+#include <cstdint>
+#include <vector>
 
-#define SIMPLIFY_THRESHOLD 5
+#define SVO_MAX_MORTON_DEPTH 21
 
+// Bits of the packed node word of the encoded SVO, see encodeSVO in voxelGrid.cpp. The far
+// flag takes the top bit so that words without it keep the childOffset << 9 layout.
+#define SVO_LEAF_BIT (1u << 8)
+#define SVO_CHILD_OFFSET_SHIFT 9
+#define SVO_FAR_BIT (1u << 31)
+#define SVO_CHILD_OFFSET(word) (((word) & ~SVO_FAR_BIT) >> SVO_CHILD_OFFSET_SHIFT)
+#ifndef SVO_MAX_CHILD_OFFSET
+#define SVO_MAX_CHILD_OFFSET ((1 << 22) - 1)
+#endif
+// A leaf's topology word in the split stream encoding (encodeSVOStreams in voxelGrid.cpp)
+// holds its attribute index in every bit but SVO_LEAF_BIT.
+#define SVO_PACK_LEAF_ATTRIBUTE(index) (SVO_LEAF_BIT | ((index) & 0xFFu) | (((index) >> 8) << 9))
+#define SVO_LEAF_ATTRIBUTE(word) (((word) & 0xFFu) | (((word) >> 9) << 8))
+// Rope words (computeSVORopes in voxelGrid.cpp), six per entry in the face order -x, +x,
+// -y, +y, -z, +z: the entry index of the neighbor node and how many levels above the
+// node it is, or SVO_NO_ROPE at the root's boundary.
+#define SVO_ROPE_INDEX_BITS 27
+#define SVO_MAX_ROPE_INDEX ((1u << SVO_ROPE_INDEX_BITS) - 1)
+#define SVO_NO_ROPE 0xFFFFFFFFu
+#define SVO_PACK_ROPE(index, levelsUp) ((uint32_t)(index) | ((uint32_t)(levelsUp) << SVO_ROPE_INDEX_BITS))
+#define SVO_ROPE_INDEX(word) ((word) & SVO_MAX_ROPE_INDEX)
+#define SVO_ROPE_LEVELS_UP(word) ((word) >> SVO_ROPE_INDEX_BITS)
+
+/**
+ * Morton codes interleave x, y and z starting at bit 0, so the three bits of every level
+ * are a child index in the same order as SVO::pointIndex. 21 bits per axis fit in 64 bits.
+ */
+uint64_t spreadMortonBits(uint32_t value)
+{
+    uint64_t v = value & 0x1FFFFF;
+    v = (v | v << 32) & 0x1F00000000FFFFull;
+    v = (v | v << 16) & 0x1F0000FF0000FFull;
+    v = (v | v << 8) & 0x100F00F00F00F00Full;
+    v = (v | v << 4) & 0x10C30C30C30C30C3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+uint32_t compactMortonBits(uint64_t v)
+{
+    v &= 0x1249249249249249ull;
+    v = (v ^ (v >> 2)) & 0x10C30C30C30C30C3ull;
+    v = (v ^ (v >> 4)) & 0x100F00F00F00F00Full;
+    v = (v ^ (v >> 8)) & 0x1F0000FF0000FFull;
+    v = (v ^ (v >> 16)) & 0x1F00000000FFFFull;
+    v = (v ^ (v >> 32)) & 0x1FFFFFull;
+    return (uint32_t)v;
+}
+
+uint64_t encodeMorton(uint32_t x, uint32_t y, uint32_t z)
+{
+    return spreadMortonBits(x) | (spreadMortonBits(y) << 1) | (spreadMortonBits(z) << 2);
+}
+
+void decodeMorton(uint64_t code, uint32_t* x, uint32_t* y, uint32_t* z)
+{
+    *x = compactMortonBits(code);
+    *y = compactMortonBits(code >> 1);
+    *z = compactMortonBits(code >> 2);
+}
+
+/**
+ * The nodes of one octree level sorted by Morton code. A node without children is a leaf.
+ * The children of node i are the popcount(childMasks[i]) consecutive nodes of the next
+ * level starting at firstChild[i], so concatenating the levels from the root down gives
+ * the breadth-first order with children in child index order.
+ */
+struct SVOLevel
+{
+    std::vector<uint64_t> codes;
+    std::vector<uint8_t> childMasks;
+    std::vector<uint32_t> firstChild;
+    std::vector<Vec3> normals;
+
+    int size() const
+    {
+        return (int)codes.size();
+    }
+};
+
+enum SVOAttributeFormat
+{
+    // packOctahedral(normal, true, 15)
+    OctahedralNormal = 0,
+    // Vertex inside the node cube as 11:11:10 bit fixed point fractions of x, y and z.
+    CubeRelativeVertex = 1
+};
+
+uint32_t packCubeRelativeVertex(Vec3 vertex, Vec3 cubeMin, float cubeSize)
+{
+    Vec3 relative = (vertex - cubeMin) / cubeSize;
+    auto quantize = [](float v, int bits)
+    {
+        float maxValue = (float)((1u << bits) - 1);
+        return (uint32_t)std::lround(std::fmax(0.f, std::fmin(1.f, v)) * maxValue);
+    };
+    return quantize(relative.x, 11) | (quantize(relative.y, 11) << 11) | (quantize(relative.z, 10) << 22);
+}
+
+Vec3 unpackCubeRelativeVertex(uint32_t packed, Vec3 cubeMin, float cubeSize)
+{
+    Vec3 relative((packed & 0x7FF) / 2047.f, ((packed >> 11) & 0x7FF) / 2047.f, (packed >> 22) / 1023.f);
+    return cubeMin + relative * cubeSize;
+}
+
+/**
+ * Quantizes the attribute of node i of a level that lies levelsBelow levels above the
+ * leaves into one word of attributeFormat. rootMin and leafSize place the node cube for
+ * CubeRelativeVertex.
+ */
+uint32_t packSVOAttribute(const SVOLevel& level, int i, int levelsBelow, int attributeFormat, Vec3 rootMin, float leafSize)
+{
+    if(attributeFormat != CubeRelativeVertex) return packOctahedral(level.normals[i], true, 15);
+    uint32_t x, y, z;
+    decodeMorton(level.codes[i], &x, &y, &z);
+    float cubeSize = leafSize * (float)(1u << levelsBelow);
+    Vec3 cubeMin = rootMin + Vec3(x * cubeSize, y * cubeSize, z * cubeSize);
+    return packCubeRelativeVertex(level.normals[i], cubeMin, cubeSize);
+}
+
+/**
+ * Builds the parent level of a Morton-sorted level: runs of codes sharing code >> 3 become
+ * one parent whose normal is the average of its children.
+ */
+SVOLevel buildParentLevel(const SVOLevel& children)
+{
+    SVOLevel parents;
+    int childCount = 0;
+    for(int i = 0; i < children.size(); i++)
+    {
+        uint64_t parentCode = children.codes[i] >> 3;
+        if(parents.codes.empty() || parents.codes.back() != parentCode)
+        {
+            if(childCount > 0) parents.normals.back() = parents.normals.back() / (float)childCount;
+            parents.codes.push_back(parentCode);
+            parents.childMasks.push_back(0);
+            parents.firstChild.push_back((uint32_t)i);
+            parents.normals.push_back(Vec3(0, 0, 0));
+            childCount = 0;
+        }
+        parents.childMasks.back() |= 1 << (children.codes[i] & 7);
+        parents.normals.back().add(children.normals[i]);
+        childCount++;
+    }
+    if(childCount > 0) parents.normals.back() = parents.normals.back() / (float)childCount;
+    return parents;
+}
+
+/**
+ * Assembles an octree of the given depth bottom-up from its Morton-sorted, duplicate free
+ * leaves. levels[0] is the root and levels[depth] holds the leaves.
+ */
+std::vector<SVOLevel> buildSVOLevels(SVOLevel leaves, int depth)
+{
+    std::vector<SVOLevel> levels(depth + 1);
+    leaves.childMasks.assign(leaves.size(), 0);
+    leaves.firstChild.assign(leaves.size(), 0);
+    levels[depth] = std::move(leaves);
+    for(int d = depth - 1; d >= 0; d--)
+    {
+        levels[d] = buildParentLevel(levels[d + 1]);
+    }
+    return levels;
+}
+
+/**
+ * An octree node in an SVO pool. Children are 32-bit indices into the pool, and 0 means
+ * no child since the root, node 0, is never a child. Bounds are not stored; they follow
+ * from the node's depth and voxel position.
+ */
+struct SVONode
+{
+    uint32_t children[8];
+    Vec3 normal;
+    uint8_t depth;
+    bool isLeaf;
+};
+
+/**
+ * Sparse voxel octree whose nodes live in one pool, so building a tree costs a handful of
+ * vector growths instead of one allocation per node and releasing it is a single clear().
+ * Node depth counts levels above the leaves, the root has the tree depth. EditableSVO
+ * (svoedit.h) keeps its tree in this form; the one-shot builders use SVOLevel instead.
+ */
 struct SVO
 {
 public:
     Vec3 min, max;
     int depth;
-    SVO* children[8];
-    Vec3 normal;
-    bool isLeaf;
+    std::vector<SVONode> nodes;
+    std::vector<uint32_t> freeNodes;
 
     SVO(Vec3 min, Vec3 max, int depth)
     {
         this->min = min;
         this->max = max;
         this->depth = depth;
+        createNode(depth);
+    }
+
+    uint32_t createNode(int nodeDepth)
+    {
+        SVONode node;
         for(int i = 0; i < 8; i++)
         {
-            children[i] = nullptr;
+            node.children[i] = 0;
+        }
+        node.normal.zero();
+        node.depth = (uint8_t)nodeDepth;
+        node.isLeaf = nodeDepth == 0;
+        if(!freeNodes.empty())
+        {
+            uint32_t index = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[index] = node;
+            return index;
         }
-        this->normal.zero();
-        this->isLeaf = depth == 0;
+        nodes.push_back(node);
+        return (uint32_t)nodes.size() - 1;
     }
 
-    int pointIndex(const Vec3 point) const
+    static int childIndex(uint32_t x, uint32_t y, uint32_t z, int nodeDepth)
     {
-        int index = 0;
-        if(point.x > (min.x + max.x) / 2) index |= 1;
-        if(point.y > (min.y + max.y) / 2) index |= 2;
-        if(point.z > (min.z + max.z) / 2) index |= 4;
-        return index;
+        int shift = nodeDepth - 1;
+        return ((x >> shift) & 1) | (((y >> shift) & 1) << 1) | (((z >> shift) & 1) << 2);
     }
 
-    void simpifyVoxel(int parentDepth, int* removeCount)
+    void insertVoxel(uint32_t x, uint32_t y, uint32_t z, Vec3 averageNormal)
     {
-        if(isLeaf) return;
-        bool fullChild = true;
-        for(int i = 0; i < 8; i++)
+        uint32_t index = 0;
+        for(int d = depth; d > 0; d--)
         {
-            if(children[i] != nullptr)
-            {
-                children[i]->simpifyVoxel(parentDepth, removeCount);
-            }
-            else
+            int child = childIndex(x, y, z, d);
+            if(nodes[index].children[child] == 0)
             {
-                fullChild = false;
+                uint32_t created = createNode(d - 1);
+                nodes[index].children[child] = created;
             }
+            index = nodes[index].children[child];
         }
-        fullChild = parentDepth - depth >= SIMPLIFY_THRESHOLD || fullChild;
-        if(!fullChild) return;
-        bool hasNormal = false;
-        bool allSimilar = true;
-        Vec3 averageNormal;
-        for(int i = 0; i < 8; i++)
-        {
-            SVO* child = children[i];
-            if(child == nullptr) continue;
-            if(!child->isLeaf)
-            {
-                allSimilar = false;
-                break;
-            }
-            if(!hasNormal)
-            {
-                averageNormal = child->normal;
-                hasNormal = true;
-                continue;
-            }
-            float dot = averageNormal.dot(child->normal);
-            if(dot < 0.9f)
-            {
-                allSimilar = false;
-                break;
-            }
-        }
-        if(!allSimilar) return;
-        for(int i = 0; i < 8; i++)
-        {
-            if(children[i] != nullptr)
-            {
-                delete children[i];
-                children[i] = nullptr;
-                (*removeCount)++;
-            }
-        }
-        this->isLeaf = true;
-        this->normal = averageNormal;
+        nodes[index].normal = averageNormal;
     }
 
-    void createChild(int index)
+    // Returns the leaf at voxel (x, y, z) through index, or false when there is none.
+    bool findVoxel(uint32_t x, uint32_t y, uint32_t z, uint32_t* index) const
     {
-        Vec3 newMin, newMax;
-        newMin.zero();
-        newMax.zero();
-        Vec3 mid = (min + max) / 2;
-        for(int i = 0; i < 3; i++)
+        uint32_t node = 0;
+        for(int d = depth; d > 0; d--)
         {
-            bool shifted = (index & (1 << i)) != 0;
-            newMin[i] = shifted ? mid[i] : min[i];
-            newMax[i] = shifted ? max[i] : mid[i];
+            node = nodes[node].children[childIndex(x, y, z, d)];
+            if(node == 0) return false;
         }
-        SVO* child = new SVO(newMin, newMax, depth - 1);
-        children[index] = child;
+        *index = node;
+        return true;
     }
 
-    void insertVoxel(Vec3 center, Vec3 averageNormal, int* nodeCount)
+    /**
+     * Removes the leaf at voxel (x, y, z) along with every ancestor it leaves without
+     * children, up to but not including the root, and appends the released nodes to
+     * released. Returns false when there is no such leaf.
+     */
+    bool removeVoxel(uint32_t x, uint32_t y, uint32_t z, std::vector<uint32_t>* released)
     {
-        if(depth == 0)
+        if(depth == 0) return false;
+        std::vector<uint32_t> path(depth + 1);
+        uint32_t index = 0;
+        for(int d = depth; d > 0; d--)
         {
-            normal = averageNormal;
-            return;
+            path[d] = index;
+            index = nodes[index].children[childIndex(x, y, z, d)];
+            if(index == 0) return false;
         }
-        int index = pointIndex(center);
-        if(children[index] == nullptr)
+        for(int d = 1; d <= depth; d++)
         {
-            createChild(index);
-            (*nodeCount)++;
+            SVONode& parent = nodes[path[d]];
+            parent.children[childIndex(x, y, z, d)] = 0;
+            freeNodes.push_back(index);
+            released->push_back(index);
+            bool empty = true;
+            for(int i = 0; i < 8 && empty; i++) empty = parent.children[i] == 0;
+            if(!empty || d == depth) break;
+            index = path[d];
         }
-        children[index]->insertVoxel(center, averageNormal, nodeCount);
+        return true;
     }
 
-    ~SVO()
+    // Releases every node at once, leaving an empty root.
+    void clear()
     {
-        for(int i = 0; i < 8; i++)
-        {
-            if(children[i] != nullptr)
-                delete children[i];
-        }
+        nodes.clear();
+        freeNodes.clear();
+        createNode(depth);
     }
 };
 #endif
\ No newline at end of file
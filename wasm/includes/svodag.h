@@ -0,0 +1,282 @@
+#ifndef SVODAG_H
+#define SVODAG_H
+#include "mathutils.h"
+#include "octahedral.h"
+#include "svo.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Sparse voxel DAG: an octree whose identical subtrees are stored once.
+ *
+ * Nodes are variable sized runs of uint32 words, the root at word 0:
+ * [childMask | isLeaf << 8][child word index] x k [leaf offset of child j] for j = 1..k-1
+ * with k = popcount(childMask). Leaves carry no data, so every leaf is the same node.
+ * Attributes live in a separate stream with one word per leaf in depth-first order; a
+ * child's leaf offset is the number of leaves in the siblings before it, so a traversal
+ * finds the attribute index of a leaf by summing the offsets along its path. Identical
+ * subtrees have identical leaf offsets, which is what makes them shareable.
+ */
+
+#define SVODAG_LEAF_BIT (1u << 8)
+
+struct SVODAGNodeKey
+{
+    std::vector<uint32_t> words;
+
+    bool operator==(const SVODAGNodeKey& other) const
+    {
+        return words == other.words;
+    }
+};
+
+struct SVODAGNodeKeyHash
+{
+    size_t operator()(const SVODAGNodeKey& key) const
+    {
+        uint64_t hash = 1469598103934665603ull;
+        for(uint32_t word : key.words)
+        {
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+        return (size_t)hash;
+    }
+};
+
+struct SVODAG
+{
+    std::vector<uint32_t> nodes;
+    std::vector<uint32_t> attributes;
+    int uniqueNodeCount;
+};
+
+/**
+ * Merges identical subtrees of the levels bottom-up. A subtree is identified by its child
+ * mask and the ids of its children, hashed across all levels, so equal shapes share a node
+ * even at different depths. Leaf attributes are quantized into attributeFormat; rootMin
+ * and leafSize place the leaf cubes for CubeRelativeVertex.
+ */
+SVODAG buildSVODAG(const std::vector<SVOLevel>& levels, int attributeFormat, Vec3 rootMin, float leafSize)
+{
+    int depth = (int)levels.size() - 1;
+    std::vector<SVODAGNodeKey> uniqueNodes;
+    std::vector<uint32_t> uniqueLeafCounts;
+    std::unordered_map<SVODAGNodeKey, uint32_t, SVODAGNodeKeyHash> ids;
+    std::vector<std::vector<uint32_t>> levelIds(levels.size());
+    auto internNode = [&](SVODAGNodeKey& key, uint32_t leafCount)
+    {
+        auto found = ids.find(key);
+        if(found != ids.end()) return found->second;
+        uint32_t id = (uint32_t)uniqueNodes.size();
+        ids.emplace(key, id);
+        uniqueNodes.push_back(key);
+        uniqueLeafCounts.push_back(leafCount);
+        return id;
+    };
+    for(int d = depth; d >= 0; d--)
+    {
+        const SVOLevel& level = levels[d];
+        levelIds[d].resize(level.size());
+        for(int i = 0; i < level.size(); i++)
+        {
+            SVODAGNodeKey key;
+            uint32_t leafCount = 1;
+            if(level.childMasks[i] == 0)
+            {
+                key.words.push_back(SVODAG_LEAF_BIT);
+            }
+            else
+            {
+                key.words.push_back(level.childMasks[i]);
+                leafCount = 0;
+                int first = level.firstChild[i];
+                int last = first + __builtin_popcount(level.childMasks[i]);
+                for(int c = first; c < last; c++)
+                {
+                    uint32_t childId = levelIds[d + 1][c];
+                    key.words.push_back(childId);
+                    leafCount += uniqueLeafCounts[childId];
+                }
+            }
+            levelIds[d][i] = internNode(key, leafCount);
+        }
+    }
+
+    // Lay the unique nodes out breadth-first from the root and resolve ids to word indices.
+    SVODAG dag;
+    dag.uniqueNodeCount = (int)uniqueNodes.size();
+    std::vector<bool> visited(uniqueNodes.size(), false);
+    std::vector<uint32_t> order;
+    uint32_t rootId = levelIds[0][0];
+    order.push_back(rootId);
+    visited[rootId] = true;
+    for(size_t o = 0; o < order.size(); o++)
+    {
+        const SVODAGNodeKey& node = uniqueNodes[order[o]];
+        for(size_t c = 1; c < node.words.size(); c++)
+        {
+            uint32_t childId = node.words[c];
+            if(visited[childId]) continue;
+            visited[childId] = true;
+            order.push_back(childId);
+        }
+    }
+    std::vector<int64_t> wordIndex(uniqueNodes.size(), -1);
+    int64_t wordCount = 0;
+    for(uint32_t id : order)
+    {
+        wordIndex[id] = wordCount;
+        int childCount = (int)uniqueNodes[id].words.size() - 1;
+        wordCount += childCount == 0 ? 1 : 2 * childCount;
+    }
+    dag.nodes.resize(wordCount);
+    for(uint32_t id : order)
+    {
+        const SVODAGNodeKey& node = uniqueNodes[id];
+        uint32_t* out = dag.nodes.data() + wordIndex[id];
+        int childCount = (int)node.words.size() - 1;
+        out[0] = node.words[0];
+        uint32_t leafOffset = 0;
+        for(int c = 0; c < childCount; c++)
+        {
+            uint32_t childId = node.words[1 + c];
+            out[1 + c] = (uint32_t)wordIndex[childId];
+            if(c > 0) out[childCount + c] = leafOffset;
+            leafOffset += uniqueLeafCounts[childId];
+        }
+    }
+
+    // Attributes in depth-first leaf order, which is the order of the leaf corners' Morton
+    // codes at full depth.
+    std::vector<std::pair<uint64_t, std::pair<int, int>>> leaves;
+    for(int d = 0; d <= depth; d++)
+    {
+        for(int i = 0; i < levels[d].size(); i++)
+        {
+            if(levels[d].childMasks[i] == 0) leaves.push_back({levels[d].codes[i] << (3 * (depth - d)), {d, i}});
+        }
+    }
+    std::sort(leaves.begin(), leaves.end());
+    dag.attributes.resize(leaves.size());
+    for(size_t l = 0; l < leaves.size(); l++)
+    {
+        int d = leaves[l].second.first;
+        int i = leaves[l].second.second;
+        dag.attributes[l] = packSVOAttribute(levels[d], i, depth - d, attributeFormat, rootMin, leafSize);
+    }
+    return dag;
+}
+
+struct SVODAGHit
+{
+    bool hit;
+    float t;
+    int attributeIndex;
+    Vec3 cubeMin;
+    float cubeSize;
+};
+
+/**
+ * CPU reference traversal of a sparse voxel DAG whose root cube starts at min with edge
+ * length size and has depth levels below the root.
+ */
+struct SVODAGTraversal
+{
+    const uint32_t* nodes;
+    int depth;
+    Vec3 min;
+    float size;
+
+    /**
+     * Returns the attribute index of the leaf containing voxel (x, y, z) of the full depth
+     * grid, or -1 when the voxel is empty. level receives the depth of the leaf.
+     */
+    int lookup(uint32_t x, uint32_t y, uint32_t z, int* level) const
+    {
+        uint32_t node = 0;
+        int attributeIndex = 0;
+        for(int d = 0; d <= depth; d++)
+        {
+            uint32_t header = nodes[node];
+            if(header & SVODAG_LEAF_BIT)
+            {
+                *level = d;
+                return attributeIndex;
+            }
+            if(d == depth) break;
+            int shift = depth - d - 1;
+            int child = ((x >> shift) & 1) | (((y >> shift) & 1) << 1) | (((z >> shift) & 1) << 2);
+            uint32_t childMask = header & 0xFF;
+            if((childMask & (1u << child)) == 0) break;
+            int rank = __builtin_popcount(childMask & ((1u << child) - 1));
+            int childCount = __builtin_popcount(childMask);
+            if(rank > 0) attributeIndex += nodes[node + childCount + rank];
+            node = nodes[node + 1 + rank];
+        }
+        return -1;
+    }
+
+    /**
+     * Nearest leaf along the ray within [0, tMax]. Children are visited depth-first in the
+     * order i ^ mirrorMask, which is front to back for every ray in the octant mirrorMask
+     * flips to positive directions.
+     */
+    SVODAGHit castRay(Vec3 origin, Vec3 direction, float tMax) const
+    {
+        SVODAGHit result;
+        result.hit = false;
+        Vec3 invDir = direction.invApproximate();
+        int mirrorMask = (direction.x < 0 ? 1 : 0) | (direction.y < 0 ? 2 : 0) | (direction.z < 0 ? 4 : 0);
+        struct StackEntry
+        {
+            uint32_t node;
+            int attributeIndex;
+            Vec3 cubeMin;
+            float cubeSize;
+        };
+        std::vector<StackEntry> stack;
+        stack.reserve(8 * (depth + 1));
+        stack.push_back({0, 0, min, size});
+        while(!stack.empty())
+        {
+            StackEntry entry = stack.back();
+            stack.pop_back();
+            Bounds cube;
+            cube.min = entry.cubeMin;
+            cube.max = entry.cubeMin;
+            cube.max.add(entry.cubeSize);
+            Intersection hit = cube.intersectRayInvDir(origin, invDir, 0, tMax);
+            if(!hit.hit) continue;
+            uint32_t header = nodes[entry.node];
+            if(header & SVODAG_LEAF_BIT)
+            {
+                result.hit = true;
+                result.t = hit.t;
+                result.attributeIndex = entry.attributeIndex;
+                result.cubeMin = entry.cubeMin;
+                result.cubeSize = entry.cubeSize;
+                return result;
+            }
+            uint32_t childMask = header & 0xFF;
+            int childCount = __builtin_popcount(childMask);
+            float childSize = entry.cubeSize / 2.f;
+            for(int i = 7; i >= 0; i--)
+            {
+                int child = i ^ mirrorMask;
+                if((childMask & (1u << child)) == 0) continue;
+                int rank = __builtin_popcount(childMask & ((1u << child) - 1));
+                StackEntry next;
+                next.node = nodes[entry.node + 1 + rank];
+                next.attributeIndex = entry.attributeIndex + (rank > 0 ? (int)nodes[entry.node + childCount + rank] : 0);
+                next.cubeMin = entry.cubeMin + Vec3((child & 1) * childSize, ((child >> 1) & 1) * childSize, ((child >> 2) & 1) * childSize);
+                next.cubeSize = childSize;
+                stack.push_back(next);
+            }
+        }
+        return result;
+    }
+};
+#endif
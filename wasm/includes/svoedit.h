@@ -0,0 +1,305 @@
+#ifndef SVOEDIT_H
+#define SVOEDIT_H
+#include "mathutils.h"
+#include "svo.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// A far node's slot sits one block capacity after the node, so the near offset has to
+// reach across a full block.
+#if SVO_MAX_CHILD_OFFSET < 16
+#error "EditableSVO needs SVO_MAX_CHILD_OFFSET >= 16"
+#endif
+
+// Dirty entry ranges closer than this many entries are uploaded as one.
+#define SVO_EDIT_MERGE_GAP 16
+
+/**
+ * A sibling group of the editable encoding: capacity entries holding the children in child
+ * index order, followed by capacity far slots when the children have children of their
+ * own. Capacities are powers of two, so a group can gain children without moving.
+ */
+struct SVOBlock
+{
+    uint32_t start;
+    uint8_t capacity;
+    bool hasSlots;
+
+    int entryCount() const
+    {
+        return hasSlots ? 2 * capacity : capacity;
+    }
+};
+
+/**
+ * An SVO pool kept encoded in the constructSVO layout with slack, so edits rewrite only
+ * the sibling groups along the edited paths. Every interior node's children live in an
+ * SVOBlock. A block that outgrows its capacity moves to a free block of the next size or
+ * to the end of the array, and its parent's entry is rewritten. A child placed before its
+ * parent or out of near offset range is reached through the parent's far slot. The root
+ * is entry 0 and its slot entry 1. Released blocks are kept for reuse and are never read,
+ * so the entry count only grows. Interior normals are the average of their children's,
+ * as buildParentLevel computes them.
+ */
+struct EditableSVO
+{
+    SVO tree;
+    // Header and entries as constructSVO returns them.
+    std::vector<float> data;
+    int64_t entryCount;
+    // The child block of every pool node, capacity 0 for leaves and released nodes.
+    std::vector<SVOBlock> childBlocks;
+    // Released blocks by log2(capacity) * 2 + hasSlots.
+    std::vector<uint32_t> freeBlocks[8];
+    // Float ranges of data written since the last takeDirtyRanges.
+    std::vector<std::pair<int64_t, int64_t>> dirty;
+    std::vector<uint32_t> visited;
+    uint32_t visitStamp;
+
+    EditableSVO(Vec3 min, Vec3 max, int depth): tree(min, max, depth)
+    {
+        data.assign(8, 0.f);
+        data[0] = min.x;
+        data[1] = min.y;
+        data[2] = min.z;
+        data[3] = max.x;
+        data[4] = max.y;
+        data[5] = max.z;
+        int size = 1 << depth;
+        memcpy(&data[6], &size, sizeof(int));
+        entryCount = 0;
+        appendEntries(2);
+        visitStamp = 0;
+    }
+
+    static int blockClass(int capacity, bool hasSlots)
+    {
+        return __builtin_ctz(capacity) * 2 + (hasSlots ? 1 : 0);
+    }
+
+    void appendEntries(int count)
+    {
+        entryCount += count;
+        data.resize(8 + entryCount * 4, 0.f);
+        int headerCount = (int)entryCount;
+        memcpy(&data[7], &headerCount, sizeof(int));
+        dirty.push_back({0, 8});
+    }
+
+    SVOBlock allocateBlock(int childCount, bool hasSlots)
+    {
+        SVOBlock block;
+        block.capacity = (uint8_t)(childCount <= 1 ? 1 : 1 << (32 - __builtin_clz(childCount - 1)));
+        block.hasSlots = hasSlots;
+        std::vector<uint32_t>& free = freeBlocks[blockClass(block.capacity, hasSlots)];
+        if(!free.empty())
+        {
+            block.start = free.back();
+            free.pop_back();
+            return block;
+        }
+        block.start = (uint32_t)entryCount;
+        appendEntries(block.entryCount());
+        return block;
+    }
+
+    void releaseBlock(uint32_t node)
+    {
+        SVOBlock& block = childBlocks[node];
+        if(block.capacity == 0) return;
+        freeBlocks[blockClass(block.capacity, block.hasSlots)].push_back(block.start);
+        block.capacity = 0;
+    }
+
+    void syncPool()
+    {
+        SVOBlock none = {0, 0, false};
+        childBlocks.resize(tree.nodes.size(), none);
+        visited.resize(tree.nodes.size(), 0);
+    }
+
+    uint8_t childMask(uint32_t node) const
+    {
+        uint8_t mask = 0;
+        for(int c = 0; c < 8; c++)
+        {
+            if(tree.nodes[node].children[c] != 0) mask |= 1 << c;
+        }
+        return mask;
+    }
+
+    // Writes the entry of node at position, using slot when its children are out of reach.
+    void writeEntry(uint32_t node, int64_t position, int64_t slot)
+    {
+        const SVONode& n = tree.nodes[node];
+        uint32_t word = 0;
+        if(n.isLeaf) word = SVO_LEAF_BIT;
+        else if(childBlocks[node].capacity > 0)
+        {
+            int64_t first = childBlocks[node].start;
+            if(first > position && first - position <= SVO_MAX_CHILD_OFFSET)
+            {
+                word = childMask(node) | (uint32_t)((first - position) << SVO_CHILD_OFFSET_SHIFT);
+            }
+            else
+            {
+                uint32_t absoluteIndex = (uint32_t)first;
+                memcpy(&data[8 + slot * 4], &absoluteIndex, sizeof(uint32_t));
+                word = childMask(node) | SVO_FAR_BIT | (uint32_t)((slot - position) << SVO_CHILD_OFFSET_SHIFT);
+            }
+        }
+        float* entry = &data[8 + position * 4];
+        memcpy(entry, &word, sizeof(uint32_t));
+        entry[1] = n.normal.x;
+        entry[2] = n.normal.y;
+        entry[3] = n.normal.z;
+    }
+
+    // Writes the children of node and their slots into its block.
+    void writeBlock(uint32_t node)
+    {
+        const SVOBlock& block = childBlocks[node];
+        if(block.capacity == 0) return;
+        int rank = 0;
+        for(int c = 0; c < 8; c++)
+        {
+            uint32_t child = tree.nodes[node].children[c];
+            if(child == 0) continue;
+            writeEntry(child, block.start + rank, block.start + block.capacity + rank);
+            rank++;
+        }
+        dirty.push_back({8 + (int64_t)block.start * 4, 8 + ((int64_t)block.start + block.entryCount()) * 4});
+    }
+
+    void writeRoot()
+    {
+        writeEntry(0, 0, 1);
+        dirty.push_back({8, 16});
+    }
+
+    /**
+     * Fills the pool from Morton-sorted levels and encodes it with each sibling group's
+     * block right after the blocks of the previous groups, breadth-first.
+     */
+    void build(const std::vector<SVOLevel>& levels)
+    {
+        std::vector<uint32_t> current(1, 0);
+        std::vector<uint32_t> next;
+        tree.nodes[0].normal = levels[0].normals[0];
+        for(size_t d = 0; d + 1 < levels.size(); d++)
+        {
+            const SVOLevel& level = levels[d];
+            const SVOLevel& children = levels[d + 1];
+            next.assign(children.size(), 0);
+            for(int i = 0; i < level.size(); i++)
+            {
+                int first = level.firstChild[i];
+                int last = first + __builtin_popcount(level.childMasks[i]);
+                for(int c = first; c < last; c++)
+                {
+                    next[c] = tree.createNode(tree.depth - (int)d - 1);
+                    tree.nodes[next[c]].normal = children.normals[c];
+                    tree.nodes[current[i]].children[children.codes[c] & 7] = next[c];
+                }
+            }
+            current.swap(next);
+        }
+        syncPool();
+        std::vector<uint32_t> order(1, 0);
+        for(size_t o = 0; o < order.size(); o++)
+        {
+            uint32_t node = order[o];
+            int childCount = __builtin_popcount(childMask(node));
+            if(childCount == 0) continue;
+            childBlocks[node] = allocateBlock(childCount, tree.nodes[node].depth > 1);
+            for(int c = 0; c < 8; c++)
+            {
+                if(tree.nodes[node].children[c] != 0) order.push_back(tree.nodes[node].children[c]);
+            }
+        }
+        writeRoot();
+        for(uint32_t node : order) writeBlock(node);
+        dirty.clear();
+    }
+
+    /**
+     * Brings the encoding up to date after the leaves at the given voxels (three coordinates
+     * each) were inserted, removed or changed: the normals along their paths are averaged
+     * again bottom-up, blocks that became too small are moved and every group on the paths
+     * is rewritten.
+     */
+    void updatePaths(const std::vector<uint32_t>& voxels)
+    {
+        syncPool();
+        visitStamp++;
+        std::vector<uint32_t> nodes;
+        for(size_t v = 0; v < voxels.size(); v += 3)
+        {
+            uint32_t node = 0;
+            for(int d = tree.depth; d > 0; d--)
+            {
+                if(visited[node] != visitStamp)
+                {
+                    visited[node] = visitStamp;
+                    nodes.push_back(node);
+                }
+                node = tree.nodes[node].children[SVO::childIndex(voxels[v], voxels[v + 1], voxels[v + 2], d)];
+                if(node == 0 || tree.nodes[node].isLeaf) break;
+            }
+        }
+        std::sort(nodes.begin(), nodes.end(), [&](uint32_t a, uint32_t b)
+        {
+            return tree.nodes[a].depth < tree.nodes[b].depth;
+        });
+        for(uint32_t node : nodes)
+        {
+            SVONode& n = tree.nodes[node];
+            Vec3 sum;
+            int childCount = 0;
+            for(int c = 0; c < 8; c++)
+            {
+                if(n.children[c] == 0) continue;
+                sum.add(tree.nodes[n.children[c]].normal);
+                childCount++;
+            }
+            n.normal = childCount > 0 ? sum / (float)childCount : Vec3(0, 0, 0);
+        }
+        // Root first, so blocks appended for new paths follow their parents.
+        for(auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+        {
+            int childCount = __builtin_popcount(childMask(*it));
+            if(childCount == 0) releaseBlock(*it);
+            else if(childCount > childBlocks[*it].capacity)
+            {
+                releaseBlock(*it);
+                childBlocks[*it] = allocateBlock(childCount, tree.nodes[*it].depth > 1);
+            }
+        }
+        writeRoot();
+        for(uint32_t node : nodes) writeBlock(node);
+    }
+
+    /**
+     * The float ranges of data written since the last call as [begin, end) pairs, sorted,
+     * with ranges less than SVO_EDIT_MERGE_GAP entries apart merged.
+     */
+    std::vector<std::pair<int64_t, int64_t>> takeDirtyRanges()
+    {
+        std::sort(dirty.begin(), dirty.end());
+        std::vector<std::pair<int64_t, int64_t>> merged;
+        for(const std::pair<int64_t, int64_t>& range : dirty)
+        {
+            if(!merged.empty() && range.first <= merged.back().second + SVO_EDIT_MERGE_GAP * 4)
+            {
+                merged.back().second = std::max(merged.back().second, range.second);
+                continue;
+            }
+            merged.push_back(range);
+        }
+        dirty.clear();
+        return merged;
+    }
+};
+#endif
@@ -0,0 +1,81 @@
+#ifndef SVOPAGES_H
+#define SVOPAGES_H
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Pages of an out-of-core octree. A page is the subtree below one node of the cut level in
+ * the split stream encoding of encodeSVOStreams with its root at entry 0, stored as
+ * [topology word count][attribute count][topology words][attribute words]. Every page has
+ * the same number of levels; their word counts differ with the geometry they hold.
+ */
+struct SVOPageEntry
+{
+    int64_t fileOffset;
+    uint32_t wordCount;
+};
+
+/**
+ * Least recently used cache over the pages of a page file. At most capacity pages are
+ * resident; loading another one evicts the page that was used longest ago.
+ */
+struct SVOPageCache
+{
+    FILE* file;
+    std::vector<SVOPageEntry> pages;
+    int capacity;
+    // Resident page ids, most recently used first.
+    std::list<int> recency;
+    std::unordered_map<int, std::pair<std::list<int>::iterator, std::vector<uint32_t>>> resident;
+
+    bool isResident(int id) const
+    {
+        return resident.count(id) != 0;
+    }
+
+    void touch(int id)
+    {
+        auto found = resident.find(id);
+        if(found == resident.end()) return;
+        recency.splice(recency.begin(), recency, found->second.first);
+    }
+
+    /**
+     * Returns the words of page id, reading it from the file if it is not resident. The ids
+     * of pages evicted to make room are appended to evicted. Returns nullptr when the page
+     * cannot be read.
+     */
+    const std::vector<uint32_t>* load(int id, std::vector<int>* evicted)
+    {
+        auto found = resident.find(id);
+        if(found != resident.end())
+        {
+            touch(id);
+            return &found->second.second;
+        }
+        const SVOPageEntry& entry = pages[id];
+        std::vector<uint32_t> words(entry.wordCount);
+        if(fseeko(file, (off_t)entry.fileOffset, SEEK_SET) != 0 || fread(words.data(), sizeof(uint32_t), words.size(), file) != words.size())
+        {
+            fprintf(stderr, "SVOPageCache: failed to read page %d\n", id);
+            return nullptr;
+        }
+        while((int)resident.size() >= capacity && !recency.empty())
+        {
+            int oldest = recency.back();
+            recency.pop_back();
+            resident.erase(oldest);
+            evicted->push_back(oldest);
+        }
+        recency.push_front(id);
+        auto& slot = resident[id];
+        slot.first = recency.begin();
+        slot.second = std::move(words);
+        return &slot.second;
+    }
+};
+#endif
@@ -0,0 +1,393 @@
+#ifndef SVOTRAVERSAL_H
+#define SVOTRAVERSAL_H
+#include "mathutils.h"
+#include "svo.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Scale of the root cube: positions live in [1, 2) and a cube at scale s has edge 2^(s - 23).
+#define SVO_TRAVERSAL_MAX_SCALE 23
+
+struct SVOHit
+{
+    bool hit;
+    float t;
+    // Entry index of the leaf that was hit.
+    int64_t node;
+    Vec3 cubeMin;
+    float cubeSize;
+};
+
+// Reads closer than this many entries (4 KiB) to the previous read count as near.
+#define SVO_NEAR_FETCH_DISTANCE 256
+
+// Entry reads of a traversal, the summed distance in entries between consecutive reads
+// and the number of reads within SVO_NEAR_FETCH_DISTANCE of the previous one, plus the
+// rope words read by SVORopeTraversal.
+struct SVOTraversalStats
+{
+    int64_t fetchCount;
+    double fetchDistance;
+    int64_t nearFetchCount;
+    int64_t ropeFetchCount;
+};
+
+/**
+ * CPU traversal of the encodeSVO entries, the same data the GPU reads in svoUtils.js. Rays
+ * are cast with the stackful algorithm of Laine and Karras, "Efficient Sparse Voxel
+ * Octrees": the root cube is mapped to [1, 2)^3, mirrored so the ray points to -x, -y and
+ * -z, and child cubes, pops and the parent scale are all derived from the float bits of
+ * the position. A child's entry is the node's first child plus the popcount of the child
+ * mask below the child's bit.
+ */
+struct SVOTraversal
+{
+    // The entries after the 8 float header.
+    const float* entries;
+    Vec3 min;
+    float size;
+
+    uint32_t word(int64_t index, int64_t* lastFetch, SVOTraversalStats* stats) const
+    {
+        if(stats != nullptr)
+        {
+            int64_t distance = index > *lastFetch ? index - *lastFetch : *lastFetch - index;
+            stats->fetchCount++;
+            stats->fetchDistance += (double)distance;
+            if(distance < SVO_NEAR_FETCH_DISTANCE) stats->nearFetchCount++;
+        }
+        *lastFetch = index;
+        uint32_t bits;
+        memcpy(&bits, entries + index * 4, sizeof(uint32_t));
+        return bits;
+    }
+
+    int64_t firstChild(int64_t node, uint32_t bits, int64_t* lastFetch, SVOTraversalStats* stats) const
+    {
+        int64_t target = node + SVO_CHILD_OFFSET(bits);
+        if(bits & SVO_FAR_BIT) return word(target, lastFetch, stats);
+        return target;
+    }
+
+    Vec3 normal(int64_t node) const
+    {
+        const float* entry = entries + node * 4;
+        return Vec3(entry[1], entry[2], entry[3]);
+    }
+
+    /**
+     * Nearest leaf along origin + t * direction for t in [0, tMax]. t is in the units of
+     * direction. Read statistics are added to stats when it is not null.
+     */
+    SVOHit castRay(Vec3 origin, Vec3 direction, float tMax, SVOTraversalStats* stats = nullptr) const
+    {
+        return castRayFiltered(origin, direction, tMax, stats, [](int64_t, float, float, float*)
+        {
+            return true;
+        });
+    }
+
+    /**
+     * castRay that asks acceptLeaf(node, tEnter, tExit, &t) about every leaf the ray
+     * reaches, in order, with the span of t inside the leaf's cube. The first leaf it
+     * accepts is the hit, at the t it wrote; the ray passes through the others as if they
+     * were empty.
+     */
+    template <typename F>
+    SVOHit castRayFiltered(Vec3 origin, Vec3 direction, float tMax, SVOTraversalStats* stats, F acceptLeaf) const
+    {
+        const int sMax = SVO_TRAVERSAL_MAX_SCALE;
+        SVOHit result;
+        result.hit = false;
+        Vec3 o = (origin - min) / size;
+        o.add(1.f);
+        Vec3 d = direction / size;
+        if(std::isnan(o.x + o.y + o.z + d.x + d.y + d.z)) return result;
+
+        const float epsilon = std::ldexp(1.f, -sMax);
+        for(int a = 0; a < 3; a++)
+        {
+            if(std::fabs(d[a]) < epsilon) d[a] = std::copysign(epsilon, d[a]);
+        }
+        Vec3 coef(1.f / -std::fabs(d.x), 1.f / -std::fabs(d.y), 1.f / -std::fabs(d.z));
+        Vec3 bias(coef.x * o.x, coef.y * o.y, coef.z * o.z);
+        int octantMask = 0;
+        for(int a = 0; a < 3; a++)
+        {
+            if(d[a] > 0.f)
+            {
+                octantMask ^= 1 << a;
+                bias[a] = 3.f * coef[a] - bias[a];
+            }
+        }
+
+        float tMin = std::fmax(std::fmax(2.f * coef.x - bias.x, 2.f * coef.y - bias.y), 2.f * coef.z - bias.z);
+        float tSpanMax = std::fmin(std::fmin(coef.x - bias.x, coef.y - bias.y), coef.z - bias.z);
+        tMin = std::fmax(tMin, 0.f);
+        tSpanMax = std::fmin(tSpanMax, tMax);
+        if(tMin > tSpanMax) return result;
+
+        int64_t lastFetch = 0;
+        int64_t parent = 0;
+        uint32_t parentBits = word(0, &lastFetch, stats);
+        if(parentBits & SVO_LEAF_BIT)
+        {
+            result.t = tMin;
+            if(!acceptLeaf(0, tMin, tSpanMax, &result.t)) return result;
+            result.hit = true;
+            result.node = 0;
+            result.cubeMin = min;
+            result.cubeSize = size;
+            return result;
+        }
+
+        int64_t stackNode[sMax + 1];
+        float stackTMax[sMax + 1];
+        int idx = 0;
+        Vec3 pos(1.f, 1.f, 1.f);
+        int scale = sMax - 1;
+        float scaleExp2 = 0.5f;
+        for(int a = 0; a < 3; a++)
+        {
+            if(1.5f * coef[a] - bias[a] > tMin)
+            {
+                idx ^= 1 << a;
+                pos[a] = 1.5f;
+            }
+        }
+
+        while(scale < sMax)
+        {
+            Vec3 corner(pos.x * coef.x - bias.x, pos.y * coef.y - bias.y, pos.z * coef.z - bias.z);
+            float tcMax = std::fmin(std::fmin(corner.x, corner.y), corner.z);
+            int childShift = idx ^ octantMask;
+            uint32_t childMask = parentBits & 0xFF;
+            if(((childMask >> childShift) & 1) != 0 && tMin <= tSpanMax)
+            {
+                float tvMax = std::fmin(tSpanMax, tcMax);
+                float half = scaleExp2 * 0.5f;
+                if(tMin <= tvMax)
+                {
+                    int64_t child = firstChild(parent, parentBits, &lastFetch, stats) + __builtin_popcount(childMask & ((1u << childShift) - 1));
+                    uint32_t childBits = word(child, &lastFetch, stats);
+                    if(childBits & SVO_LEAF_BIT)
+                    {
+                        result.t = tMin;
+                        if(acceptLeaf(child, tMin, tvMax, &result.t))
+                        {
+                            result.hit = true;
+                            result.node = child;
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        stackNode[scale] = parent;
+                        stackTMax[scale] = tSpanMax;
+                        parent = child;
+                        parentBits = childBits;
+                        idx = 0;
+                        scale--;
+                        scaleExp2 = half;
+                        for(int a = 0; a < 3; a++)
+                        {
+                            if(half * coef[a] + corner[a] > tMin)
+                            {
+                                idx ^= 1 << a;
+                                pos[a] += scaleExp2;
+                            }
+                        }
+                        tSpanMax = tvMax;
+                        continue;
+                    }
+                }
+            }
+
+            int stepMask = 0;
+            for(int a = 0; a < 3; a++)
+            {
+                if(corner[a] <= tcMax)
+                {
+                    stepMask ^= 1 << a;
+                    pos[a] -= scaleExp2;
+                }
+            }
+            tMin = tcMax;
+            idx ^= stepMask;
+            if((idx & stepMask) != 0)
+            {
+                // Pop to the largest cube whose boundary was crossed: the highest bit that
+                // differs between the old and new position.
+                uint32_t differingBits = 0;
+                for(int a = 0; a < 3; a++)
+                {
+                    if(stepMask & (1 << a)) differingBits |= floatBits(pos[a]) ^ floatBits(pos[a] + scaleExp2);
+                }
+                scale = (int)(floatBits((float)differingBits) >> 23) - 127;
+                if(scale >= sMax) break;
+                scaleExp2 = bitsFloat((uint32_t)(scale - sMax + 127) << 23);
+                parent = stackNode[scale];
+                tSpanMax = stackTMax[scale];
+                parentBits = word(parent, &lastFetch, stats);
+                int shifted[3];
+                for(int a = 0; a < 3; a++)
+                {
+                    shifted[a] = (int)(floatBits(pos[a]) >> scale);
+                    pos[a] = bitsFloat((uint32_t)shifted[a] << scale);
+                }
+                idx = (shifted[0] & 1) | ((shifted[1] & 1) << 1) | ((shifted[2] & 1) << 2);
+            }
+        }
+        if(!result.hit) return result;
+
+        for(int a = 0; a < 3; a++)
+        {
+            if(octantMask & (1 << a)) pos[a] = 3.f - scaleExp2 - pos[a];
+        }
+        pos.sub(1.f);
+        result.cubeMin = min + pos * size;
+        result.cubeSize = scaleExp2 * size;
+        return result;
+    }
+
+    static uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(float));
+        return bits;
+    }
+
+    static float bitsFloat(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(float));
+        return value;
+    }
+};
+
+/**
+ * Stackless traversal over the same entries with neighbor ropes (see SVO_PACK_ROPE). The
+ * ray walks from node to node: it descends into the child it is in, steps over empty
+ * children inside the node and, when it leaves the node's cube, follows the rope of the
+ * exit face to the smallest node covering the neighbor cube. Moving on to the next node
+ * never goes back up the tree, where the stack traversal pops to the common ancestor and
+ * descends again. Cubes are tracked in leaf units of the depth levels below the root.
+ */
+struct SVORopeTraversal
+{
+    SVOTraversal nodes;
+    const uint32_t* ropes;
+    int depth;
+
+    uint32_t rope(int64_t node, int face, SVOTraversalStats* stats) const
+    {
+        if(stats != nullptr) stats->ropeFetchCount++;
+        return ropes[node * 6 + face];
+    }
+
+    SVOHit castRay(Vec3 origin, Vec3 direction, float tMax, SVOTraversalStats* stats = nullptr) const
+    {
+        SVOHit result;
+        result.hit = false;
+        int64_t rootSize = (int64_t)1 << depth;
+        double leafSize = (double)nodes.size / (double)rootSize;
+        double o[3], d[3];
+        for(int a = 0; a < 3; a++)
+        {
+            o[a] = (origin[a] - nodes.min[a]) / leafSize;
+            d[a] = direction[a] / leafSize;
+        }
+        if(std::isnan(o[0] + o[1] + o[2] + d[0] + d[1] + d[2])) return result;
+
+        double t = 0.0;
+        double tEnd = tMax;
+        for(int a = 0; a < 3; a++)
+        {
+            if(d[a] == 0.0)
+            {
+                if(o[a] < 0.0 || o[a] > (double)rootSize) return result;
+                continue;
+            }
+            double t0 = -o[a] / d[a];
+            double t1 = ((double)rootSize - o[a]) / d[a];
+            t = std::fmax(t, std::fmin(t0, t1));
+            tEnd = std::fmin(tEnd, std::fmax(t0, t1));
+        }
+        if(t > tEnd) return result;
+
+        int64_t lastFetch = 0;
+        int64_t node = 0;
+        uint32_t bits = nodes.word(0, &lastFetch, stats);
+        int64_t cube[3] = {0, 0, 0};
+        int64_t size = rootSize;
+        // The last face plane the ray crossed, kept exact: the rounded position on it may
+        // lie on either side and would send the ray back into the cube it just left.
+        int planeAxis = -1;
+        int64_t plane = 0;
+        while(!(bits & SVO_LEAF_BIT))
+        {
+            // The child the ray is in at t, ties broken towards the direction of travel.
+            int64_t half = size / 2;
+            int child = 0;
+            for(int a = 0; a < 3; a++)
+            {
+                int64_t mid = cube[a] + half;
+                bool upper;
+                if(a == planeAxis) upper = plane > mid || (plane == mid && d[a] > 0.0);
+                else
+                {
+                    double p = o[a] + d[a] * t;
+                    upper = p > (double)mid || (p == (double)mid && d[a] > 0.0);
+                }
+                if(upper) child |= 1 << a;
+            }
+            uint32_t childMask = bits & 0xFF;
+            if(childMask & (1u << child))
+            {
+                node = nodes.firstChild(node, bits, &lastFetch, stats) + __builtin_popcount(childMask & ((1u << child) - 1));
+                bits = nodes.word(node, &lastFetch, stats);
+                for(int a = 0; a < 3; a++) cube[a] += ((child >> a) & 1) * half;
+                size = half;
+                continue;
+            }
+
+            // Step over the empty child: on to a sibling, or out of the node along a rope.
+            int exitAxis = -1;
+            double tExit = INFINITY;
+            for(int a = 0; a < 3; a++)
+            {
+                if(d[a] == 0.0) continue;
+                int64_t childMin = cube[a] + ((child >> a) & 1) * half;
+                int64_t bound = d[a] > 0.0 ? childMin + half : childMin;
+                double tFace = ((double)bound - o[a]) / d[a];
+                if(tFace < tExit)
+                {
+                    tExit = tFace;
+                    exitAxis = a;
+                    plane = bound;
+                }
+            }
+            t = std::fmax(t, tExit);
+            if(exitAxis < 0 || t > tEnd) return result;
+            planeAxis = exitAxis;
+            bool positive = d[exitAxis] > 0.0;
+            if(((child >> exitAxis) & 1) != (positive ? 1 : 0)) continue;
+            uint32_t word = rope(node, 2 * exitAxis + (positive ? 1 : 0), stats);
+            if(word == SVO_NO_ROPE) return result;
+            int levelsUp = (int)SVO_ROPE_LEVELS_UP(word);
+            cube[exitAxis] += positive ? size : -size;
+            size <<= levelsUp;
+            for(int a = 0; a < 3; a++) cube[a] = cube[a] / size * size;
+            node = SVO_ROPE_INDEX(word);
+            bits = nodes.word(node, &lastFetch, stats);
+        }
+        result.hit = true;
+        result.t = (float)t;
+        result.node = node;
+        result.cubeMin = nodes.min + Vec3((float)(cube[0] * leafSize), (float)(cube[1] * leafSize), (float)(cube[2] * leafSize));
+        result.cubeSize = (float)(size * leafSize);
+        return result;
+    }
+};
+#endif
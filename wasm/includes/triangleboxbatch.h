@@ -0,0 +1,106 @@
+#ifndef TRIANGLEBOXBATCH_H
+#define TRIANGLEBOXBATCH_H
+#include "mathutils.h"
+#include <cmath>
+#include <cstdint>
+
+// The 13 separating axes of Akenine-Moeller's triangle-box test: the box axes, the nine
+// cross products of the triangle edges with them and the triangle normal.
+#define TRIANGLE_BOX_AXIS_COUNT 13
+
+/**
+ * The triangle-box overlap test of threeyd::moeller::TriangleIntersects::box for one
+ * triangle against many boxes of the same half size. Everything that depends only on the
+ * triangle and the half size is set up once: the box overlaps the triangle when, along
+ * every separating axis, the box center projects into the interval [lo, hi] spanned by
+ * the triangle grown by the box's projected radius. Coordinates are taken relative to the
+ * first vertex, so they stay as small as in the box-centered original. Results can only
+ * differ from box() for boxes that touch the triangle within rounding.
+ */
+struct TriangleBoxBatch
+{
+    Vec3 origin;
+    Vec3 axes[TRIANGLE_BOX_AXIS_COUNT];
+    float lo[TRIANGLE_BOX_AXIS_COUNT];
+    float hi[TRIANGLE_BOX_AXIS_COUNT];
+
+    TriangleBoxBatch(const Vec3& v0, const Vec3& v1, const Vec3& v2, const Vec3& halfSize)
+    {
+        origin = v0;
+        // Relative to v0, so the first vertex projects to 0 on every axis.
+        Vec3 p1 = v1 - v0;
+        Vec3 p2 = v2 - v0;
+        Vec3 edges[3] = {p1, p2 - p1, p2 * -1.f};
+        axes[0] = Vec3(1, 0, 0);
+        axes[1] = Vec3(0, 1, 0);
+        axes[2] = Vec3(0, 0, 1);
+        for(int e = 0; e < 3; e++)
+        {
+            const Vec3& edge = edges[e];
+            axes[3 + e * 3] = Vec3(0, edge.z, -edge.y);
+            axes[4 + e * 3] = Vec3(-edge.z, 0, edge.x);
+            axes[5 + e * 3] = Vec3(edge.y, -edge.x, 0);
+        }
+        axes[12] = edges[0].cross(edges[1]);
+        for(int k = 0; k < TRIANGLE_BOX_AXIS_COUNT; k++)
+        {
+            const Vec3& n = axes[k];
+            float d1 = n.dot(p1);
+            float d2 = n.dot(p2);
+            float radius = std::fabs(n.x) * halfSize.x + std::fabs(n.y) * halfSize.y + std::fabs(n.z) * halfSize.z;
+            float dMin = d1 < d2 ? d1 : d2;
+            float dMax = d1 < d2 ? d2 : d1;
+            lo[k] = (dMin < 0.f ? dMin : 0.f) - radius;
+            hi[k] = (dMax > 0.f ? dMax : 0.f) + radius;
+        }
+    }
+
+    bool overlaps(const Vec3& center) const
+    {
+        Vec3 c = center - origin;
+        for(int k = 0; k < TRIANGLE_BOX_AXIS_COUNT; k++)
+        {
+            float d = axes[k].dot(c);
+            if(d < lo[k] || d > hi[k]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Tests the boxes around the first count of N centers (N = 4, 8 or 16, given as
+     * coordinate arrays) and returns a mask with bit i set when box i overlaps the
+     * triangle. Lanes past count may hold anything and are never set.
+     */
+    template <int N>
+    uint32_t overlapMask(const float* centerX, const float* centerY, const float* centerZ, int count = N) const
+    {
+        static_assert(N == 4 || N == 8 || N == 16, "TriangleBoxBatch tests 4, 8 or 16 boxes at a time");
+        uint32_t mask = 0;
+#if defined(MATHUTILS_SSE) || defined(MATHUTILS_WASM_SIMD)
+        for(int group = 0; group < N; group += 4)
+        {
+            if(group >= count) break;
+            Float4 cx = float4Sub(float4Load(centerX + group), float4Splat(origin.x));
+            Float4 cy = float4Sub(float4Load(centerY + group), float4Splat(origin.y));
+            Float4 cz = float4Sub(float4Load(centerZ + group), float4Splat(origin.z));
+            // The box axes only need one lane each.
+            int lanes = float4InRangeMask(cx, float4Splat(lo[0]), float4Splat(hi[0]));
+            lanes &= float4InRangeMask(cy, float4Splat(lo[1]), float4Splat(hi[1]));
+            lanes &= float4InRangeMask(cz, float4Splat(lo[2]), float4Splat(hi[2]));
+            for(int k = 3; k < TRIANGLE_BOX_AXIS_COUNT && lanes != 0; k++)
+            {
+                Float4 d = float4Add(float4Add(float4Mul(cx, float4Splat(axes[k].x)), float4Mul(cy, float4Splat(axes[k].y))), float4Mul(cz, float4Splat(axes[k].z)));
+                lanes &= float4InRangeMask(d, float4Splat(lo[k]), float4Splat(hi[k]));
+            }
+            mask |= (uint32_t)lanes << group;
+        }
+#else
+        for(int i = 0; i < N && i < count; i++)
+        {
+            if(overlaps(Vec3(centerX[i], centerY[i], centerZ[i]))) mask |= 1u << i;
+        }
+#endif
+        return count < N ? mask & ((1u << count) - 1) : mask;
+    }
+};
+#endif
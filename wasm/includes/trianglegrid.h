@@ -0,0 +1,115 @@
+#ifndef TRIANGLEGRID_H
+#define TRIANGLEGRID_H
+#include "mathutils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+struct TriangleGridHit
+{
+    bool hit;
+    float t;
+    int triangle;
+    Vec3 normal;
+};
+
+// Cells entered and ray-triangle tests of a traversal.
+struct TriangleGridStats
+{
+    int64_t cellCount;
+    int64_t triangleTestCount;
+};
+
+/**
+ * CPU traversal of a constructTriangleGrid result. Rays are clipped to the grid box and
+ * walk its cells front to back with the 3D-DDA of Amanatides and Woo, "A Fast Voxel
+ * Traversal Algorithm for Ray Tracing". The triangles of every cell are tested; the walk
+ * stops at the first cell whose exit lies behind the nearest hit so far, since every cell
+ * after it starts even further away. Cells are stored x-major like the dense grids:
+ * cell (x, y, z) is (x * gridSize[1] + y) * gridSize[2] + z.
+ */
+struct TriangleGridTraversal
+{
+    Vec3 min;
+    int gridSize[3];
+    float cellSize;
+    // gridSize[0] * gridSize[1] * gridSize[2] + 1 offsets into triangles.
+    const uint32_t* cellStarts;
+    const uint32_t* triangles;
+    // Nine floats per triangle.
+    const float* prims;
+
+    TriangleGridHit castRay(Vec3 origin, Vec3 direction, float tMax, TriangleGridStats* stats) const
+    {
+        TriangleGridHit result;
+        result.hit = false;
+        result.t = tMax;
+        result.triangle = -1;
+        Vec3 gridMax = min + Vec3((float)gridSize[0], (float)gridSize[1], (float)gridSize[2]) * cellSize;
+        float tEnter = 0.f;
+        float tExit = tMax;
+        for(int a = 0; a < 3; a++)
+        {
+            if(direction[a] == 0.f)
+            {
+                if(origin[a] < min[a] || origin[a] > gridMax[a]) return result;
+                continue;
+            }
+            float t0 = (min[a] - origin[a]) / direction[a];
+            float t1 = (gridMax[a] - origin[a]) / direction[a];
+            if(t0 > t1) std::swap(t0, t1);
+            tEnter = std::fmax(tEnter, t0);
+            tExit = std::fmin(tExit, t1);
+        }
+        if(tEnter > tExit) return result;
+
+        int cell[3];
+        int step[3];
+        float tNext[3];
+        float tDelta[3];
+        Vec3 entry = origin + direction * tEnter;
+        for(int a = 0; a < 3; a++)
+        {
+            cell[a] = (int)std::floor((entry[a] - min[a]) / cellSize);
+            cell[a] = std::max(0, std::min(gridSize[a] - 1, cell[a]));
+            if(direction[a] == 0.f)
+            {
+                step[a] = 0;
+                tNext[a] = INFINITY;
+                tDelta[a] = INFINITY;
+                continue;
+            }
+            step[a] = direction[a] > 0.f ? 1 : -1;
+            float boundary = min[a] + (float)(cell[a] + (step[a] > 0 ? 1 : 0)) * cellSize;
+            tNext[a] = (boundary - origin[a]) / direction[a];
+            tDelta[a] = cellSize / std::fabs(direction[a]);
+        }
+
+        while(true)
+        {
+            int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+            float tCellExit = std::fmin(tNext[axis], tExit);
+            uint32_t cellIndex = ((uint32_t)cell[0] * gridSize[1] + cell[1]) * gridSize[2] + cell[2];
+            if(stats != nullptr) stats->cellCount++;
+            for(uint32_t i = cellStarts[cellIndex]; i < cellStarts[cellIndex + 1]; i++)
+            {
+                const float* v = prims + (size_t)triangles[i] * 9;
+                Triangle triangle = {Vec3(v[0], v[1], v[2]), Vec3(v[3], v[4], v[5]), Vec3(v[6], v[7], v[8])};
+                Intersection candidate = triangle.intersectRay(origin, direction, 0.f, result.t);
+                if(stats != nullptr) stats->triangleTestCount++;
+                if(!candidate.hit) continue;
+                result.hit = true;
+                result.t = candidate.t;
+                result.triangle = (int)triangles[i];
+                result.normal = candidate.normal;
+            }
+            if(result.hit && result.t <= tCellExit) break;
+            if(tCellExit >= tExit) break;
+            cell[axis] += step[axis];
+            if(cell[axis] < 0 || cell[axis] >= gridSize[axis]) break;
+            tNext[axis] += tDelta[axis];
+        }
+        return result;
+    }
+};
+#endif
@@ -0,0 +1,500 @@
+#include "../includes/mathutils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Surface area heuristic costs of Wald and Havran, "On building fast kd-Trees for Ray
+// Tracing, and on doing that in O(N log N)".
+#define KD_TRAVERSAL_COST 15.f
+#define KD_INTERSECTION_COST 20.f
+// Cost factor of splits that cut off empty space.
+#define KD_EMPTY_BONUS 0.8f
+#define KD_MAX_DEPTH 64
+// Value of the low two flag bits that marks a leaf; 0 to 2 are the split axis.
+#define KD_LEAF 3
+
+enum KDEventType
+{
+    KDEventEnd = 0,
+    KDEventPlanar = 1,
+    KDEventStart = 2
+};
+
+/**
+ * Where a triangle's clipped bounds start, end or lie flat along one axis. Sorted by
+ * position with ends before planar events before starts, so a sweep sees everything that
+ * ends at a plane before what starts there.
+ */
+struct KDEvent
+{
+    float position;
+    int type;
+    int triangle;
+
+    bool operator<(const KDEvent& other) const
+    {
+        return position < other.position || (position == other.position && type < other.type);
+    }
+};
+
+enum KDSide
+{
+    KDBoth = 0,
+    KDLeftOnly = 1,
+    KDRightOnly = 2
+};
+
+struct KDSplit
+{
+    int axis;
+    float position;
+    // Whether triangles lying in the split plane go to the left child.
+    bool planarLeft;
+    float cost;
+};
+
+/**
+ * An 8 byte node of the linear layout, stored depth-first with the left child right after
+ * its parent. The low two bits of flags are the split axis or KD_LEAF; the rest is the
+ * index of the right child of an interior node or the triangle count of a leaf. value is
+ * the split position of an interior node, the triangle of a leaf holding one and
+ * otherwise the offset of the leaf's triangles in the index list.
+ */
+struct KDLinearNode
+{
+    uint32_t value;
+    uint32_t flags;
+};
+
+/**
+ * Builds a SAH kd-tree with the O(N log N) algorithm of Wald and Havran. Every node keeps
+ * the split events of its triangles sorted per axis, so the best split on every axis is
+ * found with one sweep. Triangles are split into the children by their events; the ones
+ * straddling the split are clipped to each child (perfect splits) and only their new
+ * events are sorted and merged into the children's lists.
+ */
+class KDTreeBuilder
+{
+    std::vector<Triangle> triangles;
+    std::vector<uint8_t> sides;
+    int maxDepth;
+
+public:
+    std::vector<KDLinearNode> nodes;
+    std::vector<uint32_t> indices;
+    Bounds bounds;
+
+    KDTreeBuilder(float* prims, int primCount, int maxDepth)
+    {
+        triangles.resize(primCount);
+        for(int i = 0; i < primCount; i++)
+        {
+            const float* v = prims + i * 9;
+            triangles[i] = {Vec3(v[0], v[1], v[2]), Vec3(v[3], v[4], v[5]), Vec3(v[6], v[7], v[8])};
+        }
+        sides.assign(primCount, KDBoth);
+        this->maxDepth = maxDepth;
+    }
+
+    static void addEvents(std::vector<KDEvent>* events, const Bounds& b, int triangle)
+    {
+        for(int axis = 0; axis < 3; axis++)
+        {
+            if(b.min[axis] == b.max[axis])
+            {
+                events[axis].push_back({b.min[axis], KDEventPlanar, triangle});
+                continue;
+            }
+            events[axis].push_back({b.min[axis], KDEventStart, triangle});
+            events[axis].push_back({b.max[axis], KDEventEnd, triangle});
+        }
+    }
+
+    void build()
+    {
+        std::vector<KDEvent> events[3];
+        bounds = triangles[0].boundingBox();
+        for(const Triangle& triangle : triangles) bounds.unionWithOther(triangle.boundingBox());
+        for(int i = 0; i < (int)triangles.size(); i++) addEvents(events, triangles[i].boundingBox(), i);
+        for(int axis = 0; axis < 3; axis++) std::sort(events[axis].begin(), events[axis].end());
+        buildNode(events, (int)triangles.size(), bounds, 0);
+    }
+
+    float splitCost(const Bounds& b, int axis, float position, int leftCount, int rightCount, float invArea) const
+    {
+        Bounds left = b;
+        Bounds right = b;
+        left.max[axis] = position;
+        right.min[axis] = position;
+        float cost = KD_TRAVERSAL_COST + KD_INTERSECTION_COST * (left.surfaceArea() * invArea * leftCount + right.surfaceArea() * invArea * rightCount);
+        return leftCount == 0 || rightCount == 0 ? cost * KD_EMPTY_BONUS : cost;
+    }
+
+    /**
+     * Sweeps the sorted events of every axis and returns the split of lowest cost. Planes
+     * on the node's faces are skipped, since they leave one child with the whole node.
+     */
+    KDSplit findSplit(const std::vector<KDEvent>* events, int count, const Bounds& b) const
+    {
+        KDSplit best = {0, 0.f, false, INFINITY};
+        float invArea = 1.f / b.surfaceArea();
+        for(int axis = 0; axis < 3; axis++)
+        {
+            const std::vector<KDEvent>& list = events[axis];
+            int leftCount = 0;
+            int rightCount = count;
+            size_t i = 0;
+            while(i < list.size())
+            {
+                float position = list[i].position;
+                int endCount = 0, planarCount = 0, startCount = 0;
+                while(i < list.size() && list[i].position == position && list[i].type == KDEventEnd)
+                {
+                    endCount++;
+                    i++;
+                }
+                while(i < list.size() && list[i].position == position && list[i].type == KDEventPlanar)
+                {
+                    planarCount++;
+                    i++;
+                }
+                while(i < list.size() && list[i].position == position && list[i].type == KDEventStart)
+                {
+                    startCount++;
+                    i++;
+                }
+                rightCount -= planarCount + endCount;
+                if(position > b.min[axis] && position < b.max[axis])
+                {
+                    float costLeft = splitCost(b, axis, position, leftCount + planarCount, rightCount, invArea);
+                    float costRight = splitCost(b, axis, position, leftCount, rightCount + planarCount, invArea);
+                    float cost = std::min(costLeft, costRight);
+                    if(cost < best.cost) best = {axis, position, costLeft <= costRight, cost};
+                }
+                leftCount += startCount + planarCount;
+            }
+        }
+        return best;
+    }
+
+    void makeLeaf(const std::vector<KDEvent>* events, int count)
+    {
+        KDLinearNode node;
+        node.flags = KD_LEAF | (uint32_t)count << 2;
+        node.value = (uint32_t)indices.size();
+        // Every triangle has one or two events per axis; its end event is skipped.
+        for(const KDEvent& event : events[0])
+        {
+            if(event.type != KDEventEnd) indices.push_back((uint32_t)event.triangle);
+        }
+        if(count == 1)
+        {
+            node.value = indices.back();
+            indices.pop_back();
+        }
+        nodes.push_back(node);
+    }
+
+    void buildNode(std::vector<KDEvent>* events, int count, const Bounds& b, int depth)
+    {
+        KDSplit split = {0, 0.f, false, INFINITY};
+        if(count > 0 && depth < maxDepth && b.surfaceArea() > 0.f) split = findSplit(events, count, b);
+        if(split.cost >= KD_INTERSECTION_COST * count)
+        {
+            makeLeaf(events, count);
+            return;
+        }
+
+        // Classify the triangles by the events of the split axis.
+        for(const KDEvent& event : events[split.axis])
+        {
+            if(event.type == KDEventEnd && event.position <= split.position) sides[event.triangle] = KDLeftOnly;
+            else if(event.type == KDEventStart && event.position >= split.position) sides[event.triangle] = KDRightOnly;
+            else if(event.type == KDEventPlanar)
+            {
+                if(event.position < split.position || (event.position == split.position && split.planarLeft)) sides[event.triangle] = KDLeftOnly;
+                else sides[event.triangle] = KDRightOnly;
+            }
+        }
+        Bounds leftBounds = b;
+        Bounds rightBounds = b;
+        leftBounds.max[split.axis] = split.position;
+        rightBounds.min[split.axis] = split.position;
+
+        std::vector<KDEvent> left[3];
+        std::vector<KDEvent> right[3];
+        for(int axis = 0; axis < 3; axis++)
+        {
+            for(const KDEvent& event : events[axis])
+            {
+                if(sides[event.triangle] == KDLeftOnly) left[axis].push_back(event);
+                else if(sides[event.triangle] == KDRightOnly) right[axis].push_back(event);
+            }
+        }
+        int leftCount = 0;
+        int rightCount = 0;
+        std::vector<KDEvent> straddlingLeft[3];
+        std::vector<KDEvent> straddlingRight[3];
+        for(const KDEvent& event : events[0])
+        {
+            if(event.type == KDEventEnd) continue;
+            int triangle = event.triangle;
+            if(sides[triangle] == KDLeftOnly) leftCount++;
+            else if(sides[triangle] == KDRightOnly) rightCount++;
+            else
+            {
+                Bounds clipped;
+                if(triangles[triangle].clippedBounds(leftBounds, &clipped))
+                {
+                    addEvents(straddlingLeft, clipped, triangle);
+                    leftCount++;
+                }
+                if(triangles[triangle].clippedBounds(rightBounds, &clipped))
+                {
+                    addEvents(straddlingRight, clipped, triangle);
+                    rightCount++;
+                }
+            }
+            sides[triangle] = KDBoth;
+        }
+        for(int axis = 0; axis < 3; axis++)
+        {
+            std::vector<KDEvent>().swap(events[axis]);
+            mergeEvents(&left[axis], &straddlingLeft[axis]);
+            mergeEvents(&right[axis], &straddlingRight[axis]);
+        }
+
+        size_t index = nodes.size();
+        nodes.push_back({0, 0});
+        buildNode(left, leftCount, leftBounds, depth + 1);
+        uint32_t rightChild = (uint32_t)nodes.size();
+        buildNode(right, rightCount, rightBounds, depth + 1);
+        memcpy(&nodes[index].value, &split.position, sizeof(float));
+        nodes[index].flags = (uint32_t)split.axis | rightChild << 2;
+    }
+
+    static void mergeEvents(std::vector<KDEvent>* events, std::vector<KDEvent>* added)
+    {
+        std::sort(added->begin(), added->end());
+        size_t middle = events->size();
+        events->insert(events->end(), added->begin(), added->end());
+        std::inplace_merge(events->begin(), events->begin() + middle, events->end());
+        std::vector<KDEvent>().swap(*added);
+    }
+};
+
+struct KDTreeHit
+{
+    bool hit;
+    float t;
+    int triangle;
+    Vec3 normal;
+};
+
+// Nodes visited and ray-triangle tests of a traversal.
+struct KDTreeStats
+{
+    int64_t nodeCount;
+    int64_t triangleTestCount;
+};
+
+/**
+ * CPU traversal of a constructKDTree result, front to back with a stack of far children
+ * and their ray segments. The walk ends at the first node whose segment starts behind the
+ * nearest hit so far.
+ */
+struct KDTreeTraversal
+{
+    Bounds bounds;
+    const KDLinearNode* nodes;
+    const uint32_t* indices;
+    // Nine floats per triangle.
+    const float* prims;
+
+    Intersection intersectTriangle(uint32_t index, Vec3 origin, Vec3 direction, float tMax) const
+    {
+        const float* v = prims + (size_t)index * 9;
+        Triangle triangle = {Vec3(v[0], v[1], v[2]), Vec3(v[3], v[4], v[5]), Vec3(v[6], v[7], v[8])};
+        return triangle.intersectRay(origin, direction, 0.f, tMax);
+    }
+
+    KDTreeHit castRay(Vec3 origin, Vec3 direction, float tMax, KDTreeStats* stats) const
+    {
+        KDTreeHit result;
+        result.hit = false;
+        result.t = tMax;
+        result.triangle = -1;
+        float tNodeMin = 0.f;
+        float tNodeMax = tMax;
+        for(int axis = 0; axis < 3; axis++)
+        {
+            if(direction[axis] == 0.f)
+            {
+                if(origin[axis] < bounds.min[axis] || origin[axis] > bounds.max[axis]) return result;
+                continue;
+            }
+            float t0 = (bounds.min[axis] - origin[axis]) / direction[axis];
+            float t1 = (bounds.max[axis] - origin[axis]) / direction[axis];
+            tNodeMin = std::max(tNodeMin, std::min(t0, t1));
+            tNodeMax = std::min(tNodeMax, std::max(t0, t1));
+        }
+        if(tNodeMin > tNodeMax) return result;
+
+        struct StackEntry
+        {
+            uint32_t node;
+            float tMin, tMax;
+        };
+        StackEntry stack[KD_MAX_DEPTH + 1];
+        int stackSize = 0;
+        uint32_t node = 0;
+        while(true)
+        {
+            if(result.t < tNodeMin)
+            {
+                if(stackSize == 0) break;
+                stackSize--;
+                node = stack[stackSize].node;
+                tNodeMin = stack[stackSize].tMin;
+                tNodeMax = stack[stackSize].tMax;
+                continue;
+            }
+            if(stats != nullptr) stats->nodeCount++;
+            KDLinearNode n = nodes[node];
+            uint32_t axis = n.flags & 3;
+            if(axis == KD_LEAF)
+            {
+                uint32_t count = n.flags >> 2;
+                for(uint32_t i = 0; i < count; i++)
+                {
+                    uint32_t triangle = count == 1 ? n.value : indices[n.value + i];
+                    Intersection candidate = intersectTriangle(triangle, origin, direction, result.t);
+                    if(stats != nullptr) stats->triangleTestCount++;
+                    if(!candidate.hit) continue;
+                    result.hit = true;
+                    result.t = candidate.t;
+                    result.triangle = (int)triangle;
+                    result.normal = candidate.normal;
+                }
+                if(stackSize == 0) break;
+                stackSize--;
+                node = stack[stackSize].node;
+                tNodeMin = stack[stackSize].tMin;
+                tNodeMax = stack[stackSize].tMax;
+                continue;
+            }
+            float split;
+            memcpy(&split, &n.value, sizeof(float));
+            bool leftFirst = origin[axis] < split || (origin[axis] == split && direction[axis] <= 0.f);
+            uint32_t first = leftFirst ? node + 1 : n.flags >> 2;
+            uint32_t second = leftFirst ? n.flags >> 2 : node + 1;
+            if(origin[axis] == split)
+            {
+                // A ray starting in the plane can hit the triangles on both sides of it at 0.
+                stack[stackSize++] = {second, tNodeMin, tNodeMax};
+                node = first;
+                continue;
+            }
+            if(direction[axis] == 0.f)
+            {
+                node = first;
+                continue;
+            }
+            float tPlane = (split - origin[axis]) / direction[axis];
+            if(tPlane > tNodeMax || tPlane <= 0.f) node = first;
+            else if(tPlane < tNodeMin) node = second;
+            else
+            {
+                stack[stackSize++] = {second, tPlane, tNodeMax};
+                node = first;
+                tNodeMax = tPlane;
+            }
+        }
+        return result;
+    }
+};
+
+extern "C"
+{
+/**
+ * Builds a SAH kd-tree over prims (see KDTreeBuilder). maxDepth of 0 or less picks
+ * 8 + 1.3 log2(primCount). The result is the bounds of the tree, the node count and the
+ * index count as ints, the nodes as two uints each (see KDLinearNode) and the triangle
+ * indices of the leaves holding more than one triangle.
+ */
+float* constructKDTree(float* prims, int primCount, int maxDepth)
+{
+    if(primCount <= 0)
+    {
+        fprintf(stderr, "constructKDTree: no triangles\n");
+        return nullptr;
+    }
+    if(maxDepth <= 0) maxDepth = (int)std::round(8 + 1.3f * std::log2((float)primCount));
+    maxDepth = std::min(maxDepth, KD_MAX_DEPTH);
+    KDTreeBuilder builder(prims, primCount, maxDepth);
+    builder.build();
+    if(builder.nodes.size() >= (1u << 30) || builder.indices.size() >= (1u << 30))
+    {
+        fprintf(stderr, "constructKDTree: %zu nodes and %zu indices exceed the 30 bit node fields\n", builder.nodes.size(), builder.indices.size());
+        return nullptr;
+    }
+    float* result = new (std::nothrow) float[8 + builder.nodes.size() * 2 + builder.indices.size()];
+    if(result == nullptr)
+    {
+        fprintf(stderr, "constructKDTree: out of memory for %zu nodes\n", builder.nodes.size());
+        return nullptr;
+    }
+    result[0] = builder.bounds.min.x;
+    result[1] = builder.bounds.min.y;
+    result[2] = builder.bounds.min.z;
+    result[3] = builder.bounds.max.x;
+    result[4] = builder.bounds.max.y;
+    result[5] = builder.bounds.max.z;
+    int counts[2] = {(int)builder.nodes.size(), (int)builder.indices.size()};
+    memcpy(result + 6, counts, sizeof(counts));
+    memcpy(result + 8, builder.nodes.data(), builder.nodes.size() * sizeof(KDLinearNode));
+    memcpy(result + 8 + builder.nodes.size() * 2, builder.indices.data(), builder.indices.size() * sizeof(uint32_t));
+    return result;
+}
+
+/**
+ * Casts rays against a constructKDTree result and the triangles prims it was built from
+ * with KDTreeTraversal. Per ray the result holds the hit distance (-1 on a miss), the
+ * triangle index as an int (-1 on a miss) and the triangle's normal. When traversalStats
+ * is not null it receives the average nodes visited and the average ray-triangle tests
+ * per ray.
+ */
+float* castRaysKDTree(float* tree, float* prims, float* rays, int rayCount, float* traversalStats)
+{
+    KDTreeTraversal traversal;
+    traversal.bounds.min = Vec3(tree[0], tree[1], tree[2]);
+    traversal.bounds.max = Vec3(tree[3], tree[4], tree[5]);
+    int nodeCount;
+    memcpy(&nodeCount, tree + 6, sizeof(int));
+    traversal.nodes = (const KDLinearNode*)(tree + 8);
+    traversal.indices = (const uint32_t*)(tree + 8 + (size_t)nodeCount * 2);
+    traversal.prims = prims;
+    float* result = new float[rayCount * 5];
+    KDTreeStats stats = {0, 0};
+    for(int r = 0; r < rayCount; r++)
+    {
+        const float* ray = rays + r * 6;
+        KDTreeHit hit = traversal.castRay(Vec3(ray[0], ray[1], ray[2]), Vec3(ray[3], ray[4], ray[5]), INFINITY, &stats);
+        result[r * 5] = hit.hit ? hit.t : -1.f;
+        memcpy(result + r * 5 + 1, &hit.triangle, sizeof(int));
+        result[r * 5 + 2] = hit.normal.x;
+        result[r * 5 + 3] = hit.normal.y;
+        result[r * 5 + 4] = hit.normal.z;
+    }
+    if(traversalStats != nullptr)
+    {
+        traversalStats[0] = rayCount > 0 ? (float)stats.nodeCount / rayCount : 0.f;
+        traversalStats[1] = rayCount > 0 ? (float)stats.triangleTestCount / rayCount : 0.f;
+    }
+    return result;
+}
+}
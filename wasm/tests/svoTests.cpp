@@ -0,0 +1,576 @@
+#include "../voxelGrid/voxelGrid.cpp"
+#include "testUtils.h"
+#include <map>
+
+// Checks of the SVO encodings and traversals against brute force. Build it a second time
+// with -DSVO_MAX_CHILD_OFFSET=16 to run every check with far pointers on most nodes.
+
+struct SVOLeafCube
+{
+    Bounds bounds;
+    int64_t entry;
+};
+
+// The cubes of all leaves of a constructSVO layout buffer, found by walking its entries.
+std::vector<SVOLeafCube> gatherLeafCubes(const float* svo)
+{
+    float size = svo[3] - svo[0];
+    SVOTraversal traversal{svo + 8, Vec3(svo[0], svo[1], svo[2]), size};
+    struct QueuedNode
+    {
+        int64_t entry;
+        Vec3 min;
+        float size;
+    };
+    std::vector<QueuedNode> queue = {{0, traversal.min, size}};
+    std::vector<SVOLeafCube> cubes;
+    int64_t lastFetch = 0;
+    for(size_t i = 0; i < queue.size(); i++)
+    {
+        QueuedNode node = queue[i];
+        uint32_t bits = traversal.word(node.entry, &lastFetch, nullptr);
+        if(bits & SVO_LEAF_BIT)
+        {
+            SVOLeafCube cube;
+            cube.bounds.min = node.min;
+            cube.bounds.max = node.min + Vec3(node.size, node.size, node.size);
+            cube.entry = node.entry;
+            cubes.push_back(cube);
+            continue;
+        }
+        int64_t child = traversal.firstChild(node.entry, bits, &lastFetch, nullptr);
+        float half = node.size / 2.f;
+        for(int c = 0; c < 8; c++)
+        {
+            if(!(bits & (1 << c))) continue;
+            queue.push_back({child++, node.min + Vec3((c & 1) * half, ((c >> 1) & 1) * half, ((c >> 2) & 1) * half), half});
+        }
+    }
+    return cubes;
+}
+
+float bruteForceCubeHit(const std::vector<SVOLeafCube>& cubes, const float* ray)
+{
+    Vec3 origin(ray[0], ray[1], ray[2]);
+    Vec3 invDir = Vec3(ray[3], ray[4], ray[5]).invApproximate();
+    float best = INFINITY;
+    for(const SVOLeafCube& cube : cubes)
+    {
+        Intersection hit = cube.bounds.intersectRayInvDir(origin, invDir, 0.f, INFINITY);
+        if(hit.hit && hit.t < best) best = hit.t;
+    }
+    return best;
+}
+
+// Counts the rays whose castRays* result (5 floats per ray, t first) misses the nearest cube.
+int countCubeHitMismatches(const float* hits, const std::vector<float>& rays, const std::vector<SVOLeafCube>& cubes, float size)
+{
+    int mismatches = 0;
+    for(size_t r = 0; r < rays.size() / 6; r++)
+    {
+        float expected = bruteForceCubeHit(cubes, rays.data() + r * 6);
+        float t = hits[r * 5];
+        bool same = t < 0 ? expected == INFINITY : std::fabs(t - expected) <= 1e-3f * size;
+        if(!same) mismatches++;
+    }
+    return mismatches;
+}
+
+// The leaf entry holding voxel (x, y, z), or -1 if it is empty. level receives the
+// leaf's level, which is above depth for simplified trees.
+int64_t findSVOLeaf(const float* svo, int depth, uint32_t x, uint32_t y, uint32_t z, int* level)
+{
+    SVOTraversal traversal{svo + 8, Vec3(), 1.f};
+    int64_t lastFetch = 0;
+    int64_t node = 0;
+    for(int d = 0; d <= depth; d++)
+    {
+        uint32_t bits = traversal.word(node, &lastFetch, nullptr);
+        if(bits & SVO_LEAF_BIT)
+        {
+            *level = d;
+            return node;
+        }
+        if(d == depth) break;
+        int shift = depth - d - 1;
+        int child = ((x >> shift) & 1) | (((y >> shift) & 1) << 1) | (((z >> shift) & 1) << 2);
+        uint32_t mask = bits & 0xFF;
+        if(!(mask & (1u << child))) return -1;
+        node = traversal.firstChild(node, bits, &lastFetch, nullptr) + __builtin_popcount(mask & ((1u << child) - 1));
+    }
+    return -1;
+}
+
+int testSVOLeaves(const std::vector<float>& mesh, int depth)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    float* svo = constructSVO(prims, primCount, depth, AverageNormals);
+    int entryCount;
+    memcpy(&entryCount, svo + 7, sizeof(int));
+    int farCount = 0;
+    for(int i = 0; i < entryCount; i++)
+    {
+        uint32_t bits;
+        memcpy(&bits, svo + 8 + i * 4, sizeof(uint32_t));
+        if((bits & SVO_FAR_BIT) && !(bits & SVO_LEAF_BIT)) farCount++;
+    }
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    SVOLevel leaves = gatherSVOLeaves(prims, primCount, props, AverageNormals);
+    int mismatches = 0;
+    for(int i = 0; i < leaves.size(); i++)
+    {
+        uint32_t x, y, z;
+        decodeMorton(leaves.codes[i], &x, &y, &z);
+        int level;
+        int64_t entry = findSVOLeaf(svo, depth, x, y, z, &level);
+        if(entry < 0 || level != depth || memcmp(svo + 8 + entry * 4 + 1, &leaves.normals[i], sizeof(Vec3)) != 0) mismatches++;
+    }
+    printf("  depth %d: %d entries, %d far, %d leaves, %d mismatches\n", depth, entryCount, farCount, leaves.size(), mismatches);
+    delete[] svo;
+    return mismatches;
+}
+
+int testSVOTraversal(const std::vector<float>& mesh, int depth, bool simplify)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    int removedCount = 0;
+    float* svo = simplify ?
+        constructSimplifiedSVO(prims, primCount, depth, AverageNormals, 0.3f, 0.05f, 0, &removedCount) :
+        constructSVO(prims, primCount, depth, AverageNormals);
+    float size = svo[3] - svo[0];
+    std::vector<SVOLeafCube> cubes = gatherLeafCubes(svo);
+    std::vector<float> rays = makeRays(Vec3(svo[0], svo[1], svo[2]) + Vec3(size, size, size) * 0.5f, size, 400, 5);
+    float stats[3];
+    float* hits = castRaysSVO(svo, rays.data(), 400, stats);
+    int mismatches = countCubeHitMismatches(hits, rays, cubes, size);
+    printf("  depth %d%s: %zu leaves, %.1f entry reads per ray, %d mismatches\n", depth, simplify ? " simplified" : "", cubes.size(), stats[0], mismatches);
+    delete[] hits;
+    delete[] svo;
+    return mismatches;
+}
+
+int testSVORopes(const std::vector<float>& mesh, int depth)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    float* svo = constructSVOWithRopes(prims, primCount, depth, AverageNormals);
+    float size = svo[3] - svo[0];
+    std::vector<SVOLeafCube> cubes = gatherLeafCubes(svo);
+    std::vector<float> rays = makeRays(Vec3(svo[0], svo[1], svo[2]) + Vec3(size, size, size) * 0.5f, size, 400, 5);
+    float stackStats[3], ropeStats[4];
+    float* stackHits = castRaysSVO(svo, rays.data(), 400, stackStats);
+    float* ropeHits = castRaysSVORopes(svo, rays.data(), 400, ropeStats);
+    int mismatches = countCubeHitMismatches(ropeHits, rays, cubes, size);
+    for(int r = 0; r < 400; r++)
+    {
+        // Every fourth ray runs along the z = 0 face, where either neighbouring leaf is a hit.
+        if(r % 4 == 1) continue;
+        if(memcmp(stackHits + r * 5 + 1, ropeHits + r * 5 + 1, sizeof(int)) != 0) mismatches++;
+    }
+    printf("  depth %d: %.1f entry reads per ray with the stack, %.1f plus %.1f rope words with ropes, %d mismatches\n",
+        depth, stackStats[0], ropeStats[0], ropeStats[3], mismatches);
+    delete[] stackHits;
+    delete[] ropeHits;
+    delete[] svo;
+    return mismatches;
+}
+
+int testSVOLayouts(const std::vector<float>& mesh, int depth)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    float* plain = constructSVO(prims, primCount, depth, AverageNormals);
+    int entryCount;
+    memcpy(&entryCount, plain + 7, sizeof(int));
+    float stats[3];
+    float* breadthFirst = constructSVOWithLayout(prims, primCount, depth, AverageNormals, BreadthFirstLayout, 0, 0, stats);
+    int mismatches = memcmp(plain, breadthFirst, (8 + entryCount * 4) * sizeof(float)) != 0 ? 1 : 0;
+    float size = plain[3] - plain[0];
+    std::vector<float> rays = makeRays(Vec3(plain[0], plain[1], plain[2]) + Vec3(size, size, size) * 0.5f, size, 2000, 7);
+    float* expected = castRaysSVO(plain, rays.data(), 2000, nullptr);
+    struct LayoutCase
+    {
+        const char* name;
+        int layout, topLevels, blockSize;
+    } cases[] = {{"blocks of 256", SubtreeBlockLayout, 3, 256}, {"blocks of 64", SubtreeBlockLayout, 0, 64}, {"van Emde Boas", VanEmdeBoasLayout, 0, 0}};
+    for(const LayoutCase& layoutCase : cases)
+    {
+        float* svo = constructSVOWithLayout(prims, primCount, depth, AverageNormals, layoutCase.layout, layoutCase.topLevels, layoutCase.blockSize, stats);
+        float* hits = castRaysSVO(svo, rays.data(), 2000, nullptr);
+        int layoutMismatches = 0;
+        for(int r = 0; r < 2000; r++)
+        {
+            // Entry indices differ between layouts; t and the normal must not.
+            if(hits[r * 5] != expected[r * 5] || memcmp(hits + r * 5 + 2, expected + r * 5 + 2, 3 * sizeof(float)) != 0) layoutMismatches++;
+        }
+        printf("  depth %d %s: %.1f entry reads per ray, %.0f entries between reads, %d mismatches\n", depth, layoutCase.name, stats[0], stats[1], layoutMismatches);
+        mismatches += layoutMismatches;
+        delete[] hits;
+        delete[] svo;
+    }
+    delete[] expected;
+    delete[] breadthFirst;
+    delete[] plain;
+    return mismatches;
+}
+
+// The leaf attribute index reached by descending levels levels of a topology stream, or -1.
+int descendTopology(const uint32_t* topology, int levels, int shiftBase, uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t node = 0;
+    for(int level = 0; level <= levels; level++)
+    {
+        uint32_t word = topology[node];
+        if(word & SVO_LEAF_BIT) return (int)SVO_LEAF_ATTRIBUTE(word);
+        if(level == levels) break;
+        int shift = shiftBase - level - 1;
+        int child = ((x >> shift) & 1) | (((y >> shift) & 1) << 1) | (((z >> shift) & 1) << 2);
+        uint32_t mask = word & 0xFF;
+        if(!(mask & (1u << child))) return -1;
+        uint32_t first = node + SVO_CHILD_OFFSET(word);
+        if(word & SVO_FAR_BIT) first = topology[first];
+        node = first + __builtin_popcount(mask & ((1u << child) - 1));
+    }
+    return -1;
+}
+
+int testPagedSVO(const std::vector<float>& mesh, int depth, int cutLevel)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    const char* pagePath = "svoTestPages.bin";
+    PagedSVOHandle* handle = createPagedSVO(prims, primCount, depth, cutLevel, AverageNormals, pagePath, 16);
+    if(handle == nullptr) return 1;
+    float* top = getPagedSVOTopTree(handle);
+    int pageCount;
+    memcpy(&pageCount, top + 9, sizeof(int));
+    const uint32_t* topTopology = (const uint32_t*)(top + 14);
+    // Requests of 16 pages at a time through a 16 page cache load every page once.
+    std::map<int, std::vector<uint32_t>> pages;
+    for(int first = 0; first < pageCount; first += 16)
+    {
+        std::vector<int> ids;
+        for(int id = first; id < std::min(pageCount, first + 16); id++) ids.push_back(id);
+        float* response = requestSVOPages(handle, ids.data(), (int)ids.size());
+        int counts[3];
+        memcpy(counts, response, sizeof(counts));
+        const float* page = response + 3 + counts[1];
+        for(int i = 0; i < counts[0]; i++)
+        {
+            int id;
+            uint32_t topologyCount, attributeCount;
+            memcpy(&id, page, sizeof(int));
+            memcpy(&topologyCount, page + 1, sizeof(uint32_t));
+            memcpy(&attributeCount, page + 2, sizeof(uint32_t));
+            pages[id].assign((const uint32_t*)(page + 1), (const uint32_t*)(page + 3 + topologyCount + attributeCount));
+            page += 3 + topologyCount + attributeCount;
+        }
+        delete[] response;
+    }
+    int mismatches = (int)pages.size() != pageCount ? 1 : 0;
+
+    float* svo = constructSVO(prims, primCount, depth, AverageNormals);
+    int subDepth = depth - cutLevel;
+    uint32_t subMask = (1u << subDepth) - 1;
+    auto check = [&](uint32_t x, uint32_t y, uint32_t z)
+    {
+        int level;
+        int64_t entry = findSVOLeaf(svo, depth, x, y, z, &level);
+        int pageId = descendTopology(topTopology, cutLevel, depth, x, y, z);
+        int attribute = -1;
+        const uint32_t* pageTopology = nullptr;
+        if(pageId >= 0 && pages.count(pageId))
+        {
+            pageTopology = pages[pageId].data() + 2;
+            attribute = descendTopology(pageTopology, subDepth, subDepth, x & subMask, y & subMask, z & subMask);
+        }
+        if((entry >= 0) != (attribute >= 0))
+        {
+            mismatches++;
+            return;
+        }
+        if(entry < 0) return;
+        Vec3 expected = Vec3(svo[8 + entry * 4 + 1], svo[8 + entry * 4 + 2], svo[8 + entry * 4 + 3]).normalized();
+        Vec3 normal;
+        unpackOctahedral(pageTopology[pages[pageId][0] + attribute], 15, &normal);
+        if((normal - expected).length() > 1e-3f) mismatches++;
+    };
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    SVOLevel leaves = gatherSVOLeaves(prims, primCount, props, AverageNormals);
+    for(int i = 0; i < leaves.size(); i++)
+    {
+        uint32_t x, y, z;
+        decodeMorton(leaves.codes[i], &x, &y, &z);
+        check(x, y, z);
+    }
+    std::mt19937 rng(3);
+    uint32_t size = 1u << depth;
+    for(int i = 0; i < 20000; i++) check(rng() % size, rng() % size, rng() % size);
+    printf("  depth %d cut at %d: %d pages, %d leaves, %d mismatches\n", depth, cutLevel, pageCount, leaves.size(), mismatches);
+    delete[] svo;
+    delete[] top;
+    destroyPagedSVO(handle);
+    remove(pagePath);
+    return mismatches;
+}
+
+// Reads the levels back from a constructSVO layout buffer.
+std::vector<SVOLevel> decodeSVOLevels(const float* svo, int depth)
+{
+    SVOTraversal traversal{svo + 8, Vec3(), 1.f};
+    int64_t lastFetch = 0;
+    std::vector<SVOLevel> levels(depth + 1);
+    std::vector<int64_t> entries = {0}, nextEntries;
+    levels[0].codes.push_back(0);
+    for(int d = 0; d <= depth; d++)
+    {
+        nextEntries.clear();
+        for(size_t i = 0; i < entries.size(); i++)
+        {
+            uint32_t bits = traversal.word(entries[i], &lastFetch, nullptr);
+            uint8_t mask = (bits & SVO_LEAF_BIT) ? 0 : (uint8_t)(bits & 0xFF);
+            levels[d].childMasks.push_back(mask);
+            levels[d].normals.push_back(traversal.normal(entries[i]));
+            if(mask == 0) continue;
+            int64_t child = traversal.firstChild(entries[i], bits, &lastFetch, nullptr);
+            for(int c = 0; c < 8; c++)
+            {
+                if(!(mask & (1 << c))) continue;
+                nextEntries.push_back(child++);
+                levels[d + 1].codes.push_back(levels[d].codes[i] << 3 | c);
+            }
+        }
+        entries.swap(nextEntries);
+    }
+    return levels;
+}
+
+bool sameSVOLevels(const std::vector<SVOLevel>& a, const std::vector<SVOLevel>& b)
+{
+    for(size_t d = 0; d < a.size(); d++)
+    {
+        if(a[d].codes != b[d].codes || a[d].childMasks != b[d].childMasks) return false;
+        if(memcmp(a[d].normals.data(), b[d].normals.data(), a[d].normals.size() * sizeof(Vec3)) != 0) return false;
+    }
+    return true;
+}
+
+// Random batches of edits, applied through the returned ranges to a copy of the buffer,
+// must decode to the levels buildSVOLevels gives for the edited leaves.
+int testDynamicSVO(const std::vector<float>& mesh, int depth)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    DynamicSVOHandle* handle = createDynamicSVO(prims, primCount, depth, AverageNormals);
+    float* reference = constructSVO(prims, primCount, depth, AverageNormals);
+    std::vector<SVOLevel> referenceLevels = decodeSVOLevels(reference, depth);
+    float* initial = getDynamicSVO(handle);
+    int entryCount;
+    memcpy(&entryCount, initial + 7, sizeof(int));
+    int mismatches = sameSVOLevels(referenceLevels, decodeSVOLevels(initial, depth)) ? 0 : 1;
+    std::vector<float> mirror(initial, initial + 8 + entryCount * 4);
+    delete[] initial;
+    delete[] reference;
+
+    std::map<uint64_t, Vec3> leaves;
+    for(int i = 0; i < referenceLevels[depth].size(); i++) leaves[referenceLevels[depth].codes[i]] = referenceLevels[depth].normals[i];
+    std::mt19937 rng(depth);
+    int size = 1 << depth;
+    std::uniform_int_distribution<int> coordinate(0, size - 1);
+    std::uniform_real_distribution<float> component(-1.f, 1.f);
+    long long uploadedBytes = 0, fullBytes = 0;
+    for(int round = 0; round < 60 && mismatches == 0; round++)
+    {
+        int count = 1 + rng() % 40;
+        int operation = rng() % 3;
+        std::vector<int> voxels;
+        std::vector<float> normals;
+        for(int i = 0; i < count; i++)
+        {
+            uint32_t x = coordinate(rng), y = coordinate(rng), z = coordinate(rng);
+            if(operation != 0 && !leaves.empty() && rng() % 4 != 0)
+            {
+                auto leaf = leaves.begin();
+                std::advance(leaf, rng() % leaves.size());
+                decodeMorton(leaf->first, &x, &y, &z);
+            }
+            // Every seventh round has voxels outside the grid, which the edits skip.
+            if(round % 7 == 0) x = size;
+            voxels.insert(voxels.end(), {(int)x, (int)y, (int)z});
+            normals.insert(normals.end(), {component(rng), component(rng), component(rng)});
+        }
+        float* ranges = operation == 0 ? insertSVOVoxels(handle, voxels.data(), normals.data(), count) :
+            operation == 1 ? removeSVOVoxels(handle, voxels.data(), count) :
+            setSVONormals(handle, voxels.data(), normals.data(), count);
+        for(int i = 0; i < count; i++)
+        {
+            if(voxels[i * 3] >= size) continue;
+            uint64_t code = encodeMorton(voxels[i * 3], voxels[i * 3 + 1], voxels[i * 3 + 2]);
+            Vec3 normal(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+            if(operation == 0) leaves[code] = normal;
+            else if(operation == 1) leaves.erase(code);
+            else if(leaves.count(code)) leaves[code] = normal;
+        }
+        int rangeCount;
+        memcpy(&rangeCount, ranges, sizeof(int));
+        const float* data = ranges + 1 + rangeCount * 2;
+        for(int i = 0; i < rangeCount; i++)
+        {
+            int range[2];
+            memcpy(range, ranges + 1 + i * 2, sizeof(range));
+            if(mirror.size() < (size_t)(range[0] + range[1]) / 4) mirror.resize((range[0] + range[1]) / 4, 0.f);
+            memcpy(mirror.data() + range[0] / 4, data, range[1]);
+            data += range[1] / 4;
+            uploadedBytes += range[1];
+        }
+        delete[] ranges;
+        memcpy(&entryCount, mirror.data() + 7, sizeof(int));
+        fullBytes += (8 + entryCount * 4) * sizeof(float);
+
+        std::vector<SVOLevel> edited = decodeSVOLevels(mirror.data(), depth);
+        if(leaves.empty())
+        {
+            if(edited[0].childMasks[0] != 0) mismatches++;
+            continue;
+        }
+        SVOLevel leafLevel;
+        for(const auto& leaf : leaves)
+        {
+            leafLevel.codes.push_back(leaf.first);
+            leafLevel.normals.push_back(leaf.second);
+        }
+        if(!sameSVOLevels(buildSVOLevels(leafLevel, depth), edited)) mismatches++;
+    }
+    printf("  depth %d: %zu leaves after the edits, uploaded %.1f%% of the bytes of full re-uploads, %d mismatches\n",
+        depth, leaves.size(), 100.0 * uploadedBytes / fullBytes, mismatches);
+    destroyDynamicSVO(handle);
+    return mismatches;
+}
+
+/**
+ * Refines in steps of stepNodes nodes and reads every level but skippedLevel. Each result
+ * must hold the frontier as leaves of its level with their attributes, and the last one
+ * must equal constructSVO's.
+ */
+int testProgressiveSVO(const std::vector<float>& mesh, int depth, int stepNodes, int skippedLevel)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    ProgressiveSVOHandle* handle = createProgressiveSVO(prims, primCount, depth, 2, AverageNormals);
+    int mismatches = 0, steps = 0;
+    while(true)
+    {
+        int level = handle->level;
+        if(level != skippedLevel)
+        {
+            float* svo = getProgressiveSVO(handle);
+            const SVOLevel& frontier = handle->frontier;
+            for(int i = 0; i < frontier.size(); i++)
+            {
+                uint32_t x, y, z;
+                decodeMorton(frontier.codes[i], &x, &y, &z);
+                int leafLevel;
+                int64_t entry = findSVOLeaf(svo, level, x, y, z, &leafLevel);
+                if(entry < 0 || leafLevel != level || memcmp(svo + 8 + entry * 4 + 1, &frontier.normals[i], sizeof(Vec3)) != 0) mismatches++;
+            }
+            if(level == depth)
+            {
+                float* reference = constructSVO(prims, primCount, depth, AverageNormals);
+                int entryCount;
+                memcpy(&entryCount, reference + 7, sizeof(int));
+                if(memcmp(svo, reference, (8 + (size_t)entryCount * 4) * sizeof(float)) != 0) mismatches++;
+                delete[] reference;
+            }
+            delete[] svo;
+        }
+        if(level == depth) break;
+        while(refineProgressiveSVOLevel(handle, stepNodes) == level) steps++;
+        steps++;
+    }
+    printf("  %d triangles depth %d in %d steps%s: %d mismatches\n", primCount, depth, steps, handle->hasStaleLeaves ? ", stale leaves" : "", mismatches);
+    destroyProgressiveSVO(handle);
+    return mismatches;
+}
+
+int testHybridSVO(const std::vector<float>& mesh, int depth)
+{
+    float* prims = (float*)mesh.data();
+    int primCount = (int)mesh.size() / 9;
+    float* svo = constructHybridSVO(prims, primCount, depth);
+    float* reference = constructSVO(prims, primCount, depth, AverageNormals);
+    int entryCount;
+    memcpy(&entryCount, reference + 7, sizeof(int));
+    int mismatches = 0;
+    for(int i = 0; i < entryCount; i++)
+    {
+        uint32_t bits;
+        memcpy(&bits, reference + 8 + i * 4, sizeof(uint32_t));
+        if(!(bits & SVO_LEAF_BIT) && memcmp(reference + 8 + i * 4, svo + 8 + i * 4, 4 * sizeof(float)) != 0) mismatches++;
+    }
+    std::vector<float> rays = makeRays(Vec3(0, 0, 0), 2.f, 2000, 1);
+    float stats[2];
+    float* hits = castRaysSVOHybrid(svo, prims, rays.data(), 2000, stats);
+    for(int r = 0; r < 2000; r++)
+    {
+        int expectedTriangle, triangle;
+        float expected = bruteForceTriangleHit(mesh, rays.data() + r * 6, &expectedTriangle);
+        memcpy(&triangle, hits + r * 5 + 1, sizeof(int));
+        bool same = expectedTriangle < 0 ? triangle < 0 : triangle >= 0 && std::fabs(hits[r * 5] - expected) < 1e-4f;
+        if(!same) mismatches++;
+    }
+    printf("  %d triangles depth %d: %.1f entry reads and %.1f triangle tests per ray, %d mismatches\n", primCount, depth, stats[0], stats[1], mismatches);
+    delete[] hits;
+    delete[] reference;
+    delete[] svo;
+    return mismatches;
+}
+
+int main()
+{
+    printf("SVO_MAX_CHILD_OFFSET %d\n", SVO_MAX_CHILD_OFFSET);
+    std::vector<float> sphere = makeSphere(96, 48, 1.f);
+    std::vector<float> smallSphere = makeSphere(64, 32, 1.f);
+    std::vector<float> smallNestedSpheres = makeNestedSpheres(48);
+    std::vector<float> nestedSpheres = makeNestedSpheres(256);
+    int failures = 0;
+
+    int leafMismatches = 0;
+    for(int depth : {1, 5, 8, 10}) leafMismatches += testSVOLeaves(sphere, depth);
+    failures += reportTest("constructSVO leaves", leafMismatches);
+
+    int traversalMismatches = 0;
+    for(int depth : {0, 1, 5, 7, 9}) traversalMismatches += testSVOTraversal(sphere, depth, false);
+    traversalMismatches += testSVOTraversal(sphere, 7, true);
+    failures += reportTest("castRaysSVO against brute force", traversalMismatches);
+
+    int ropeMismatches = 0;
+    for(int depth : {0, 1, 5, 7, 9}) ropeMismatches += testSVORopes(sphere, depth);
+    failures += reportTest("castRaysSVORopes against brute force and castRaysSVO", ropeMismatches);
+
+    int layoutMismatches = 0;
+    for(int depth : {5, 8}) layoutMismatches += testSVOLayouts(sphere, depth);
+    failures += reportTest("constructSVOWithLayout", layoutMismatches);
+
+    failures += reportTest("createPagedSVO pages", testPagedSVO(sphere, 8, 3));
+
+    int dynamicMismatches = 0;
+    for(int depth : {1, 3, 6, 8}) dynamicMismatches += testDynamicSVO(smallSphere, depth);
+    failures += reportTest("dynamic SVO edits", dynamicMismatches);
+
+    std::vector<float> soup = makeTriangleSoup(20000, 1);
+    int progressiveMismatches = testProgressiveSVO(sphere, 8, 1000, -1);
+    progressiveMismatches += testProgressiveSVO(sphere, 8, 0, 5);
+    progressiveMismatches += testProgressiveSVO(soup, 8, 5000, -1);
+    failures += reportTest("progressive SVO levels", progressiveMismatches);
+
+    int hybridMismatches = 0;
+    for(int depth : {0, 2, 5, 7})
+    {
+        hybridMismatches += testHybridSVO(smallNestedSpheres, depth);
+        hybridMismatches += testHybridSVO(nestedSpheres, depth);
+    }
+    failures += reportTest("castRaysSVOHybrid against brute force", hybridMismatches);
+    return failures == 0 ? 0 : 1;
+}
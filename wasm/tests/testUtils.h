@@ -0,0 +1,125 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+#include "../includes/mathutils.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Native checks of the wasm sources, built with the test lines of emscriptencommand.txt.
+// Each test prints one line with its measurements and returns the number of mismatches.
+
+// Closed UV sphere of the given radius around the origin, as a triangle soup.
+std::vector<float> makeSphere(int segments, int rings, float radius)
+{
+    std::vector<float> result;
+    auto point = [&](int i, int j)
+    {
+        float theta = (float)M_PI * j / rings;
+        float phi = 2.f * (float)M_PI * i / segments;
+        return Vec3(radius * sinf(theta) * cosf(phi), radius * cosf(theta), radius * sinf(theta) * sinf(phi));
+    };
+    auto addTriangle = [&](Vec3 a, Vec3 b, Vec3 c)
+    {
+        float values[9] = {a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z};
+        result.insert(result.end(), values, values + 9);
+    };
+    for(int j = 0; j < rings; j++)
+    {
+        for(int i = 0; i < segments; i++)
+        {
+            Vec3 a = point(i, j), b = point(i + 1, j), c = point(i + 1, j + 1), d = point(i, j + 1);
+            if(j != 0) addTriangle(a, c, b);
+            if(j != rings - 1) addTriangle(a, d, c);
+        }
+    }
+    return result;
+}
+
+// A sphere with a second, smaller one inside, so rays cross several surfaces.
+std::vector<float> makeNestedSpheres(int segments)
+{
+    std::vector<float> result = makeSphere(segments, segments / 2, 1.f);
+    std::vector<float> inner = makeSphere(segments / 2, segments / 4, 0.5f);
+    result.insert(result.end(), inner.begin(), inner.end());
+    return result;
+}
+
+// count small random triangles in the [-1, 1] cube, the worst case for coarse overlap tests.
+std::vector<float> makeTriangleSoup(int count, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<float> result;
+    for(int i = 0; i < count; i++)
+    {
+        Vec3 center(uniform(rng), uniform(rng), uniform(rng));
+        for(int v = 0; v < 3; v++)
+        {
+            Vec3 vertex = center + Vec3(uniform(rng), uniform(rng), uniform(rng)) * 0.05f;
+            result.insert(result.end(), {vertex.x, vertex.y, vertex.z});
+        }
+    }
+    return result;
+}
+
+/**
+ * rayCount rays (origin and direction each) around a cube of the given center and size:
+ * rays from inside, axis-aligned rays from above and rays from the surrounding sphere
+ * towards the middle.
+ */
+std::vector<float> makeRays(Vec3 center, float size, int rayCount, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    auto randomVec = [&]() { return Vec3(uniform(rng), uniform(rng), uniform(rng)); };
+    std::vector<float> rays;
+    for(int i = 0; i < rayCount; i++)
+    {
+        Vec3 origin, direction;
+        if(i % 4 == 0)
+        {
+            origin = center + randomVec() * (size * 0.1f);
+            direction = randomVec().normalized();
+        }
+        else if(i % 4 == 1)
+        {
+            origin = center + Vec3(uniform(rng) * size * 2.f, size * 1.5f, 0.f);
+            direction = Vec3(0, -1, 0);
+        }
+        else
+        {
+            origin = center + randomVec().normalized() * size;
+            direction = (center + randomVec() * (size * 0.3f) - origin).normalized();
+        }
+        float values[6] = {origin.x, origin.y, origin.z, direction.x, direction.y, direction.z};
+        rays.insert(rays.end(), values, values + 6);
+    }
+    return rays;
+}
+
+// Nearest hit of the ray with any of the triangles, by testing all of them.
+float bruteForceTriangleHit(const std::vector<float>& prims, const float* ray, int* triangleIndex)
+{
+    Vec3 origin(ray[0], ray[1], ray[2]);
+    Vec3 direction(ray[3], ray[4], ray[5]);
+    float best = INFINITY;
+    *triangleIndex = -1;
+    for(size_t i = 0; i < prims.size() / 9; i++)
+    {
+        const float* p = prims.data() + i * 9;
+        Triangle triangle = {Vec3(p[0], p[1], p[2]), Vec3(p[3], p[4], p[5]), Vec3(p[6], p[7], p[8])};
+        Intersection hit = triangle.intersectRay(origin, direction, 0.f, best);
+        if(!hit.hit) continue;
+        best = hit.t;
+        *triangleIndex = (int)i;
+    }
+    return best;
+}
+
+int reportTest(const char* name, int failures)
+{
+    printf("%s %s\n", failures == 0 ? "ok    " : "FAILED", name);
+    return failures;
+}
+#endif
@@ -1,10 +1,25 @@
 #include "../includes/mathutils.h"
-#include "../includes/triangleIntersects.h"
+#include "../includes/triangleboxbatch.h"
 #include "../includes/svo.h"
+#include "../includes/svodag.h"
+#include "../includes/svoedit.h"
+#include "../includes/svopages.h"
+#include "../includes/svotraversal.h"
+#include "../includes/trianglegrid.h"
+#include "../includes/octahedral.h"
+#include "../includes/parallel.h"
+#include "../includes/qef.h"
 #include <cmath>
 #include <cstring>
-#include <queue>
+#include <vector>
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <new>
+#include <atomic>
+#include <random>
 
 template <typename T>
 T tripleMin(T a, T b, T c)
@@ -43,96 +58,369 @@ indexTriplet getIndices(Vec3 point, Vec3 minPoint, float voxelSize)
 struct GridProperties
 {
     Vec3 min;
-    int* gridSize;
+    int gridSize[3];
     float voxelSize;
 };
 
-Voxel* initGrid(float* prims, int primCount, GridProperties props)
+// Bounds of the vertices of primCount triangles.
+Bounds computePrimBounds(float* prims, int primCount)
 {
-    int gridSize[3] = {props.gridSize[0], props.gridSize[1], props.gridSize[2]};
-    float voxelSize = props.voxelSize;
-    Vec3 min = props.min;
-    Voxel* grid = new Voxel[gridSize[0] * gridSize[1] * gridSize[2]];
-    int yMultiplier = gridSize[2];
-    int xMultiplier = gridSize[1] * gridSize[2];
-    Vec3 halfVxExtents = Vec3(voxelSize / 2.f, voxelSize / 2.f, voxelSize / 2.f);
+    Bounds bounds;
+    bounds.min = Vec3(prims[0], prims[1], prims[2]);
+    bounds.max = bounds.min;
+    for(int i = 1; i < primCount * 3; i++)
+    {
+        bounds.min.min(prims[i * 3 + 0], prims[i * 3 + 1], prims[i * 3 + 2]);
+        bounds.max.max(prims[i * 3 + 0], prims[i * 3 + 1], prims[i * 3 + 2]);
+    }
+    return bounds;
+}
 
-    for(int i = 0; i < primCount; i++)
+GridProperties computeGridProperties(float* prims, int primCount, int size)
+{
+    Bounds bounds = computePrimBounds(prims, primCount);
+    Vec3 min = bounds.min;
+    Vec3 max = bounds.max;
+    Vec3 extents = max - min;
+    float maxExtent = extents.maxComponent();
+    float voxelSize = maxExtent / (float)(size - 1);
+    min.sub(voxelSize / 2);
+    max.add(voxelSize / 2);
+    extents = max - min;
+    maxExtent = extents.maxComponent();
+    voxelSize = maxExtent / (float)(size);
+    GridProperties props;
+    props.min = min;
+    props.gridSize[0] = (int)std::ceil(extents.x / voxelSize);
+    props.gridSize[1] = (int)std::ceil(extents.y / voxelSize);
+    props.gridSize[2] = (int)std::ceil(extents.z / voxelSize);
+    props.voxelSize = voxelSize;
+    return props;
+}
+
+struct VoxelRange
+{
+    int min[3];
+    int max[3];
+
+    bool isEmpty() const
     {
-        Vec3 p1 = Vec3(prims[i * 9 + 0], prims[i * 9 + 1], prims[i * 9 + 2]);
-        Vec3 p2 = Vec3(prims[i * 9 + 3], prims[i * 9 + 4], prims[i * 9 + 5]);
-        Vec3 p3 = Vec3(prims[i * 9 + 6], prims[i * 9 + 7], prims[i * 9 + 8]);
+        return min[0] > max[0] || min[1] > max[1] || min[2] > max[2];
+    }
+
+    void unionWith(const VoxelRange& other)
+    {
+        if(other.isEmpty()) return;
+        if(isEmpty())
+        {
+            *this = other;
+            return;
+        }
+        for(int i = 0; i < 3; i++)
+        {
+            min[i] = std::min(min[i], other.min[i]);
+            max[i] = std::max(max[i], other.max[i]);
+        }
+    }
+};
+
+VoxelRange emptyVoxelRange()
+{
+    return {{0, 0, 0}, {-1, -1, -1}};
+}
+
+VoxelRange fullVoxelRange(GridProperties props)
+{
+    return {{0, 0, 0}, {props.gridSize[0] - 1, props.gridSize[1] - 1, props.gridSize[2] - 1}};
+}
+
+// Voxels tested against a triangle at once by forEachOverlappedVoxel.
+#define VOXEL_OVERLAP_BATCH 8
+// Triangles overlapping fewer candidate voxels test them one at a time with
+// TriangleBoxBatch::overlaps, which gives the same results as the batched lanes.
+#define VOXEL_OVERLAP_BATCH_MIN 4
+
+/**
+ * Calls fn(x, y, z) for every voxel inside window that the triangle overlaps and returns
+ * the voxel range that was tested, clamped to window. The voxel cubes are grown by margin
+ * on every side for the overlap test. Voxels are tested VOXEL_OVERLAP_BATCH at a time with
+ * TriangleBoxBatch and reported in x, y, z order.
+ */
+template <typename F>
+VoxelRange forEachOverlappedVoxel(GridProperties props, const float* tri, VoxelRange window, F fn, float margin = 0.f)
+{
+    float voxelSize = props.voxelSize;
+    Vec3 min = props.min;
+    float halfExtent = voxelSize / 2.f + margin;
+    Vec3 halfVxExtents = Vec3(halfExtent, halfExtent, halfExtent);
 
-        Triangle tri = {p1, p2, p3};
+    Vec3 p1 = Vec3(tri[0], tri[1], tri[2]);
+    Vec3 p2 = Vec3(tri[3], tri[4], tri[5]);
+    Vec3 p3 = Vec3(tri[6], tri[7], tri[8]);
 
-        indexTriplet p1Index = getIndices(p1, min, voxelSize);
-        indexTriplet p2Index = getIndices(p2, min, voxelSize);
-        indexTriplet p3Index = getIndices(p3, min, voxelSize);
+    indexTriplet p1Index = getIndices(p1, min, voxelSize);
+    indexTriplet p2Index = getIndices(p2, min, voxelSize);
+    indexTriplet p3Index = getIndices(p3, min, voxelSize);
 
-        int pminx = tripleMin(p1Index.x, p2Index.x, p3Index.x);
-        int pminy = tripleMin(p1Index.y, p2Index.y, p3Index.y);
-        int pminz = tripleMin(p1Index.z, p2Index.z, p3Index.z);
+    VoxelRange range;
+    range.min[0] = std::max(tripleMin(p1Index.x, p2Index.x, p3Index.x), window.min[0]);
+    range.min[1] = std::max(tripleMin(p1Index.y, p2Index.y, p3Index.y), window.min[1]);
+    range.min[2] = std::max(tripleMin(p1Index.z, p2Index.z, p3Index.z), window.min[2]);
 
-        int pmaxx = tripleMax(p1Index.x, p2Index.x, p3Index.x);
-        int pmaxy = tripleMax(p1Index.y, p2Index.y, p3Index.y);
-        int pmaxz = tripleMax(p1Index.z, p2Index.z, p3Index.z);
+    range.max[0] = std::min(tripleMax(p1Index.x, p2Index.x, p3Index.x), window.max[0]);
+    range.max[1] = std::min(tripleMax(p1Index.y, p2Index.y, p3Index.y), window.max[1]);
+    range.max[2] = std::min(tripleMax(p1Index.z, p2Index.z, p3Index.z), window.max[2]);
 
-        for(int x = pminx; x <= pmaxx; x++)
+    TriangleBoxBatch batch(p1, p2, p3, halfVxExtents);
+    int voxelCount = 1;
+    for(int i = 0; i < 3; i++) voxelCount *= std::max(0, range.max[i] - range.min[i] + 1);
+    if(voxelCount < VOXEL_OVERLAP_BATCH_MIN)
+    {
+        for(int x = range.min[0]; x <= range.max[0]; x++)
         {
-            for(int y = pminy; y <= pmaxy; y++)
+            for(int y = range.min[1]; y <= range.max[1]; y++)
             {
-                for(int z = pminz; z <= pmaxz; z++)
+                for(int z = range.min[2]; z <= range.max[2]; z++)
                 {
                     Vec3 vxCenter = min + Vec3((x + 0.5f) * voxelSize, (y + 0.5f) * voxelSize, (z + 0.5f) * voxelSize);
-                    Vec3 testp1 = p1;
-                    Vec3 testp2 = p2;
-                    Vec3 testp3 = p3;
-                    Vec3 testHalfSize = halfVxExtents;
-                    bool intersects = threeyd::moeller::TriangleIntersects<Vec3>::box(testp1, testp2, testp3, vxCenter, testHalfSize);
-                    if(intersects)
-                    {
-                        Voxel& vx = grid[x * xMultiplier + y * yMultiplier + z];
-                        vx.childCount++;
-                        Vec3 normal = (p3 - p1).cross(p2 - p1).normalized();
-                        vx.normalSum.add(normal);
-                    }
+                    if(batch.overlaps(vxCenter)) fn(x, y, z);
                 }
             }
         }
+        return range;
+    }
+
+    float centerX[VOXEL_OVERLAP_BATCH] = {}, centerY[VOXEL_OVERLAP_BATCH] = {}, centerZ[VOXEL_OVERLAP_BATCH] = {};
+    int batchVoxels[VOXEL_OVERLAP_BATCH][3];
+    int batchCount = 0;
+    auto testBatch = [&]()
+    {
+        uint32_t mask = batch.overlapMask<VOXEL_OVERLAP_BATCH>(centerX, centerY, centerZ, batchCount);
+        while(mask != 0)
+        {
+            int i = __builtin_ctz(mask);
+            mask &= mask - 1;
+            fn(batchVoxels[i][0], batchVoxels[i][1], batchVoxels[i][2]);
+        }
+        batchCount = 0;
+    };
+    for(int x = range.min[0]; x <= range.max[0]; x++)
+    {
+        for(int y = range.min[1]; y <= range.max[1]; y++)
+        {
+            for(int z = range.min[2]; z <= range.max[2]; z++)
+            {
+                Vec3 vxCenter = min + Vec3((x + 0.5f) * voxelSize, (y + 0.5f) * voxelSize, (z + 0.5f) * voxelSize);
+                centerX[batchCount] = vxCenter.x;
+                centerY[batchCount] = vxCenter.y;
+                centerZ[batchCount] = vxCenter.z;
+                batchVoxels[batchCount][0] = x;
+                batchVoxels[batchCount][1] = y;
+                batchVoxels[batchCount][2] = z;
+                if(++batchCount == VOXEL_OVERLAP_BATCH) testBatch();
+            }
+        }
+    }
+    if(batchCount > 0) testBatch();
+    return range;
+}
+
+/**
+ * Adds weight (+1 or -1) times the triangle's contribution to every voxel it overlaps and
+ * returns the voxel range that was tested, clamped to the grid.
+ */
+VoxelRange addTriangleToGrid(Voxel* grid, GridProperties props, const float* tri, int weight)
+{
+    Vec3 p1 = Vec3(tri[0], tri[1], tri[2]);
+    Vec3 p2 = Vec3(tri[3], tri[4], tri[5]);
+    Vec3 p3 = Vec3(tri[6], tri[7], tri[8]);
+    Vec3 normal = (p3 - p1).cross(p2 - p1).normalized();
+    int xMultiplier = props.gridSize[1] * props.gridSize[2];
+    int yMultiplier = props.gridSize[2];
+    return forEachOverlappedVoxel(props, tri, fullVoxelRange(props), [&](int x, int y, int z)
+    {
+        Voxel& vx = grid[x * xMultiplier + y * yMultiplier + z];
+        vx.childCount += weight;
+        vx.normalSum.add(normal * (float)weight);
+        if(vx.childCount == 0) vx.normalSum.zero();
+    });
+}
+
+Voxel* initGrid(float* prims, int primCount, GridProperties props)
+{
+    Voxel* grid = new Voxel[props.gridSize[0] * props.gridSize[1] * props.gridSize[2]];
+    for(int i = 0; i < primCount; i++)
+    {
+        addTriangleToGrid(grid, props, prims + i * 9, 1);
     }
     return grid;
 }
 
-extern "C"
+struct ScanlineCrossings
+{
+    std::vector<float>* columns;
+    int columnCount;
+};
+
+bool ownsScanlineEdge(double ex, double ey)
+{
+    return ey > 0 || (ey == 0 && ex < 0);
+}
+
+// A triangle projected along a scanline axis, wound counter-clockwise in (u, v), with the
+// range of voxel-center columns its projection covers.
+struct ScanlineTriangle
 {
-float* constructVoxelGrid(float* prims, int primCount, int size)
+    double pu[3], pv[3];
+    Vec3 normal;
+    double planeD;
+    int minU, maxU, minV, maxV;
+};
+
+// Collects, for every voxel-center column along the given axis, the axis coordinates at
+// which the column pierces a triangle. Columns running exactly through a shared edge or
+// vertex are counted once by using a top-left ownership rule for the projected edges.
+// Triangles are bucketed per u row so each row can be processed by its own worker.
+ScanlineCrossings gatherScanlineCrossings(float* prims, int primCount, GridProperties props, int axis)
 {
-    Vec3 min(prims[0], prims[1], prims[2]);
-    Vec3 max = min;
-    for(int i = 1; i < primCount * 3; i++)
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    int sizeU = props.gridSize[u];
+    int sizeV = props.gridSize[v];
+    float voxelSize = props.voxelSize;
+    std::vector<ScanlineTriangle> triangles(primCount);
+    parallelFor(0, primCount, [&](int i)
+    {
+        Vec3 p[3] = {
+            Vec3(prims[i * 9 + 0], prims[i * 9 + 1], prims[i * 9 + 2]),
+            Vec3(prims[i * 9 + 3], prims[i * 9 + 4], prims[i * 9 + 5]),
+            Vec3(prims[i * 9 + 6], prims[i * 9 + 7], prims[i * 9 + 8])
+        };
+        ScanlineTriangle& tri = triangles[i];
+        double* pu = tri.pu;
+        double* pv = tri.pv;
+        for(int k = 0; k < 3; k++)
+        {
+            pu[k] = p[k][u];
+            pv[k] = p[k][v];
+        }
+        // Degenerate projections cover no columns.
+        tri.minU = 0;
+        tri.maxU = -1;
+        double area = (pu[1] - pu[0]) * (pv[2] - pv[0]) - (pv[1] - pv[0]) * (pu[2] - pu[0]);
+        if(area == 0) return;
+        if(area < 0)
+        {
+            std::swap(pu[1], pu[2]);
+            std::swap(pv[1], pv[2]);
+        }
+        tri.normal = (p[1] - p[0]).cross(p[2] - p[0]);
+        tri.planeD = tri.normal.dot(p[0]);
+
+        tri.minU = std::max((int)std::ceil((tripleMin(pu[0], pu[1], pu[2]) - props.min[u]) / voxelSize - 0.5), 0);
+        tri.maxU = std::min((int)std::floor((tripleMax(pu[0], pu[1], pu[2]) - props.min[u]) / voxelSize - 0.5), sizeU - 1);
+        tri.minV = std::max((int)std::ceil((tripleMin(pv[0], pv[1], pv[2]) - props.min[v]) / voxelSize - 0.5), 0);
+        tri.maxV = std::min((int)std::floor((tripleMax(pv[0], pv[1], pv[2]) - props.min[v]) / voxelSize - 0.5), sizeV - 1);
+    }, 256);
+    std::vector<std::vector<int>> rowTriangles(sizeU);
+    for(int i = 0; i < primCount; i++)
     {
-        min.min(prims[i * 3 + 0], prims[i * 3 + 1], prims[i * 3 + 2]);
-        max.max(prims[i * 3 + 0], prims[i * 3 + 1], prims[i * 3 + 2]);
+        for(int iu = triangles[i].minU; iu <= triangles[i].maxU; iu++)
+        {
+            rowTriangles[iu].push_back(i);
+        }
     }
-    Vec3 extents = max - min;
-    float maxExtent = extents.maxComponent();
-    float voxelSize = maxExtent / (float)(size - 1);
-    min.sub(voxelSize / 2);
-    max.add(voxelSize / 2);
-    extents = max - min;
-    maxExtent = extents.maxComponent();
-    voxelSize = maxExtent / (float)(size);
-    int gridSize[3] = {(int)std::ceil(extents.x / voxelSize), (int)std::ceil(extents.y / voxelSize), (int)std::ceil(extents.z / voxelSize)};
-    max = min + Vec3(gridSize[0] * voxelSize, gridSize[1] * voxelSize, gridSize[2] * voxelSize);
-    Voxel* grid = initGrid(prims, primCount, {min, gridSize, voxelSize});
+
+    ScanlineCrossings crossings;
+    crossings.columnCount = sizeU * sizeV;
+    crossings.columns = new std::vector<float>[crossings.columnCount];
+    parallelFor(0, sizeU, [&](int iu)
+    {
+        double cu = props.min[u] + (iu + 0.5) * voxelSize;
+        for(int triIndex : rowTriangles[iu])
+        {
+            const ScanlineTriangle& tri = triangles[triIndex];
+            const double* pu = tri.pu;
+            const double* pv = tri.pv;
+            for(int iv = tri.minV; iv <= tri.maxV; iv++)
+            {
+                double cv = props.min[v] + (iv + 0.5) * voxelSize;
+                bool inside = true;
+                for(int e = 0; e < 3 && inside; e++)
+                {
+                    int n = (e + 1) % 3;
+                    double eu = pu[n] - pu[e];
+                    double ev = pv[n] - pv[e];
+                    double w = eu * (cv - pv[e]) - ev * (cu - pu[e]);
+                    inside = w > 0 || (w == 0 && ownsScanlineEdge(eu, ev));
+                }
+                if(!inside) continue;
+                double t = (tri.planeD - tri.normal[u] * cu - tri.normal[v] * cv) / tri.normal[axis];
+                crossings.columns[iu * sizeV + iv].push_back((float)t);
+            }
+        }
+    });
+    return crossings;
+}
+
+/**
+ * Fills the interior of the mesh with parity scanlines along all three axes. A column with
+ * an odd number of crossings comes from a hole or a non-manifold region and abstains; the
+ * remaining columns vote and a voxel is inside when the majority of its valid votes agree.
+ * Surface voxels of the given grid are always marked; pass a null grid to get the parity
+ * result for voxel centers only. The result uses the internal grid
+ * layout (x * sizeY * sizeZ + y * sizeZ + z), one byte per voxel.
+ */
+unsigned char* initSolidGrid(float* prims, int primCount, GridProperties props, Voxel* grid)
+{
+    int* gridSize = props.gridSize;
     int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
-    float* result = new float[(totalGridSize * 4) + 7];
-    result[0] = min.x;
-    result[1] = min.y;
-    result[2] = min.z;
-    memcpy(result + 3, gridSize, 3 * sizeof(int));
-    result[6] = voxelSize;
-    int offset = 7;
+    int strides[3] = {gridSize[1] * gridSize[2], gridSize[2], 1};
+    unsigned char* insideVotes = new unsigned char[totalGridSize]();
+    unsigned char* validVotes = new unsigned char[totalGridSize]();
+    for(int axis = 0; axis < 3; axis++)
+    {
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        ScanlineCrossings crossings = gatherScanlineCrossings(prims, primCount, props, axis);
+        // The columns of one u row cover voxels no other row touches.
+        parallelFor(0, gridSize[u], [&](int iu)
+        {
+            for(int iv = 0; iv < gridSize[v]; iv++)
+            {
+                std::vector<float>& column = crossings.columns[iu * gridSize[v] + iv];
+                if(column.size() % 2 != 0) continue;
+                std::sort(column.begin(), column.end());
+                int base = iu * strides[u] + iv * strides[v];
+                size_t passed = 0;
+                for(int ia = 0; ia < gridSize[axis]; ia++)
+                {
+                    float center = props.min[axis] + (ia + 0.5f) * props.voxelSize;
+                    while(passed < column.size() && column[passed] < center) passed++;
+                    int index = base + ia * strides[axis];
+                    validVotes[index]++;
+                    if(passed % 2 == 1) insideVotes[index]++;
+                }
+            }
+        });
+        delete[] crossings.columns;
+    }
+    unsigned char* solid = new unsigned char[totalGridSize];
+    parallelFor(0, totalGridSize, [&](int i)
+    {
+        bool inside = validVotes[i] > 0 && insideVotes[i] * 2 > validVotes[i];
+        solid[i] = (inside || (grid != nullptr && grid[i].childCount > 0)) ? 1 : 0;
+    }, 4096);
+    delete[] insideVotes;
+    delete[] validVotes;
+    return solid;
+}
+
+void packOccupancyBits(unsigned int* occupancy, unsigned char* solid, GridProperties props)
+{
+    int* gridSize = props.gridSize;
+    int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
+    memset(occupancy, 0, ((totalGridSize + 31) / 32) * sizeof(unsigned int));
     int xMultiplier = gridSize[1] * gridSize[2];
     int yMultiplier = gridSize[2];
     for(int z = 0; z < gridSize[2]; z++)
@@ -141,124 +429,3040 @@ float* constructVoxelGrid(float* prims, int primCount, int size)
         {
             for(int x = 0; x < gridSize[0]; x++)
             {
-                Voxel vx = grid[x * xMultiplier + y * yMultiplier + z];
-                int index = offset + (z * gridSize[0] * gridSize[1] + y * gridSize[0] + x) * 4;
-                int isFilled = vx.childCount > 0 ? 1 : 0;
-                Vec3 avgNormal = vx.childCount > 0 ? vx.normalSum / (float)vx.childCount : vx.normalSum;
-                result[index] = avgNormal.x;
-                result[index+1] = avgNormal.y;
-                result[index+2] = avgNormal.z;
-                memcpy(result + index + 3, &isFilled, sizeof(int));
+                if(!solid[x * xMultiplier + y * yMultiplier + z]) continue;
+                int index = z * gridSize[0] * gridSize[1] + y * gridSize[0] + x;
+                occupancy[index >> 5] |= 1u << (index & 31);
             }
         }
     }
-    delete[] grid;
-    return result;
 }
 
-struct NodeStackElement
+struct SDFSeeds
 {
-    SVO* node;
-    int parentIndex;
+    int* closestTriangle;
+    float* distance;
 };
 
-indexTriplet getSVOIndex(Vec3 point, Vec3 minPoint, float voxelSize)
+// Exact distances from voxel centers to every triangle within bandWidth voxels of it.
+// Triangles are bucketed per x slice so each slice can be processed by its own worker.
+SDFSeeds seedDistanceField(float* prims, int primCount, GridProperties props, int bandWidth)
 {
-    Vec3 offset = point - minPoint;
-    return {(int)std::floor(offset.x / voxelSize), (int)std::floor(offset.y / voxelSize), (int)std::floor(offset.z / voxelSize)};
+    int* gridSize = props.gridSize;
+    int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
+    float voxelSize = props.voxelSize;
+    SDFSeeds seeds;
+    seeds.closestTriangle = new int[totalGridSize];
+    seeds.distance = new float[totalGridSize];
+    std::fill(seeds.closestTriangle, seeds.closestTriangle + totalGridSize, -1);
+    std::fill(seeds.distance, seeds.distance + totalGridSize, INFINITY);
+    std::vector<Triangle> triangles(primCount);
+    std::vector<indexTriplet> minIndices(primCount), maxIndices(primCount);
+    std::vector<std::vector<int>> sliceTriangles(gridSize[0]);
+    for(int i = 0; i < primCount; i++)
+    {
+        Vec3 p1 = Vec3(prims[i * 9 + 0], prims[i * 9 + 1], prims[i * 9 + 2]);
+        Vec3 p2 = Vec3(prims[i * 9 + 3], prims[i * 9 + 4], prims[i * 9 + 5]);
+        Vec3 p3 = Vec3(prims[i * 9 + 6], prims[i * 9 + 7], prims[i * 9 + 8]);
+        triangles[i] = {p1, p2, p3};
+        indexTriplet i1 = getIndices(p1, props.min, voxelSize);
+        indexTriplet i2 = getIndices(p2, props.min, voxelSize);
+        indexTriplet i3 = getIndices(p3, props.min, voxelSize);
+        minIndices[i] = {
+            std::max(tripleMin(i1.x, i2.x, i3.x) - bandWidth, 0),
+            std::max(tripleMin(i1.y, i2.y, i3.y) - bandWidth, 0),
+            std::max(tripleMin(i1.z, i2.z, i3.z) - bandWidth, 0)};
+        maxIndices[i] = {
+            std::min(tripleMax(i1.x, i2.x, i3.x) + bandWidth, gridSize[0] - 1),
+            std::min(tripleMax(i1.y, i2.y, i3.y) + bandWidth, gridSize[1] - 1),
+            std::min(tripleMax(i1.z, i2.z, i3.z) + bandWidth, gridSize[2] - 1)};
+        for(int x = minIndices[i].x; x <= maxIndices[i].x; x++)
+        {
+            sliceTriangles[x].push_back(i);
+        }
+    }
+    int xMultiplier = gridSize[1] * gridSize[2];
+    int yMultiplier = gridSize[2];
+    parallelFor(0, gridSize[0], [&](int x)
+    {
+        for(int triIndex : sliceTriangles[x])
+        {
+            const Triangle& tri = triangles[triIndex];
+            for(int y = minIndices[triIndex].y; y <= maxIndices[triIndex].y; y++)
+            {
+                for(int z = minIndices[triIndex].z; z <= maxIndices[triIndex].z; z++)
+                {
+                    Vec3 vxCenter = props.min + Vec3((x + 0.5f) * voxelSize, (y + 0.5f) * voxelSize, (z + 0.5f) * voxelSize);
+                    float distance = (tri.closestPoint(vxCenter) - vxCenter).length();
+                    int index = x * xMultiplier + y * yMultiplier + z;
+                    if(distance < seeds.distance[index])
+                    {
+                        seeds.distance[index] = distance;
+                        seeds.closestTriangle[index] = triIndex;
+                    }
+                }
+            }
+        }
+    });
+    return seeds;
 }
 
-float* constructSVO(float* prims, int primCount, int depth)
+/**
+ * Propagates the closest surface points of the seeded voxels to the whole grid with fast
+ * sweeping: forward and backward along each axis, slab by slab, every voxel compares its
+ * point with the points of the 3x3 voxels next to it in the previous slab. A slab only reads
+ * the finished one before it, so its voxels are processed in parallel. Unsigned distances
+ * to the propagated points are written back into seeds.distance.
+ */
+void sweepDistanceField(float* prims, GridProperties props, SDFSeeds seeds)
 {
-    Vec3 min(prims[0], prims[1], prims[2]);
-    Vec3 max = min;
-    for(int i = 1; i < primCount * 3; i++)
+    int* gridSize = props.gridSize;
+    int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
+    float voxelSize = props.voxelSize;
+    int strides[3] = {gridSize[1] * gridSize[2], gridSize[2], 1};
+    auto voxelCenter = [&](int x, int y, int z)
     {
-        min.min(prims[i * 3 + 0], prims[i * 3 + 1], prims[i * 3 + 2]);
-        max.max(prims[i * 3 + 0], prims[i * 3 + 1], prims[i * 3 + 2]);
-    }
-    Vec3 extents = max - min;
-    float maxExtent = extents.maxComponent();
-    float svoSize = maxExtent;
-    for(int i = 0; i < depth; i++) svoSize /= 2.f;
-    min.sub(svoSize / 2);
-    max.add(svoSize / 2);
-    extents = max - min;
-    maxExtent = extents.maxComponent();
-    svoSize = maxExtent;
-    for(int i = 0; i < depth; i++) svoSize /= 2.f;
-    int size = std::round(maxExtent / svoSize);
-    max = min;
-    max.add(maxExtent);
-    Voxel* voxels = initGrid(prims, primCount, {min, new int[3]{size, size, size}, svoSize});
-    SVO root = SVO(min, max, depth);
-    int nodeCount = 1;
-    for(int x = 0; x < size; x++)
+        return props.min + Vec3((x + 0.5f) * voxelSize, (y + 0.5f) * voxelSize, (z + 0.5f) * voxelSize);
+    };
+
+    // Seed points are numbered x slice by x slice: the slices are counted first, so each one
+    // can then compute its closest points in parallel into its own part of seedPoints.
+    int* current = new int[totalGridSize];
+    float* squaredDistances = new float[totalGridSize];
+    std::vector<int> sliceSeedOffsets(gridSize[0] + 1, 0);
+    parallelFor(0, gridSize[0], [&](int x)
+    {
+        int count = 0;
+        for(int i = x * strides[0]; i < (x + 1) * strides[0]; i++)
+        {
+            if(seeds.closestTriangle[i] >= 0) count++;
+        }
+        sliceSeedOffsets[x + 1] = count;
+    });
+    for(int x = 0; x < gridSize[0]; x++) sliceSeedOffsets[x + 1] += sliceSeedOffsets[x];
+    std::vector<Vec3> seedPoints(sliceSeedOffsets[gridSize[0]]);
+    parallelFor(0, gridSize[0], [&](int x)
     {
-        for(int y = 0; y < size; y++)
+        int seedIndex = sliceSeedOffsets[x];
+        for(int y = 0; y < gridSize[1]; y++)
         {
-            for(int z = 0; z < size; z++)
+            for(int z = 0; z < gridSize[2]; z++)
             {
-                Voxel& vx = voxels[x * size * size + y * size + z];
-                if(vx.childCount == 0) continue;
-                Vec3 averageNormal = vx.normalSum / (float)vx.childCount;
-                Vec3 center = min + Vec3((x + 0.5f) * svoSize, (y + 0.5f) * svoSize, (z + 0.5f) * svoSize);
-                root.insertVoxel(center, averageNormal, &nodeCount);
+                int index = x * strides[0] + y * strides[1] + z;
+                current[index] = -1;
+                squaredDistances[index] = INFINITY;
+                int triIndex = seeds.closestTriangle[index];
+                if(triIndex < 0) continue;
+                float* p = prims + triIndex * 9;
+                Triangle tri = {Vec3(p[0], p[1], p[2]), Vec3(p[3], p[4], p[5]), Vec3(p[6], p[7], p[8])};
+                Vec3 center = voxelCenter(x, y, z);
+                Vec3 closest = tri.closestPoint(center);
+                current[index] = seedIndex;
+                squaredDistances[index] = (closest - center).dot(closest - center);
+                seedPoints[seedIndex++] = closest;
             }
         }
-    }
-    delete[] voxels;
-    int offset = 8;
-    int resultSize = nodeCount * 4 + offset;
-    float* result = new float[resultSize];
-    result[0] = min.x;
-    result[1] = min.y;
-    result[2] = min.z;
-    result[3] = max.x;
-    result[4] = max.y;
-    result[5] = max.z;
-    memcpy(result + 6, &size, sizeof(int));
-    int currentNodeIndex = 0;
-    std::queue<NodeStackElement> nodeStack;
-    nodeStack.push({&root, -1});
-    while(!nodeStack.empty())
+    });
+
+    for(int axis = 0; axis < 3; axis++)
     {
-        NodeStackElement stackElem = nodeStack.front();
-        nodeStack.pop();
-        int parentIndex = stackElem.parentIndex;
-        SVO* node = stackElem.node;
-        int childMask = 0;
-        for(int i = 0; i < 8; i++)
+        // v is the in-slab axis with the smallest stride so the inner loop stays cache friendly.
+        int u = axis == 0 ? 1 : 0;
+        int v = axis == 2 ? 1 : 2;
+        for(int dir = 1; dir >= -1; dir -= 2)
         {
-            if(node->children[i] != nullptr)
+            int first = dir == 1 ? 1 : gridSize[axis] - 2;
+            for(int slab = first; slab >= 0 && slab < gridSize[axis]; slab += dir)
             {
-                childMask |= 1 << i;
-                nodeStack.push({node->children[i], currentNodeIndex});
+                int previous = slab - dir;
+                parallelFor(0, gridSize[u], [&](int iu)
+                {
+                    int coords[3];
+                    coords[axis] = slab;
+                    coords[u] = iu;
+                    for(int iv = 0; iv < gridSize[v]; iv++)
+                    {
+                        coords[v] = iv;
+                        int index = coords[0] * strides[0] + coords[1] * strides[1] + coords[2];
+                        Vec3 center = voxelCenter(coords[0], coords[1], coords[2]);
+                        int best = current[index];
+                        float bestDistance = squaredDistances[index];
+                        for(int nu = std::max(iu - 1, 0); nu <= std::min(iu + 1, gridSize[u] - 1); nu++)
+                        {
+                            for(int nv = std::max(iv - 1, 0); nv <= std::min(iv + 1, gridSize[v] - 1); nv++)
+                            {
+                                int candidate = current[previous * strides[axis] + nu * strides[u] + nv * strides[v]];
+                                if(candidate < 0 || candidate == best) continue;
+                                Vec3 d = seedPoints[candidate] - center;
+                                float distance = d.dot(d);
+                                if(distance < bestDistance)
+                                {
+                                    bestDistance = distance;
+                                    best = candidate;
+                                }
+                            }
+                        }
+                        current[index] = best;
+                        squaredDistances[index] = bestDistance;
+                    }
+                });
             }
         }
-        int isLeaf = node->isLeaf ? (1 << 8) : 0;
-        Vec3 averageNormal = node->normal;
-        if(parentIndex != -1)
+    }
+
+    parallelFor(0, totalGridSize, [&](int i)
+    {
+        seeds.distance[i] = std::sqrt(squaredDistances[i]);
+    }, 4096);
+    delete[] current;
+    delete[] squaredDistances;
+}
+
+enum ContouringMethod
+{
+    AverageNormals = 0,
+    DualContouring = 1
+};
+
+// Triangle indices overlapping each voxel, in the internal grid layout: the triangles of
+// voxel i are triangles[offsets[i]] ... triangles[offsets[i + 1] - 1].
+struct VoxelTriangleLists
+{
+    int* offsets;
+    int* triangles;
+};
+
+VoxelTriangleLists buildVoxelTriangleLists(float* prims, int primCount, GridProperties props)
+{
+    int totalGridSize = props.gridSize[0] * props.gridSize[1] * props.gridSize[2];
+    int xMultiplier = props.gridSize[1] * props.gridSize[2];
+    int yMultiplier = props.gridSize[2];
+    std::vector<std::pair<int, int>> pairs;
+    for(int i = 0; i < primCount; i++)
+    {
+        forEachOverlappedVoxel(props, prims + i * 9, fullVoxelRange(props), [&](int x, int y, int z)
+        {
+            pairs.push_back({x * xMultiplier + y * yMultiplier + z, i});
+        });
+    }
+    VoxelTriangleLists lists;
+    lists.offsets = new int[totalGridSize + 1]();
+    lists.triangles = new int[pairs.size()];
+    for(const std::pair<int, int>& pair : pairs) lists.offsets[pair.first + 1]++;
+    for(int i = 0; i < totalGridSize; i++) lists.offsets[i + 1] += lists.offsets[i];
+    std::vector<int> cursor(lists.offsets, lists.offsets + totalGridSize);
+    for(const std::pair<int, int>& pair : pairs) lists.triangles[cursor[pair.first]++] = pair.second;
+    return lists;
+}
+
+// Corner offsets of the 12 cell edges, matching edgeOffsets in gridVoxelization.js.
+const int DC_EDGE_OFFSETS[12][2][3] = {
+    {{0,0,0},{0,0,1}},
+    {{0,1,0},{0,1,1}},
+    {{1,0,0},{1,0,1}},
+    {{1,1,0},{1,1,1}},
+    {{0,0,0},{1,0,0}},
+    {{0,1,0},{1,1,0}},
+    {{0,0,1},{1,0,1}},
+    {{0,1,1},{1,1,1}},
+    {{0,0,0},{0,1,0}},
+    {{1,0,0},{1,1,0}},
+    {{0,0,1},{0,1,1}},
+    {{1,0,1},{1,1,1}}};
+
+struct DualContouringVoxel
+{
+    Vec3 vertex;
+    int edgeMask;
+};
+
+/**
+ * Gathers the Hermite data (edge-triangle intersections and normals) of voxel (x, y, z)
+ * from its overlapping triangles and places its dual contouring vertex with a
+ * bias-regularized QEF constrained to the voxel. Bit e of edgeMask is set when edge e
+ * crosses the surface and bit e + 12 when it crosses it from the back side, as in
+ * gridVoxelization.js. A voxel without intersections keeps its center.
+ */
+DualContouringVoxel solveDualContouringVoxel(const float* prims, GridProperties props, int x, int y, int z, const int* triangles, int triangleCount)
+{
+    float voxelSize = props.voxelSize;
+    Vec3 vxMin = props.min + Vec3(x * voxelSize, y * voxelSize, z * voxelSize);
+    Vec3 vxCenter = vxMin + Vec3(voxelSize / 2.f, voxelSize / 2.f, voxelSize / 2.f);
+    QEF qef;
+    int edgeMask = 0;
+    for(int t = 0; t < triangleCount; t++)
+    {
+        const float* p = prims + triangles[t] * 9;
+        Vec3 p1(p[0], p[1], p[2]);
+        Vec3 p2(p[3], p[4], p[5]);
+        Vec3 p3(p[6], p[7], p[8]);
+        Vec3 edge1 = p2 - p1;
+        Vec3 edge2 = p3 - p1;
+        Vec3 triNormal = edge1.cross(edge2).normalized();
+        for(int e = 0; e < 12; e++)
+        {
+            const int* o1 = DC_EDGE_OFFSETS[e][0];
+            const int* o2 = DC_EDGE_OFFSETS[e][1];
+            Vec3 ep1 = vxMin + Vec3(o1[0] * voxelSize, o1[1] * voxelSize, o1[2] * voxelSize);
+            Vec3 dir((float)(o2[0] - o1[0]), (float)(o2[1] - o1[1]), (float)(o2[2] - o1[2]));
+            Vec3 pvec = dir.cross(edge2);
+            float det = edge1.dot(pvec);
+            if(det == 0) continue;
+            float invDet = 1.f / det;
+            Vec3 tvec = ep1 - p1;
+            float u = tvec.dot(pvec) * invDet;
+            if(u < 0 || u > 1) continue;
+            Vec3 qvec = tvec.cross(edge1);
+            float v = dir.dot(qvec) * invDet;
+            if(v < 0 || u + v > 1) continue;
+            float distance = edge2.dot(qvec) * invDet;
+            if(distance < 0 || distance > voxelSize) continue;
+            bool flip = dir.dot(triNormal) > 0;
+            edgeMask |= (1 << e) | (flip ? (1 << (e + 12)) : 0);
+            Vec3 intersection = ep1 + dir * distance;
+            qef.addIntersection(intersection - vxCenter, triNormal * -1.f);
+        }
+    }
+    DualContouringVoxel result;
+    result.edgeMask = edgeMask;
+    result.vertex = vxCenter;
+    if(qef.pointCount == 0) return result;
+    qef.addMassPointBias(1.f);
+    result.vertex = vxCenter + qef.solveInCube(voxelSize / 2.f);
+    return result;
+}
+
+// Dual contouring vertices of the whole grid, processed in parallel one x slice per task.
+DualContouringVoxel* computeDualContouring(float* prims, int primCount, GridProperties props)
+{
+    int* gridSize = props.gridSize;
+    int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
+    VoxelTriangleLists lists = buildVoxelTriangleLists(prims, primCount, props);
+    DualContouringVoxel* result = new DualContouringVoxel[totalGridSize];
+    int xMultiplier = gridSize[1] * gridSize[2];
+    int yMultiplier = gridSize[2];
+    parallelFor(0, gridSize[0], [&](int x)
+    {
+        for(int y = 0; y < gridSize[1]; y++)
         {
-            int childOffset = currentNodeIndex - parentIndex;
-            int shiftedIndex = (childOffset << 9);
-            int* parent = (int*)(result + parentIndex * 4 + offset);
-            int parentValue = *parent;
-            int parentChildOffset = parentValue >> 9;
-            if(parentChildOffset == 0)
+            for(int z = 0; z < gridSize[2]; z++)
             {
-                parentValue |= shiftedIndex;
-                (*parent) = parentValue;
+                int index = x * xMultiplier + y * yMultiplier + z;
+                int first = lists.offsets[index];
+                result[index] = solveDualContouringVoxel(prims, props, x, y, z, lists.triangles + first, lists.offsets[index + 1] - first);
             }
         }
-        int packedBits = (childMask) | isLeaf;
-        memcpy(result + currentNodeIndex * 4 + offset, &packedBits, sizeof(int));
-        result[currentNodeIndex * 4 + 1 + offset] = averageNormal.x;
-        result[currentNodeIndex * 4 + 2 + offset] = averageNormal.y;
-        result[currentNodeIndex * 4 + 3 + offset] = averageNormal.z;
-        currentNodeIndex++;
+    });
+    delete[] lists.offsets;
+    delete[] lists.triangles;
+    return result;
+}
+
+/**
+ * Collects the (Morton code, triangle) pairs of the listed triangles' overlaps with the
+ * voxels inside window, sorted by code and then triangle.
+ */
+std::vector<std::pair<uint64_t, int>> collectSVOOverlaps(float* prims, const int* triangles, int triangleCount, GridProperties props, VoxelRange window)
+{
+    std::vector<std::pair<uint64_t, int>> overlaps;
+    for(int t = 0; t < triangleCount; t++)
+    {
+        int i = triangles[t];
+        forEachOverlappedVoxel(props, prims + i * 9, window, [&](int x, int y, int z)
+        {
+            overlaps.push_back({encodeMorton(x, y, z), i});
+        });
+    }
+    std::sort(overlaps.begin(), overlaps.end());
+    return overlaps;
+}
+
+// The average triangle normal, or the dual contouring vertex, of the overlaps [first, last) of one voxel.
+Vec3 computeSVOLeafAttribute(float* prims, GridProperties props, const std::vector<std::pair<uint64_t, int>>& overlaps, int first, int last, int contouringMethod)
+{
+    if(contouringMethod == DualContouring)
+    {
+        std::vector<int> triangles;
+        for(int i = first; i < last; i++) triangles.push_back(overlaps[i].second);
+        uint32_t x, y, z;
+        decodeMorton(overlaps[first].first, &x, &y, &z);
+        return solveDualContouringVoxel(prims, props, x, y, z, triangles.data(), (int)triangles.size()).vertex;
     }
-    memcpy(result + 7, &currentNodeIndex, sizeof(int));
+    Vec3 normalSum(0, 0, 0);
+    for(int i = first; i < last; i++)
+    {
+        const float* tri = prims + overlaps[i].second * 9;
+        Vec3 p1(tri[0], tri[1], tri[2]);
+        Vec3 p2(tri[3], tri[4], tri[5]);
+        Vec3 p3(tri[6], tri[7], tri[8]);
+        normalSum.add((p3 - p1).cross(p2 - p1).normalized());
+    }
+    return normalSum / (float)(last - first);
+}
+
+// Turns sorted overlaps into leaves, one per run of equal codes.
+SVOLevel buildSVOLeaves(float* prims, GridProperties props, const std::vector<std::pair<uint64_t, int>>& overlaps, int contouringMethod)
+{
+    SVOLevel leaves;
+    int first = 0;
+    while(first < (int)overlaps.size())
+    {
+        int last = first + 1;
+        while(last < (int)overlaps.size() && overlaps[last].first == overlaps[first].first) last++;
+        leaves.codes.push_back(overlaps[first].first);
+        leaves.normals.push_back(computeSVOLeafAttribute(prims, props, overlaps, first, last, contouringMethod));
+        first = last;
+    }
+    return leaves;
+}
+
+/**
+ * Voxelizes the triangles straight into the Morton-sorted leaf level of an octree without
+ * a dense grid: every (voxel code, triangle) overlap is collected and sorted, and each run
+ * of equal codes becomes one leaf holding the average triangle normal, or the dual
+ * contouring vertex. Memory grows with the number of overlaps instead of size^3.
+ */
+SVOLevel gatherSVOLeaves(float* prims, int primCount, GridProperties props, int contouringMethod)
+{
+    std::vector<int> triangles(primCount);
+    for(int i = 0; i < primCount; i++) triangles[i] = i;
+    return buildSVOLeaves(prims, props, collectSVOOverlaps(prims, triangles.data(), primCount, props, fullVoxelRange(props)), contouringMethod);
+}
+
+/**
+ * Buckets the triangles by the cells of level cellLevel of an octree of the given depth
+ * that their voxel bounds touch. The buckets are indexed by the cells' Morton codes.
+ */
+std::vector<std::vector<int>> binSVOTriangles(float* prims, int primCount, GridProperties props, int depth, int cellLevel)
+{
+    std::vector<std::vector<int>> cellTriangles((size_t)1 << (3 * cellLevel));
+    int cellSize = 1 << (depth - cellLevel);
+    int maxIndex = props.gridSize[0] - 1;
+    for(int i = 0; i < primCount; i++)
+    {
+        const float* tri = prims + i * 9;
+        indexTriplet p1 = getIndices(Vec3(tri[0], tri[1], tri[2]), props.min, props.voxelSize);
+        indexTriplet p2 = getIndices(Vec3(tri[3], tri[4], tri[5]), props.min, props.voxelSize);
+        indexTriplet p3 = getIndices(Vec3(tri[6], tri[7], tri[8]), props.min, props.voxelSize);
+        int minIndex[3] = {tripleMin(p1.x, p2.x, p3.x), tripleMin(p1.y, p2.y, p3.y), tripleMin(p1.z, p2.z, p3.z)};
+        int maxIndices[3] = {tripleMax(p1.x, p2.x, p3.x), tripleMax(p1.y, p2.y, p3.y), tripleMax(p1.z, p2.z, p3.z)};
+        int first[3], last[3];
+        for(int a = 0; a < 3; a++)
+        {
+            first[a] = std::max(0, std::min(maxIndex, minIndex[a])) / cellSize;
+            last[a] = std::max(0, std::min(maxIndex, maxIndices[a])) / cellSize;
+        }
+        for(int x = first[0]; x <= last[0]; x++)
+        {
+            for(int y = first[1]; y <= last[1]; y++)
+            {
+                for(int z = first[2]; z <= last[2]; z++) cellTriangles[encodeMorton(x, y, z)].push_back(i);
+            }
+        }
+    }
+    return cellTriangles;
+}
+
+/**
+ * The triangles overlapping each leaf of a level: those of leaf i are
+ * triangles[starts[i]] ... triangles[starts[i + 1] - 1], in increasing order.
+ */
+struct SVOTriangleLists
+{
+    std::vector<uint32_t> starts;
+    std::vector<int> triangles;
+};
+
+/**
+ * Voxelizes the triangles inside one cell and assembles the subtree of subtreeDepth levels
+ * below it. Codes stay global, so levels[0] holds the cell itself, or nothing when no
+ * voxel of the cell is touched. The triangle lists of the leaves go to leafTriangles when
+ * it is not null.
+ */
+std::vector<SVOLevel> buildSVOSubtree(float* prims, const std::vector<int>& triangles, GridProperties props, uint64_t cell, int subtreeDepth, int contouringMethod, SVOTriangleLists* leafTriangles = nullptr)
+{
+    int subtreeSize = 1 << subtreeDepth;
+    uint32_t cx, cy, cz;
+    decodeMorton(cell, &cx, &cy, &cz);
+    VoxelRange window;
+    window.min[0] = cx * subtreeSize;
+    window.min[1] = cy * subtreeSize;
+    window.min[2] = cz * subtreeSize;
+    for(int a = 0; a < 3; a++) window.max[a] = window.min[a] + subtreeSize - 1;
+    std::vector<std::pair<uint64_t, int>> overlaps = collectSVOOverlaps(prims, triangles.data(), (int)triangles.size(), props, window);
+    if(leafTriangles != nullptr)
+    {
+        leafTriangles->triangles.resize(overlaps.size());
+        for(size_t i = 0; i < overlaps.size(); i++)
+        {
+            if(i == 0 || overlaps[i].first != overlaps[i - 1].first) leafTriangles->starts.push_back((uint32_t)i);
+            leafTriangles->triangles[i] = overlaps[i].second;
+        }
+        leafTriangles->starts.push_back((uint32_t)overlaps.size());
+    }
+    return buildSVOLevels(buildSVOLeaves(prims, props, overlaps, contouringMethod), subtreeDepth);
+}
+
+#define SVO_PARALLEL_SPLIT_LEVELS 2
+
+/**
+ * Builds the octree levels with the subtrees below the first SVO_PARALLEL_SPLIT_LEVELS
+ * levels as independent tasks. Each task voxelizes the triangles whose bounds touch its
+ * cube and assembles its subtree bottom-up. A subtree covers a contiguous range of Morton
+ * codes, so every global level is the subtrees' levels concatenated in subtree order:
+ * prefix sums over the subtree node counts give each subtree its place in the level and
+ * the shift for its first child indices, and the copies run in parallel. The few levels
+ * above the split are built from the stitched level as usual. The result matches
+ * buildSVOLevels(gatherSVOLeaves(...)). When leafTriangles is not null it receives the
+ * triangle lists of the leaves of levels[depth], stitched the same way.
+ */
+std::vector<SVOLevel> buildSVOLevelsParallel(float* prims, int primCount, GridProperties props, int depth, int contouringMethod, SVOTriangleLists* leafTriangles = nullptr)
+{
+    int splitLevels = std::min(SVO_PARALLEL_SPLIT_LEVELS, depth);
+    int subtreeCount = 1 << (3 * splitLevels);
+    int subtreeDepth = depth - splitLevels;
+
+    std::vector<std::vector<int>> subtreeTriangles = binSVOTriangles(prims, primCount, props, depth, splitLevels);
+    std::vector<std::vector<SVOLevel>> subtrees(subtreeCount);
+    std::vector<SVOTriangleLists> subtreeLists(leafTriangles != nullptr ? subtreeCount : 0);
+    parallelFor(0, subtreeCount, [&](int s)
+    {
+        if(subtreeTriangles[s].empty()) return;
+        subtrees[s] = buildSVOSubtree(prims, subtreeTriangles[s], props, s, subtreeDepth, contouringMethod, leafTriangles != nullptr ? &subtreeLists[s] : nullptr);
+    });
+    if(leafTriangles != nullptr)
+    {
+        std::vector<size_t> leafStarts(subtreeCount + 1, 0);
+        std::vector<size_t> triangleStarts(subtreeCount + 1, 0);
+        for(int s = 0; s < subtreeCount; s++)
+        {
+            size_t leafCount = subtreeLists[s].starts.empty() ? 0 : subtreeLists[s].starts.size() - 1;
+            leafStarts[s + 1] = leafStarts[s] + leafCount;
+            triangleStarts[s + 1] = triangleStarts[s] + subtreeLists[s].triangles.size();
+        }
+        leafTriangles->starts.resize(leafStarts[subtreeCount] + 1);
+        leafTriangles->triangles.resize(triangleStarts[subtreeCount]);
+        leafTriangles->starts[leafStarts[subtreeCount]] = (uint32_t)triangleStarts[subtreeCount];
+        parallelFor(0, subtreeCount, [&](int s)
+        {
+            const SVOTriangleLists& in = subtreeLists[s];
+            std::copy(in.triangles.begin(), in.triangles.end(), leafTriangles->triangles.begin() + triangleStarts[s]);
+            for(size_t i = 0; i + 1 < in.starts.size(); i++) leafTriangles->starts[leafStarts[s] + i] = (uint32_t)(in.starts[i] + triangleStarts[s]);
+        });
+    }
+
+    std::vector<SVOLevel> levels(depth + 1);
+    for(int level = 0; level <= subtreeDepth; level++)
+    {
+        std::vector<uint32_t> starts(subtreeCount + 1, 0);
+        for(int s = 0; s < subtreeCount; s++)
+        {
+            starts[s + 1] = starts[s] + (subtrees[s].empty() ? 0 : subtrees[s][level].size());
+        }
+        std::vector<uint32_t> childStarts(subtreeCount, 0);
+        for(int s = 0; s + 1 < subtreeCount && level < subtreeDepth; s++)
+        {
+            childStarts[s + 1] = childStarts[s] + (subtrees[s].empty() ? 0 : subtrees[s][level + 1].size());
+        }
+        SVOLevel& out = levels[splitLevels + level];
+        out.codes.resize(starts[subtreeCount]);
+        out.childMasks.resize(starts[subtreeCount]);
+        out.firstChild.resize(starts[subtreeCount]);
+        out.normals.resize(starts[subtreeCount]);
+        parallelFor(0, subtreeCount, [&](int s)
+        {
+            if(subtrees[s].empty()) return;
+            const SVOLevel& in = subtrees[s][level];
+            std::copy(in.codes.begin(), in.codes.end(), out.codes.begin() + starts[s]);
+            std::copy(in.childMasks.begin(), in.childMasks.end(), out.childMasks.begin() + starts[s]);
+            std::copy(in.normals.begin(), in.normals.end(), out.normals.begin() + starts[s]);
+            for(int i = 0; i < in.size(); i++) out.firstChild[starts[s] + i] = in.firstChild[i] + childStarts[s];
+        });
+    }
+    for(int d = splitLevels - 1; d >= 0; d--)
+    {
+        levels[d] = buildParentLevel(levels[d + 1]);
+    }
+    return levels;
+}
+
+/**
+ * Order of the entries of an encoded octree. Every layout keeps sibling groups contiguous
+ * and places a group after its parent, so child offsets stay positive.
+ */
+enum SVONodeLayout
+{
+    // Level by level; siblings are close but a subtree is spread over the whole array.
+    BreadthFirstLayout = 0,
+    // Breadth-first down to topLevels, then blocks of up to blockSize entries, each a
+    // breadth-first piece of a subtree, with the blocks hanging below a block following it.
+    SubtreeBlockLayout = 1,
+    // Van Emde Boas order: the top half of every subtree by height, then its bottom subtrees.
+    VanEmdeBoasLayout = 2
+};
+
+struct SVOLayoutOptions
+{
+    int layout;
+    int topLevels;
+    int blockSize;
+};
+
+const SVOLayoutOptions SVO_BREADTH_FIRST_LAYOUT = {BreadthFirstLayout, 0, 0};
+
+// The children of a node: count consecutive nodes of level, starting at first.
+struct SVOGroup
+{
+    int level;
+    int first;
+    int count;
+};
+
+template <typename F>
+void forEachSVOChildGroup(const std::vector<SVOLevel>& levels, SVOGroup group, F fn)
+{
+    const SVOLevel& level = levels[group.level];
+    for(int i = group.first; i < group.first + group.count; i++)
+    {
+        if(level.childMasks[i] != 0) fn(SVOGroup{group.level + 1, (int)level.firstChild[i], __builtin_popcount(level.childMasks[i])});
+    }
+}
+
+// Appends the block starting at root, then the blocks below it depth-first.
+void appendSVOBlock(const std::vector<SVOLevel>& levels, SVOGroup root, int blockSize, std::vector<SVOGroup>& order)
+{
+    std::vector<SVOGroup> queue = {root};
+    size_t next = 0;
+    int entries = 0;
+    while(next < queue.size() && (entries == 0 || entries + queue[next].count <= blockSize))
+    {
+        SVOGroup group = queue[next++];
+        order.push_back(group);
+        entries += group.count;
+        forEachSVOChildGroup(levels, group, [&](SVOGroup child) { queue.push_back(child); });
+    }
+    for(size_t i = next; i < queue.size(); i++) appendSVOBlock(levels, queue[i], blockSize, order);
+}
+
+// Appends the groups of the subtree of the given height below root in van Emde Boas order.
+void appendSVOVanEmdeBoas(const std::vector<SVOLevel>& levels, SVOGroup root, int height, std::vector<SVOGroup>& order)
+{
+    if(height == 1)
+    {
+        order.push_back(root);
+        return;
+    }
+    int topHeight = height / 2;
+    appendSVOVanEmdeBoas(levels, root, topHeight, order);
+    std::vector<SVOGroup> frontier = {root};
+    for(int l = 0; l < topHeight; l++)
+    {
+        std::vector<SVOGroup> below;
+        for(SVOGroup group : frontier)
+        {
+            forEachSVOChildGroup(levels, group, [&](SVOGroup child) { below.push_back(child); });
+        }
+        frontier.swap(below);
+    }
+    for(SVOGroup group : frontier) appendSVOVanEmdeBoas(levels, group, height - topHeight, order);
+}
+
+std::vector<SVOGroup> collectSVOGroupOrder(const std::vector<SVOLevel>& levels, SVOLayoutOptions options)
+{
+    std::vector<SVOGroup> order;
+    SVOGroup root = {0, 0, 1};
+    if(options.layout == VanEmdeBoasLayout)
+    {
+        appendSVOVanEmdeBoas(levels, root, (int)levels.size(), order);
+        return order;
+    }
+    std::vector<SVOGroup> queue = {root};
+    for(size_t next = 0; next < queue.size(); next++)
+    {
+        SVOGroup group = queue[next];
+        if(group.level > options.topLevels)
+        {
+            appendSVOBlock(levels, group, std::max(1, options.blockSize), order);
+            continue;
+        }
+        order.push_back(group);
+        forEachSVOChildGroup(levels, group, [&](SVOGroup child) { queue.push_back(child); });
+    }
+    return order;
+}
+
+/**
+ * Entry positions of an encoded octree in the order of options. A node whose first child
+ * is more than SVO_MAX_CHILD_OFFSET entries away gets a far pointer slot right after its
+ * sibling group. Slots only push later entries further away, so far nodes are added until
+ * no near offset overflows.
+ */
+struct SVOLayout
+{
+    std::vector<std::vector<int64_t>> positions;
+    std::vector<std::vector<int64_t>> slots;
+    int64_t entryCount;
+};
+
+SVOLayout computeSVOLayout(const std::vector<SVOLevel>& levels, SVOLayoutOptions options = SVO_BREADTH_FIRST_LAYOUT)
+{
+    SVOLayout layout;
+    layout.positions.resize(levels.size());
+    layout.slots.resize(levels.size());
+    std::vector<std::vector<uint8_t>> far(levels.size());
+    std::vector<int> farCounts(levels.size(), 0);
+    for(size_t d = 0; d < levels.size(); d++) far[d].assign(levels[d].size(), 0);
+    std::vector<SVOGroup> order;
+    if(options.layout != BreadthFirstLayout && levels[0].size() > 0) order = collectSVOGroupOrder(levels, options);
+    while(true)
+    {
+        int64_t position = 0;
+        for(size_t d = 0; d < levels.size(); d++)
+        {
+            layout.positions[d].resize(levels[d].size());
+            layout.slots[d].assign(levels[d].size(), -1);
+        }
+        if(order.empty())
+        {
+            for(size_t d = 0; d < levels.size(); d++)
+            {
+                const SVOLevel& level = levels[d];
+                if(farCounts[d] == 0)
+                {
+                    int64_t start = position;
+                    parallelFor(0, level.size(), [&](int i)
+                    {
+                        layout.positions[d][i] = start + i;
+                    }, 4096);
+                    position += level.size();
+                    continue;
+                }
+                int groupStart = 0;
+                while(groupStart < level.size())
+                {
+                    int groupEnd = groupStart + 1;
+                    while(d > 0 && groupEnd < level.size() && level.codes[groupEnd] >> 3 == level.codes[groupStart] >> 3) groupEnd++;
+                    if(d == 0) groupEnd = level.size();
+                    for(int i = groupStart; i < groupEnd; i++) layout.positions[d][i] = position++;
+                    for(int i = groupStart; i < groupEnd; i++)
+                    {
+                        if(far[d][i]) layout.slots[d][i] = position++;
+                    }
+                    groupStart = groupEnd;
+                }
+            }
+        }
+        else
+        {
+            for(const SVOGroup& group : order)
+            {
+                int end = group.first + group.count;
+                for(int i = group.first; i < end; i++) layout.positions[group.level][i] = position++;
+                for(int i = group.first; i < end; i++)
+                {
+                    if(far[group.level][i]) layout.slots[group.level][i] = position++;
+                }
+            }
+        }
+        layout.entryCount = position;
+        bool changed = false;
+        for(size_t d = 0; d + 1 < levels.size(); d++)
+        {
+            const SVOLevel& level = levels[d];
+            std::atomic<int> newFarCount(0);
+            parallelFor(0, level.size(), [&](int i)
+            {
+                if(level.childMasks[i] == 0 || far[d][i]) return;
+                int64_t childOffset = layout.positions[d + 1][level.firstChild[i]] - layout.positions[d][i];
+                if(childOffset <= SVO_MAX_CHILD_OFFSET) return;
+                far[d][i] = 1;
+                newFarCount++;
+            }, 4096);
+            farCounts[d] += newFarCount;
+            changed = changed || newFarCount > 0;
+        }
+        if(!changed) return layout;
+    }
+}
+
+/**
+ * Packed topology word of node i of level d. A far node's slot receives the absolute index
+ * of its first child through farIndex; it is left untouched for near nodes and leaves.
+ */
+uint32_t packSVONodeWord(const std::vector<SVOLevel>& levels, const SVOLayout& layout, size_t d, int i, uint32_t* farIndex)
+{
+    const SVOLevel& level = levels[d];
+    int childMask = level.childMasks[i];
+    if(childMask == 0) return SVO_LEAF_BIT;
+    int64_t nodeIndex = layout.positions[d][i];
+    int64_t firstChild = layout.positions[d + 1][level.firstChild[i]];
+    int64_t slot = layout.slots[d][i];
+    uint32_t childOffset = (uint32_t)((slot >= 0 ? slot : firstChild) - nodeIndex);
+    if(slot >= 0) *farIndex = (uint32_t)firstChild;
+    return childMask | (slot >= 0 ? SVO_FAR_BIT : 0) | (childOffset << SVO_CHILD_OFFSET_SHIFT);
+}
+
+/**
+ * Writes the octree levels at the positions of layout in the ESVO layout read by
+ * svoUtils.js: the bounds, size and entry count, then four floats per entry. A node entry
+ * holds the packed (childMask | isLeaf << 8 | childOffset << 9 | isFar << 31) bits followed
+ * by the normal, where childOffset is the distance to the node's first child. For far nodes
+ * it is instead the distance to a slot entry whose first word is the absolute index of the
+ * first child. Returns nullptr with a message on stderr when the tree does not fit the
+ * encoding.
+ */
+float* encodeSVOWithLayout(const std::vector<SVOLevel>& levels, const SVOLayout& layout, Vec3 min, Vec3 max, int size)
+{
+    int offset = 8;
+    if(layout.entryCount > INT32_MAX || (uint64_t)layout.entryCount * 4 + offset > SIZE_MAX / sizeof(float))
+    {
+        fprintf(stderr, "encodeSVO: %lld entries exceed the addressable size of the SVO encoding\n", (long long)layout.entryCount);
+        return nullptr;
+    }
+    int entryCount = (int)layout.entryCount;
+    float* result = new (std::nothrow) float[(size_t)entryCount * 4 + offset]();
+    if(result == nullptr)
+    {
+        fprintf(stderr, "encodeSVO: out of memory for %d entries\n", entryCount);
+        return nullptr;
+    }
+    result[0] = min.x;
+    result[1] = min.y;
+    result[2] = min.z;
+    result[3] = max.x;
+    result[4] = max.y;
+    result[5] = max.z;
+    memcpy(result + 6, &size, sizeof(int));
+    memcpy(result + 7, &entryCount, sizeof(int));
+    for(size_t d = 0; d < levels.size(); d++)
+    {
+        const SVOLevel& level = levels[d];
+        parallelFor(0, level.size(), [&](int i)
+        {
+            int64_t nodeIndex = layout.positions[d][i];
+            uint32_t absoluteIndex;
+            uint32_t packedBits = packSVONodeWord(levels, layout, d, i, &absoluteIndex);
+            if(packedBits & SVO_FAR_BIT)
+            {
+                memcpy(result + layout.slots[d][i] * 4 + offset, &absoluteIndex, sizeof(uint32_t));
+            }
+            float* node = result + nodeIndex * 4 + offset;
+            memcpy(node, &packedBits, sizeof(uint32_t));
+            node[1] = level.normals[i].x;
+            node[2] = level.normals[i].y;
+            node[3] = level.normals[i].z;
+        }, 4096);
+    }
+    return result;
+}
+
+// encodeSVOWithLayout with the entries in the order of layoutOptions.
+float* encodeSVO(const std::vector<SVOLevel>& levels, Vec3 min, Vec3 max, int size, SVOLayoutOptions layoutOptions = SVO_BREADTH_FIRST_LAYOUT)
+{
+    return encodeSVOWithLayout(levels, computeSVOLayout(levels, layoutOptions), min, max, size);
+}
+
+// Rope target while deriving ropes: a node as its level and index in that level.
+struct SVORopeTarget
+{
+    int level;
+    int index;
+};
+
+/**
+ * Neighbor ropes of every entry of the layout, six words each (see SVO_PACK_ROPE); slot
+ * entries get SVO_NO_ROPE. A rope leads to the smallest node whose cube covers the
+ * same-sized cube across the face. They are derived top-down: across a face inside its
+ * parent a child's rope is the sibling there, or the parent when that sibling is empty.
+ * Across a face of the parent it is the child of the parent's neighbor next to it, or
+ * that neighbor itself when it is coarser or has no such child.
+ */
+bool computeSVORopes(const std::vector<SVOLevel>& levels, const SVOLayout& layout, std::vector<uint32_t>* ropes)
+{
+    if(layout.entryCount > (int64_t)SVO_MAX_ROPE_INDEX + 1)
+    {
+        fprintf(stderr, "computeSVORopes: %lld entries exceed the %u addressable by a rope\n", (long long)layout.entryCount, SVO_MAX_ROPE_INDEX + 1);
+        return false;
+    }
+    ropes->assign((size_t)layout.entryCount * 6, SVO_NO_ROPE);
+    std::vector<SVORopeTarget> targets(levels[0].size() * 6, {-1, 0});
+    for(size_t d = 0; d + 1 < levels.size(); d++)
+    {
+        const SVOLevel& level = levels[d];
+        std::vector<SVORopeTarget> childTargets(levels[d + 1].size() * 6);
+        auto childIndex = [&](int node, int octant)
+        {
+            uint8_t childMask = level.childMasks[node];
+            return (int)level.firstChild[node] + __builtin_popcount(childMask & ((1u << octant) - 1));
+        };
+        parallelFor(0, level.size(), [&](int p)
+        {
+            uint8_t childMask = level.childMasks[p];
+            int childCount = __builtin_popcount(childMask);
+            for(int j = (int)level.firstChild[p]; j < (int)level.firstChild[p] + childCount; j++)
+            {
+                int octant = (int)(levels[d + 1].codes[j] & 7);
+                for(int face = 0; face < 6; face++)
+                {
+                    int axisBit = 1 << (face >> 1);
+                    int neighborOctant = octant ^ axisBit;
+                    bool leavesParent = ((octant & axisBit) != 0) == ((face & 1) != 0);
+                    SVORopeTarget target = {(int)d, p};
+                    if(!leavesParent)
+                    {
+                        if(childMask & (1 << neighborOctant)) target = {(int)d + 1, childIndex(p, neighborOctant)};
+                    }
+                    else
+                    {
+                        target = targets[p * 6 + face];
+                        if(target.level == (int)d && (level.childMasks[target.index] & (1 << neighborOctant)))
+                        {
+                            target = {(int)d + 1, childIndex(target.index, neighborOctant)};
+                        }
+                    }
+                    childTargets[j * 6 + face] = target;
+                    if(target.level < 0) continue;
+                    int64_t index = layout.positions[target.level][target.index];
+                    (*ropes)[layout.positions[d + 1][j] * 6 + face] = SVO_PACK_ROPE(index, d + 1 - target.level);
+                }
+            }
+        }, 4096);
+        targets.swap(childTargets);
+    }
+    return true;
+}
+
+// The topology and attribute streams written by encodeSVOStreams.
+struct SVOStreams
+{
+    std::vector<uint32_t> topology;
+    std::vector<uint32_t> attributes;
+};
+
+/**
+ * Split stream encoding of the octree: one topology word per entry, laid out exactly like
+ * the first word of every encodeSVO entry, and a separate stream of packed attributes (see
+ * SVOAttributeFormat). Leaf words carry their attribute index instead of the child fields
+ * (SVO_PACK_LEAF_ATTRIBUTE), so a traversal only reads the 4 byte topology stream until it
+ * reaches a leaf and then fetches a single attribute word.
+ *
+ * With includeInteriorAttributes the attribute stream runs parallel to the topology, slot
+ * entries holding 0, and leaves point at their own entry. Otherwise it holds the leaves
+ * alone in breadth-first order. Returns false with a message on stderr when the entry count
+ * does not fit the encoding.
+ */
+bool encodeSVOStreams(const std::vector<SVOLevel>& levels, GridProperties props, int attributeFormat, bool includeInteriorAttributes, SVOStreams* streams)
+{
+    SVOLayout layout = computeSVOLayout(levels);
+    if(layout.entryCount > INT32_MAX)
+    {
+        fprintf(stderr, "encodeSVOStreams: %lld entries exceed the addressable size of the SVO encoding\n", (long long)layout.entryCount);
+        return false;
+    }
+    int depth = (int)levels.size() - 1;
+    std::vector<int64_t> levelLeafStart(levels.size(), 0);
+    std::vector<std::vector<uint32_t>> leafRanks(levels.size());
+    int64_t leafCount = 0;
+    for(size_t d = 0; d < levels.size(); d++)
+    {
+        levelLeafStart[d] = leafCount;
+        if(includeInteriorAttributes) continue;
+        const SVOLevel& level = levels[d];
+        leafRanks[d].resize(level.size());
+        uint32_t rank = 0;
+        for(int i = 0; i < level.size(); i++)
+        {
+            leafRanks[d][i] = rank;
+            if(level.childMasks[i] == 0) rank++;
+        }
+        leafCount += rank;
+    }
+    streams->topology.assign(layout.entryCount, 0);
+    streams->attributes.assign(includeInteriorAttributes ? layout.entryCount : leafCount, 0);
+    for(size_t d = 0; d < levels.size(); d++)
+    {
+        const SVOLevel& level = levels[d];
+        parallelFor(0, level.size(), [&](int i)
+        {
+            int64_t nodeIndex = layout.positions[d][i];
+            uint32_t absoluteIndex;
+            uint32_t word = packSVONodeWord(levels, layout, d, i, &absoluteIndex);
+            if(word & SVO_FAR_BIT) streams->topology[layout.slots[d][i]] = absoluteIndex;
+            bool isLeaf = level.childMasks[i] == 0;
+            if(!isLeaf && !includeInteriorAttributes)
+            {
+                streams->topology[nodeIndex] = word;
+                return;
+            }
+            int64_t attributeIndex = includeInteriorAttributes ? nodeIndex : levelLeafStart[d] + leafRanks[d][i];
+            if(isLeaf) word = SVO_PACK_LEAF_ATTRIBUTE((uint32_t)attributeIndex);
+            streams->topology[nodeIndex] = word;
+            streams->attributes[attributeIndex] = packSVOAttribute(level, i, depth - (int)d, attributeFormat, props.min, props.voxelSize);
+        }, 4096);
+    }
+    return true;
+}
+
+struct SVOSimplifyOptions
+{
+    float maxNormalAngle;
+    float maxGeometricError;
+    int targetNodeCount;
+};
+
+// What a subtree would become if it were collapsed into one leaf.
+struct SVOCollapse
+{
+    Vec3 attribute;
+    Vec3 point;
+    float weight;
+    float deviation;
+    float error;
+};
+
+float normalAngle(Vec3 a, Vec3 b)
+{
+    float lengths = a.length() * b.length();
+    if(lengths == 0) return (float)M_PI;
+    return std::acos(std::fmax(-1.f, std::fmin(1.f, a.dot(b) / lengths)));
+}
+
+float budgetRatio(float value, float budget)
+{
+    if(budget > 0) return value / budget;
+    return value > 0 ? INFINITY : 0;
+}
+
+/**
+ * Collapses subtrees into single leaves holding their leaf-weighted mean attribute and
+ * returns how many nodes were removed. The cost of collapsing each node is computed
+ * bottom-up, one level at a time with the nodes of a level in parallel:
+ * - the normal deviation bounds the angle between the merged normal and every original
+ *   leaf normal by accumulating the child-to-parent angles,
+ * - the geometric error accumulates the distance of the children's surface samples from
+ *   the merged plane, and is at least the thickness the larger cube adds along the normal.
+ * With dual contouring the attribute is a vertex, so the error is the vertex displacement
+ * and the cube thickness is taken along the diagonal. The cost
+ * max(deviation / maxNormalAngle, error / maxGeometricError) never decreases towards the
+ * root, so collapsing every node whose cost is within a threshold gives a valid cut. The
+ * threshold is 1, both budgets, or with a target node count the smallest one that meets it,
+ * in which case the budgets only weigh normal deviation against geometric error.
+ */
+int simplifySVOLevels(std::vector<SVOLevel>& levels, GridProperties props, int contouringMethod, SVOSimplifyOptions options)
+{
+    int depth = (int)levels.size() - 1;
+    std::vector<std::vector<SVOCollapse>> collapses(levels.size());
+    std::vector<std::vector<float>> costs(levels.size());
+    for(int d = depth; d >= 0; d--)
+    {
+        const SVOLevel& level = levels[d];
+        collapses[d].resize(level.size());
+        costs[d].assign(level.size(), 0);
+        float nodeSize = props.voxelSize * (float)(1u << (depth - d));
+        parallelFor(0, level.size(), [&](int i)
+        {
+            SVOCollapse& collapse = collapses[d][i];
+            if(level.childMasks[i] == 0)
+            {
+                uint32_t x, y, z;
+                decodeMorton(level.codes[i], &x, &y, &z);
+                collapse.attribute = level.normals[i];
+                collapse.point = props.min + Vec3((x + 0.5f) * nodeSize, (y + 0.5f) * nodeSize, (z + 0.5f) * nodeSize);
+                if(contouringMethod == DualContouring) collapse.point = level.normals[i];
+                collapse.weight = 1;
+                collapse.deviation = 0;
+                collapse.error = 0;
+                return;
+            }
+            int first = level.firstChild[i];
+            int last = first + __builtin_popcount(level.childMasks[i]);
+            const std::vector<SVOCollapse>& children = collapses[d + 1];
+            collapse.weight = 0;
+            for(int c = first; c < last; c++)
+            {
+                collapse.attribute.add(children[c].attribute * children[c].weight);
+                collapse.point.add(children[c].point * children[c].weight);
+                collapse.weight += children[c].weight;
+            }
+            collapse.attribute = collapse.attribute / collapse.weight;
+            collapse.point = collapse.point / collapse.weight;
+            collapse.deviation = 0;
+            collapse.error = 0;
+            float thicknessScale = std::sqrt(3.f);
+            if(contouringMethod == DualContouring)
+            {
+                for(int c = first; c < last; c++)
+                {
+                    collapse.error = std::fmax(collapse.error, children[c].error + (children[c].point - collapse.point).length());
+                }
+            }
+            else
+            {
+                float length = collapse.attribute.length();
+                Vec3 normal = length > 0 ? collapse.attribute / length : Vec3(0, 0, 0);
+                if(length > 0) thicknessScale = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+                for(int c = first; c < last; c++)
+                {
+                    collapse.deviation = std::fmax(collapse.deviation, children[c].deviation + normalAngle(children[c].attribute, collapse.attribute));
+                    collapse.error = std::fmax(collapse.error, children[c].error + std::fabs(normal.dot(children[c].point - collapse.point)));
+                }
+            }
+            collapse.error = std::fmax(collapse.error, (nodeSize - props.voxelSize) / 2.f * thicknessScale);
+            costs[d][i] = std::fmax(budgetRatio(collapse.deviation, options.maxNormalAngle), budgetRatio(collapse.error, options.maxGeometricError));
+        }, 256);
+    }
+
+    float threshold = 1;
+    if(options.targetNodeCount > 0)
+    {
+        std::vector<std::pair<float, int>> interior;
+        for(int d = 0; d < depth; d++)
+        {
+            for(int i = 0; i < levels[d].size(); i++)
+            {
+                if(levels[d].childMasks[i] != 0) interior.push_back({costs[d][i], __builtin_popcount(levels[d].childMasks[i])});
+            }
+        }
+        std::sort(interior.begin(), interior.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b)
+        {
+            return a.first > b.first;
+        });
+        threshold = -1;
+        long long keptCount = 1;
+        for(const std::pair<float, int>& node : interior)
+        {
+            if(keptCount + node.second > options.targetNodeCount)
+            {
+                threshold = node.first;
+                break;
+            }
+            keptCount += node.second;
+        }
+    }
+
+    int removedCount = 0;
+    std::vector<SVOLevel> simplified(levels.size());
+    std::vector<int> kept(1, 0);
+    std::vector<int> nextKept;
+    for(int d = 0; d <= depth; d++)
+    {
+        const SVOLevel& level = levels[d];
+        SVOLevel& out = simplified[d];
+        nextKept.clear();
+        for(int i : kept)
+        {
+            out.codes.push_back(level.codes[i]);
+            out.firstChild.push_back((uint32_t)nextKept.size());
+            if(level.childMasks[i] != 0 && costs[d][i] <= threshold)
+            {
+                out.childMasks.push_back(0);
+                out.normals.push_back(collapses[d][i].attribute);
+                continue;
+            }
+            out.childMasks.push_back(level.childMasks[i]);
+            out.normals.push_back(level.normals[i]);
+            int first = level.firstChild[i];
+            int last = level.childMasks[i] == 0 ? first : first + __builtin_popcount(level.childMasks[i]);
+            for(int c = first; c < last; c++) nextKept.push_back(c);
+        }
+        removedCount += level.size() - out.size();
+        kept.swap(nextKept);
+    }
+    levels.swap(simplified);
+    return removedCount;
+}
+
+bool validateSVODepth(int depth)
+{
+    if(depth >= 0 && depth <= SVO_MAX_MORTON_DEPTH) return true;
+    fprintf(stderr, "SVO depth %d is outside the supported range 0..%d\n", depth, SVO_MAX_MORTON_DEPTH);
+    return false;
+}
+
+/**
+ * Bounds of an octree of the given depth around the triangles, padded by half a leaf. The
+ * cube spans size = 2^depth leaves from props.min.
+ */
+GridProperties computeSVOProperties(float* prims, int primCount, int depth)
+{
+    Bounds bounds = computePrimBounds(prims, primCount);
+    Vec3 min = bounds.min;
+    Vec3 max = bounds.max;
+    Vec3 extents = max - min;
+    float maxExtent = extents.maxComponent();
+    float svoSize = maxExtent;
+    for(int i = 0; i < depth; i++) svoSize /= 2.f;
+    min.sub(svoSize / 2);
+    max.add(svoSize / 2);
+    extents = max - min;
+    maxExtent = extents.maxComponent();
+    svoSize = maxExtent;
+    for(int i = 0; i < depth; i++) svoSize /= 2.f;
+    int size = std::round(maxExtent / svoSize);
+    max = min;
+    max.add(maxExtent);
+    GridProperties props = {min, {size, size, size}, svoSize};
+    return props;
+}
+
+float* encodeSVOWithProperties(const std::vector<SVOLevel>& levels, GridProperties props, SVOLayoutOptions layoutOptions = SVO_BREADTH_FIRST_LAYOUT)
+{
+    Vec3 max = props.min;
+    max.add(props.voxelSize * props.gridSize[0]);
+    return encodeSVO(levels, props.min, max, props.gridSize[0], layoutOptions);
+}
+
+/**
+ * encodeSVOWithProperties with the leaves of the deepest level pointing into their
+ * triangle lists: a leaf entry holds SVO_LEAF_BIT, the start of its list and its triangle
+ * count as uints and packOctahedral(normal, true, 15). The entries are followed by the
+ * index count and the concatenated lists. Returns nullptr with a message on stderr when
+ * the result does not fit.
+ */
+float* encodeHybridSVO(const std::vector<SVOLevel>& levels, GridProperties props, const SVOTriangleLists& leafTriangles)
+{
+    float* svo = encodeSVOWithProperties(levels, props);
+    if(svo == nullptr) return nullptr;
+    int entryCount;
+    memcpy(&entryCount, svo + 7, sizeof(int));
+    size_t entryFloats = 8 + (size_t)entryCount * 4;
+    size_t indexCount = leafTriangles.triangles.size();
+    float* result = indexCount <= INT32_MAX ? new (std::nothrow) float[entryFloats + 1 + indexCount] : nullptr;
+    if(result == nullptr)
+    {
+        fprintf(stderr, "encodeHybridSVO: cannot allocate %zu triangle indices\n", indexCount);
+        delete[] svo;
+        return nullptr;
+    }
+    memcpy(result, svo, entryFloats * sizeof(float));
+    delete[] svo;
+    int count = (int)indexCount;
+    memcpy(result + entryFloats, &count, sizeof(int));
+    memcpy(result + entryFloats + 1, leafTriangles.triangles.data(), indexCount * sizeof(int));
+    SVOLayout layout = computeSVOLayout(levels);
+    const SVOLevel& leaves = levels.back();
+    parallelFor(0, leaves.size(), [&](int i)
+    {
+        uint32_t words[4];
+        words[0] = SVO_LEAF_BIT;
+        words[1] = leafTriangles.starts[i];
+        words[2] = leafTriangles.starts[i + 1] - leafTriangles.starts[i];
+        words[3] = packOctahedral(leaves.normals[i], true, 15);
+        memcpy(result + 8 + layout.positions.back()[i] * 4, words, sizeof(words));
+    }, 4096);
+    return result;
+}
+
+// Bins are allocated for all 8^cutLevel cells of the cut level.
+#define SVO_MAX_PAGE_CUT_LEVEL 7
+
+/**
+ * An octree split at cutLevel into pages (see svopages.h) that stay in a page file, and a
+ * resident top tree over levels 0..cutLevel. The top tree is in the split stream encoding;
+ * its leaves are the page roots in Morton order, so a top leaf's attribute index is also
+ * its page id and its attribute, the page root's, serves as the coarse fallback while the
+ * page is not resident.
+ */
+struct PagedSVOHandle
+{
+    GridProperties props;
+    int depth;
+    int cutLevel;
+    int attributeFormat;
+    uint32_t maxPageWordCount;
+    SVOStreams top;
+    SVOPageCache cache;
+};
+
+/**
+ * Builds the pages a batch at a time: the subtrees of a batch are voxelized in parallel,
+ * then encoded and appended to the page file, so only one batch of subtrees is ever held
+ * in memory besides the triangle bins.
+ */
+bool writeSVOPages(float* prims, int primCount, int contouringMethod, PagedSVOHandle* handle, SVOLevel* cut)
+{
+    GridProperties props = handle->props;
+    int subtreeDepth = handle->depth - handle->cutLevel;
+    std::vector<std::vector<int>> cellTriangles = binSVOTriangles(prims, primCount, props, handle->depth, handle->cutLevel);
+    std::vector<uint64_t> cells;
+    for(size_t c = 0; c < cellTriangles.size(); c++)
+    {
+        if(!cellTriangles[c].empty()) cells.push_back(c);
+    }
+    int batchSize = parallelThreadCount() * 4;
+    int64_t fileOffset = 0;
+    for(int batchStart = 0; batchStart < (int)cells.size(); batchStart += batchSize)
+    {
+        int batchEnd = std::min(batchStart + batchSize, (int)cells.size());
+        std::vector<std::vector<SVOLevel>> subtrees(batchEnd - batchStart);
+        parallelFor(batchStart, batchEnd, [&](int c)
+        {
+            subtrees[c - batchStart] = buildSVOSubtree(prims, cellTriangles[cells[c]], props, cells[c], subtreeDepth, contouringMethod);
+            std::vector<int>().swap(cellTriangles[cells[c]]);
+        });
+        for(int c = batchStart; c < batchEnd; c++)
+        {
+            std::vector<SVOLevel>& levels = subtrees[c - batchStart];
+            if(levels[0].size() == 0) continue;
+            SVOStreams page;
+            if(!encodeSVOStreams(levels, props, handle->attributeFormat, false, &page)) return false;
+            uint32_t counts[2] = {(uint32_t)page.topology.size(), (uint32_t)page.attributes.size()};
+            SVOPageEntry entry = {fileOffset, 2 + counts[0] + counts[1]};
+            bool written = fwrite(counts, sizeof(uint32_t), 2, handle->cache.file) == 2
+                && fwrite(page.topology.data(), sizeof(uint32_t), counts[0], handle->cache.file) == counts[0]
+                && fwrite(page.attributes.data(), sizeof(uint32_t), counts[1], handle->cache.file) == counts[1];
+            if(!written)
+            {
+                fprintf(stderr, "createPagedSVO: failed to write page %d\n", (int)handle->cache.pages.size());
+                return false;
+            }
+            fileOffset += (int64_t)entry.wordCount * sizeof(uint32_t);
+            handle->cache.pages.push_back(entry);
+            handle->maxPageWordCount = std::max(handle->maxPageWordCount, entry.wordCount);
+            cut->codes.push_back(cells[c]);
+            cut->normals.push_back(levels[0].normals[0]);
+            std::vector<SVOLevel>().swap(levels);
+        }
+    }
+    return fflush(handle->cache.file) == 0;
+}
+
+/**
+ * Level level of an octree of the given depth as a grid of its own: the same min and
+ * 2^level cells per axis, each 2^(depth - level) leaves wide.
+ */
+GridProperties computeSVOLevelProperties(GridProperties props, int depth, int level)
+{
+    GridProperties levelProps = props;
+    for(int a = 0; a < 3; a++) levelProps.gridSize[a] = 1 << level;
+    levelProps.voxelSize = props.voxelSize * (float)(1u << (depth - level));
+    return levelProps;
+}
+
+// The average triangle normal, or the dual contouring vertex, of cell (x, y, z) of props.
+Vec3 computeSVOCellAttribute(float* prims, GridProperties props, uint32_t x, uint32_t y, uint32_t z, const int* triangles, int triangleCount, int contouringMethod)
+{
+    if(contouringMethod == DualContouring)
+    {
+        return solveDualContouringVoxel(prims, props, x, y, z, triangles, triangleCount).vertex;
+    }
+    Vec3 normalSum(0, 0, 0);
+    for(int t = 0; t < triangleCount; t++)
+    {
+        const float* tri = prims + triangles[t] * 9;
+        Vec3 p1(tri[0], tri[1], tri[2]);
+        Vec3 p2(tri[3], tri[4], tri[5]);
+        Vec3 p3(tri[6], tri[7], tri[8]);
+        normalSum.add((p3 - p1).cross(p2 - p1).normalized());
+    }
+    return normalSum / (float)triangleCount;
+}
+
+// Cubes above the leaves are grown by this fraction of their size while refining, so
+// rounding in a coarse overlap test never drops a triangle that touches a leaf below it.
+#define SVO_PROGRESSIVE_MARGIN 1e-4f
+// Frontier nodes handled per parallel task.
+#define SVO_PROGRESSIVE_GRAIN 256
+
+/**
+ * An octree built top-down one level at a time, so the coarse levels can be rendered while
+ * the deeper ones are still being voxelized. The frontier is the deepest level built so
+ * far, in Morton order, with its attributes. Each of its nodes keeps the triangles that
+ * overlap its cube, and refining tests only those against the node's 8 children. The
+ * leaves of the full depth are tested exactly like in constructSVO and every triangle that
+ * touches one is still in its parent's list, so the finished tree matches constructSVO.
+ * The next level is built in steps of a bounded number of nodes into children, and
+ * replaces the frontier once all of its nodes and attributes exist.
+ */
+struct ProgressiveSVOHandle
+{
+    GridProperties props;
+    int depth;
+    int level;
+    int contouringMethod;
+    std::vector<float> triangles;
+    SVOLevel frontier;
+    // The triangles of frontier node i are frontierTriangles[triangleStarts[i]] ...
+    // frontierTriangles[triangleStarts[i + 1] - 1], in increasing order.
+    std::vector<uint32_t> triangleStarts;
+    std::vector<int> frontierTriangles;
+    // The children of the first refinedParents frontier nodes, the first attributedChildren
+    // of them with their attributes, and their triangle lists.
+    int refinedParents;
+    int attributedChildren;
+    SVOLevel children;
+    std::vector<uint32_t> childTriangleStarts;
+    std::vector<int> childTriangles;
+    // The levels of the last getProgressiveSVO result and the positions of their entries in
+    // it. Frontier nodes that got no children stay leaves of their level there and set
+    // hasStaleLeaves; encoding the full depth from scratch drops them.
+    std::vector<SVOLevel> levels;
+    SVOLayout layout;
+    std::vector<float> encoded;
+    bool hasStaleLeaves;
+};
+
+// The average triangle normals, or dual contouring vertices, of nodes first..last-1 of a level.
+void computeProgressiveSVOAttributes(ProgressiveSVOHandle* handle, SVOLevel& nodes, int level, const std::vector<uint32_t>& starts, const std::vector<int>& triangles, int first, int last)
+{
+    GridProperties levelProps = computeSVOLevelProperties(handle->props, handle->depth, level);
+    nodes.normals.resize(nodes.size());
+    parallelFor(first, last, [&](int i)
+    {
+        uint32_t x, y, z;
+        decodeMorton(nodes.codes[i], &x, &y, &z);
+        nodes.normals[i] = computeSVOCellAttribute(handle->triangles.data(), levelProps, x, y, z, triangles.data() + starts[i], (int)(starts[i + 1] - starts[i]), handle->contouringMethod);
+    }, SVO_PROGRESSIVE_GRAIN);
+}
+
+// Clears the children for refining the frontier. The triangle lists of the full depth
+// leaves are not needed once their attributes exist and are released.
+void startProgressiveSVOLevel(ProgressiveSVOHandle* handle)
+{
+    handle->refinedParents = 0;
+    handle->attributedChildren = 0;
+    handle->children = SVOLevel();
+    handle->childTriangleStarts.assign(1, 0);
+    handle->childTriangles.clear();
+    if(handle->level == handle->depth)
+    {
+        std::vector<uint32_t>().swap(handle->triangleStarts);
+        std::vector<int>().swap(handle->frontierTriangles);
+    }
+}
+
+/**
+ * True when the three corners of the triangle fall into the same cell of props, which is
+ * written to cell. Such a triangle lies inside that cell and overlaps no other, which
+ * spares the overlap test above the leaves, where a superset of the overlaps is enough.
+ */
+bool containingSVOCell(GridProperties props, const float* tri, indexTriplet* cell)
+{
+    indexTriplet p1 = getIndices(Vec3(tri[0], tri[1], tri[2]), props.min, props.voxelSize);
+    indexTriplet p2 = getIndices(Vec3(tri[3], tri[4], tri[5]), props.min, props.voxelSize);
+    indexTriplet p3 = getIndices(Vec3(tri[6], tri[7], tri[8]), props.min, props.voxelSize);
+    *cell = p1;
+    return p1.x == p2.x && p1.x == p3.x && p1.y == p2.y && p1.y == p3.y && p1.z == p2.z && p1.z == p3.z;
+}
+
+// Triangles binned per parallel task when seeding.
+#define SVO_PROGRESSIVE_SEED_GRAIN 4096
+// Seed levels up to this one are grouped with a count per cell, 8^level counts in all.
+#define SVO_PROGRESSIVE_DENSE_LEVELS 7
+
+/**
+ * Makes level the frontier by binning every triangle straight into the cells of that
+ * level, one pass over the triangles instead of one per level above it. The (cell,
+ * triangle) pairs come out in triangle order and are grouped by a stable counting sort
+ * over the cells' Morton codes, which keeps every node's triangles in increasing order.
+ */
+void seedProgressiveSVO(ProgressiveSVOHandle* handle, int level)
+{
+    GridProperties levelProps = computeSVOLevelProperties(handle->props, handle->depth, level);
+    bool isLeafLevel = level == handle->depth;
+    float margin = isLeafLevel ? 0.f : levelProps.voxelSize * SVO_PROGRESSIVE_MARGIN;
+    float* prims = handle->triangles.data();
+    int primCount = (int)handle->triangles.size() / 9;
+    int taskCount = (primCount + SVO_PROGRESSIVE_SEED_GRAIN - 1) / SVO_PROGRESSIVE_SEED_GRAIN;
+    std::vector<std::vector<std::pair<uint64_t, int>>> taskOverlaps(taskCount);
+    parallelFor(0, taskCount, [&](int task)
+    {
+        int last = std::min(primCount, (task + 1) * SVO_PROGRESSIVE_SEED_GRAIN);
+        std::vector<std::pair<uint64_t, int>>& overlaps = taskOverlaps[task];
+        for(int i = task * SVO_PROGRESSIVE_SEED_GRAIN; i < last; i++)
+        {
+            const float* tri = prims + i * 9;
+            indexTriplet cell;
+            if(!isLeafLevel && containingSVOCell(levelProps, tri, &cell))
+            {
+                if(cell.x >= 0 && cell.y >= 0 && cell.z >= 0 && cell.x < levelProps.gridSize[0] && cell.y < levelProps.gridSize[1] && cell.z < levelProps.gridSize[2])
+                {
+                    overlaps.push_back({encodeMorton(cell.x, cell.y, cell.z), i});
+                }
+                continue;
+            }
+            forEachOverlappedVoxel(levelProps, tri, fullVoxelRange(levelProps), [&](int x, int y, int z)
+            {
+                overlaps.push_back({encodeMorton(x, y, z), i});
+            }, margin);
+        }
+    });
+    std::vector<std::pair<uint64_t, int>> overlaps;
+    for(std::vector<std::pair<uint64_t, int>>& task : taskOverlaps)
+    {
+        overlaps.insert(overlaps.end(), task.begin(), task.end());
+        std::vector<std::pair<uint64_t, int>>().swap(task);
+    }
+
+    handle->frontier = SVOLevel();
+    handle->triangleStarts.assign(1, 0);
+    handle->frontierTriangles.resize(overlaps.size());
+    if(level <= SVO_PROGRESSIVE_DENSE_LEVELS)
+    {
+        std::vector<uint32_t> cellStarts(((size_t)1 << (3 * level)) + 1, 0);
+        for(const std::pair<uint64_t, int>& overlap : overlaps) cellStarts[overlap.first + 1]++;
+        for(size_t c = 0; c + 1 < cellStarts.size(); c++)
+        {
+            if(cellStarts[c + 1] == 0) continue;
+            handle->frontier.codes.push_back(c);
+            handle->triangleStarts.push_back(handle->triangleStarts.back() + cellStarts[c + 1]);
+        }
+        for(size_t c = 1; c < cellStarts.size(); c++) cellStarts[c] += cellStarts[c - 1];
+        for(const std::pair<uint64_t, int>& overlap : overlaps) handle->frontierTriangles[cellStarts[overlap.first]++] = overlap.second;
+    }
+    else
+    {
+        std::sort(overlaps.begin(), overlaps.end());
+        for(size_t o = 0; o < overlaps.size(); o++)
+        {
+            if(o > 0 && overlaps[o].first != overlaps[o - 1].first) handle->triangleStarts.push_back((uint32_t)o);
+            if(o == 0 || overlaps[o].first != overlaps[o - 1].first) handle->frontier.codes.push_back(overlaps[o].first);
+            handle->frontierTriangles[o] = overlaps[o].second;
+        }
+        if(!overlaps.empty()) handle->triangleStarts.push_back((uint32_t)overlaps.size());
+    }
+    handle->level = level;
+    computeProgressiveSVOAttributes(handle, handle->frontier, level, handle->triangleStarts, handle->frontierTriangles, 0, handle->frontier.size());
+    startProgressiveSVOLevel(handle);
+}
+
+// Appends the children of frontier nodes firstParent..lastParent-1 to the children.
+void refineProgressiveSVONodes(ProgressiveSVOHandle* handle, int firstParent, int lastParent)
+{
+    int level = handle->level + 1;
+    GridProperties levelProps = computeSVOLevelProperties(handle->props, handle->depth, level);
+    bool isLeafLevel = level == handle->depth;
+    float margin = isLeafLevel ? 0.f : levelProps.voxelSize * SVO_PROGRESSIVE_MARGIN;
+    float* prims = handle->triangles.data();
+    const SVOLevel& parents = handle->frontier;
+    int taskCount = (lastParent - firstParent + SVO_PROGRESSIVE_GRAIN - 1) / SVO_PROGRESSIVE_GRAIN;
+    std::vector<std::vector<uint64_t>> childCodes(taskCount);
+    std::vector<std::vector<uint32_t>> childTriangleCounts(taskCount);
+    std::vector<std::vector<int>> childTriangles(taskCount);
+    parallelFor(0, taskCount, [&](int task)
+    {
+        int first = firstParent + task * SVO_PROGRESSIVE_GRAIN;
+        int last = std::min(first + SVO_PROGRESSIVE_GRAIN, lastParent);
+        std::vector<int> cellTriangles[8];
+        for(int p = first; p < last; p++)
+        {
+            uint32_t px, py, pz;
+            decodeMorton(parents.codes[p], &px, &py, &pz);
+            VoxelRange window = {{(int)px * 2, (int)py * 2, (int)pz * 2}, {(int)px * 2 + 1, (int)py * 2 + 1, (int)pz * 2 + 1}};
+            for(int c = 0; c < 8; c++) cellTriangles[c].clear();
+            for(uint32_t t = handle->triangleStarts[p]; t < handle->triangleStarts[p + 1]; t++)
+            {
+                int tri = handle->frontierTriangles[t];
+                const float* vertices = prims + tri * 9;
+                indexTriplet cell;
+                if(!isLeafLevel && containingSVOCell(levelProps, vertices, &cell))
+                {
+                    if((cell.x >> 1) == (int)px && (cell.y >> 1) == (int)py && (cell.z >> 1) == (int)pz)
+                    {
+                        cellTriangles[(cell.x & 1) | ((cell.y & 1) << 1) | ((cell.z & 1) << 2)].push_back(tri);
+                    }
+                    continue;
+                }
+                forEachOverlappedVoxel(levelProps, vertices, window, [&](int x, int y, int z)
+                {
+                    cellTriangles[(x & 1) | ((y & 1) << 1) | ((z & 1) << 2)].push_back(tri);
+                }, margin);
+            }
+            for(int c = 0; c < 8; c++)
+            {
+                if(cellTriangles[c].empty()) continue;
+                childCodes[task].push_back(parents.codes[p] << 3 | c);
+                childTriangleCounts[task].push_back((uint32_t)cellTriangles[c].size());
+                childTriangles[task].insert(childTriangles[task].end(), cellTriangles[c].begin(), cellTriangles[c].end());
+            }
+        }
+    });
+
+    for(int task = 0; task < taskCount; task++)
+    {
+        handle->children.codes.insert(handle->children.codes.end(), childCodes[task].begin(), childCodes[task].end());
+        for(uint32_t count : childTriangleCounts[task]) handle->childTriangleStarts.push_back(handle->childTriangleStarts.back() + count);
+        handle->childTriangles.insert(handle->childTriangles.end(), childTriangles[task].begin(), childTriangles[task].end());
+        std::vector<int>().swap(childTriangles[task]);
+    }
+}
+
+/**
+ * Does up to maxNodes nodes of work on the next level, all of it when maxNodes <= 0:
+ * refining frontier nodes into children first, then computing the children's attributes.
+ * The children become the frontier once both are done.
+ */
+void refineProgressiveSVO(ProgressiveSVOHandle* handle, int maxNodes)
+{
+    int64_t budget = maxNodes > 0 ? maxNodes : INT64_MAX;
+    int parentCount = handle->frontier.size();
+    if(handle->refinedParents < parentCount)
+    {
+        int last = (int)std::min<int64_t>(parentCount, handle->refinedParents + budget);
+        refineProgressiveSVONodes(handle, handle->refinedParents, last);
+        budget -= last - handle->refinedParents;
+        handle->refinedParents = last;
+        if(last < parentCount) return;
+    }
+    int childCount = handle->children.size();
+    int last = (int)std::min<int64_t>(childCount, handle->attributedChildren + budget);
+    computeProgressiveSVOAttributes(handle, handle->children, handle->level + 1, handle->childTriangleStarts, handle->childTriangles, handle->attributedChildren, last);
+    handle->attributedChildren = last;
+    if(last < childCount) return;
+    handle->frontier = std::move(handle->children);
+    handle->triangleStarts = std::move(handle->childTriangleStarts);
+    handle->frontierTriangles = std::move(handle->childTriangles);
+    handle->level++;
+    startProgressiveSVOLevel(handle);
+}
+
+/**
+ * Encodes the frontier and the levels above it from scratch into handle->encoded. Returns
+ * false with a message on stderr when the tree does not fit the encoding.
+ */
+bool encodeProgressiveSVO(ProgressiveSVOHandle* handle)
+{
+    handle->levels = buildSVOLevels(handle->frontier, handle->level);
+    handle->layout = computeSVOLayout(handle->levels);
+    GridProperties levelProps = computeSVOLevelProperties(handle->props, handle->depth, handle->level);
+    Vec3 max = levelProps.min;
+    max.add(levelProps.voxelSize * levelProps.gridSize[0]);
+    float* result = encodeSVOWithLayout(handle->levels, handle->layout, levelProps.min, max, levelProps.gridSize[0]);
+    if(result == nullptr) return false;
+    handle->encoded.assign(result, result + 8 + handle->layout.entryCount * 4);
+    delete[] result;
+    handle->hasStaleLeaves = false;
+    return true;
+}
+
+/**
+ * Appends the frontier to handle->encoded when it is the level below the encoded ones: the
+ * nodes of the encoded deepest level get their child masks and near offsets, and the
+ * interior normals are averaged again. The deepest level is the last in the breadth-first
+ * layout and has no far slots, so no entry moves. Returns false when the frontier needs a
+ * full encodeProgressiveSVO instead: when levels were skipped, when an offset needs a far
+ * pointer, or when the full depth is reached with stale leaves in the encoding.
+ */
+bool appendProgressiveSVOLevel(ProgressiveSVOHandle* handle)
+{
+    if(handle->levels.empty() || (int)handle->levels.size() != handle->level) return false;
+    SVOLevel& parents = handle->levels.back();
+    const SVOLevel& frontier = handle->frontier;
+    int64_t parentStart = handle->layout.entryCount - parents.size();
+    int64_t entryCount = handle->layout.entryCount + frontier.size();
+    if(entryCount > INT32_MAX) return false;
+    int parent = 0;
+    for(int i = 0; i < frontier.size(); i++)
+    {
+        while(parents.codes[parent] != frontier.codes[i] >> 3) parent++;
+        if(parents.childMasks[parent] == 0)
+        {
+            parents.firstChild[parent] = (uint32_t)i;
+            if(handle->layout.entryCount + i - (parentStart + parent) > SVO_MAX_CHILD_OFFSET) return false;
+        }
+        parents.childMasks[parent] |= 1 << (frontier.codes[i] & 7);
+    }
+    bool hasStaleLeaves = handle->hasStaleLeaves || std::find(parents.childMasks.begin(), parents.childMasks.end(), 0) != parents.childMasks.end();
+    if(hasStaleLeaves && handle->level == handle->depth) return false;
+    handle->hasStaleLeaves = hasStaleLeaves;
+
+    SVOLevel leaves = frontier;
+    leaves.childMasks.assign(leaves.size(), 0);
+    leaves.firstChild.assign(leaves.size(), 0);
+    handle->levels.push_back(std::move(leaves));
+    std::vector<int64_t> positions(frontier.size());
+    for(int i = 0; i < frontier.size(); i++) positions[i] = handle->layout.entryCount + i;
+    handle->layout.positions.push_back(std::move(positions));
+    handle->layout.slots.push_back(std::vector<int64_t>(frontier.size(), -1));
+    handle->layout.entryCount = entryCount;
+
+    GridProperties levelProps = computeSVOLevelProperties(handle->props, handle->depth, handle->level);
+    int size = levelProps.gridSize[0];
+    int count = (int)entryCount;
+    handle->encoded.resize(8 + (size_t)entryCount * 4);
+    memcpy(handle->encoded.data() + 6, &size, sizeof(int));
+    memcpy(handle->encoded.data() + 7, &count, sizeof(int));
+    for(int d = handle->level; d >= 0; d--)
+    {
+        SVOLevel& level = handle->levels[d];
+        parallelFor(0, level.size(), [&](int i)
+        {
+            if(level.childMasks[i] != 0)
+            {
+                // The same sum and division as buildParentLevel.
+                const SVOLevel& below = handle->levels[d + 1];
+                Vec3 normal(0, 0, 0);
+                int childCount = __builtin_popcount(level.childMasks[i]);
+                for(int c = 0; c < childCount; c++) normal.add(below.normals[level.firstChild[i] + c]);
+                level.normals[i] = normal / (float)childCount;
+            }
+            float* node = handle->encoded.data() + 8 + handle->layout.positions[d][i] * 4;
+            if(d + 1 >= handle->level)
+            {
+                uint32_t absoluteIndex;
+                uint32_t packedBits = packSVONodeWord(handle->levels, handle->layout, d, i, &absoluteIndex);
+                memcpy(node, &packedBits, sizeof(uint32_t));
+            }
+            node[1] = level.normals[i].x;
+            node[2] = level.normals[i].y;
+            node[3] = level.normals[i].z;
+        }, 4096);
+    }
+    return true;
+}
+
+/**
+ * An octree that stays editable after construction (see EditableSVO). Voxel coordinates
+ * of the edits are leaf cells of props.
+ */
+struct DynamicSVOHandle
+{
+    GridProperties props;
+    EditableSVO svo;
+};
+
+/**
+ * Checks that count edits cannot grow the encoding past INT32_MAX entries: an edit moves
+ * at most one block per level, and a block takes at most 16 entries.
+ */
+bool validateSVOEditCount(DynamicSVOHandle* handle, int count, const char* caller)
+{
+    int64_t worstCase = handle->svo.entryCount + (int64_t)std::max(count, 0) * (handle->svo.tree.depth + 1) * 16;
+    if(worstCase <= INT32_MAX) return true;
+    fprintf(stderr, "%s: %d edits could grow the SVO past %d entries\n", caller, count, INT32_MAX);
+    return false;
+}
+
+bool validSVOVoxel(DynamicSVOHandle* handle, const int* voxel)
+{
+    int size = handle->props.gridSize[0];
+    return voxel[0] >= 0 && voxel[0] < size && voxel[1] >= 0 && voxel[1] < size && voxel[2] >= 0 && voxel[2] < size;
+}
+
+/**
+ * Applies the edited voxels to the encoding and returns the ranges it rewrote: the range
+ * count, a byte offset into the getDynamicSVO buffer and a byte length per range, then the
+ * floats of every range in order, ready for partial uploads.
+ */
+float* updateDynamicSVO(DynamicSVOHandle* handle, const std::vector<uint32_t>& voxels)
+{
+    EditableSVO& svo = handle->svo;
+    if(!voxels.empty()) svo.updatePaths(voxels);
+    std::vector<std::pair<int64_t, int64_t>> ranges = svo.takeDirtyRanges();
+    size_t floatCount = 1 + ranges.size() * 2;
+    for(const std::pair<int64_t, int64_t>& range : ranges) floatCount += range.second - range.first;
+    float* result = new float[floatCount];
+    int rangeCount = (int)ranges.size();
+    memcpy(result, &rangeCount, sizeof(int));
+    float* out = result + 1 + ranges.size() * 2;
+    for(size_t r = 0; r < ranges.size(); r++)
+    {
+        int byteRange[2] = {(int)(ranges[r].first * 4), (int)((ranges[r].second - ranges[r].first) * 4)};
+        memcpy(result + 1 + r * 2, byteRange, sizeof(byteRange));
+        memcpy(out, svo.data.data() + ranges[r].first, byteRange[1]);
+        out += ranges[r].second - ranges[r].first;
+    }
+    return result;
+}
+
+/**
+ * Casts the rays with traversal and writes per ray the hit distance (-1 on a miss), the
+ * leaf's entry index as an int (-1 on a miss) and its normal from nodes. When fetchStats
+ * is not null it receives statCount of: the average entry reads per ray, the average
+ * distance in entries between consecutive reads, the fraction of near reads and the
+ * average rope reads per ray.
+ */
+template <typename T>
+float* castRaysWithTraversal(const T& traversal, const SVOTraversal& nodes, float* rays, int rayCount, float* fetchStats, int statCount)
+{
+    float* result = new float[rayCount * 5];
+    std::vector<SVOTraversalStats> rayStats(rayCount);
+    parallelFor(0, rayCount, [&](int r)
+    {
+        const float* ray = rays + r * 6;
+        rayStats[r] = {0, 0, 0, 0};
+        SVOHit hit = traversal.castRay(Vec3(ray[0], ray[1], ray[2]), Vec3(ray[3], ray[4], ray[5]), INFINITY, &rayStats[r]);
+        int node = hit.hit ? (int)hit.node : -1;
+        Vec3 normal = hit.hit ? nodes.normal(hit.node) : Vec3();
+        float* out = result + r * 5;
+        out[0] = hit.hit ? hit.t : -1.f;
+        memcpy(out + 1, &node, sizeof(int));
+        out[2] = normal.x;
+        out[3] = normal.y;
+        out[4] = normal.z;
+    }, 64);
+    if(fetchStats != nullptr)
+    {
+        double fetchCount = 0, fetchDistance = 0, nearFetchCount = 0, ropeFetchCount = 0;
+        for(const SVOTraversalStats& stats : rayStats)
+        {
+            fetchCount += stats.fetchCount;
+            fetchDistance += stats.fetchDistance;
+            nearFetchCount += stats.nearFetchCount;
+            ropeFetchCount += stats.ropeFetchCount;
+        }
+        float values[4] = {
+            rayCount > 0 ? (float)(fetchCount / rayCount) : 0.f,
+            fetchCount > 0 ? (float)(fetchDistance / fetchCount) : 0.f,
+            fetchCount > 0 ? (float)(nearFetchCount / fetchCount) : 0.f,
+            rayCount > 0 ? (float)(ropeFetchCount / rayCount) : 0.f};
+        for(int i = 0; i < statCount; i++) fetchStats[i] = values[i];
+    }
+    return result;
+}
+
+// Cells per triangle the automatic triangle grid resolution aims for.
+#define TRIANGLE_GRID_DENSITY 4.0
+// Largest automatic triangle grid resolution along the longest axis.
+#define TRIANGLE_GRID_MAX_SIZE 256
+// Cells are grown by this fraction of their size for the overlap test, so a ray that
+// rounds into a neighbouring cell at a shared face still finds the triangle there.
+#define TRIANGLE_GRID_MARGIN 1e-4f
+// Triangles per parallel task of buildTriangleGrid.
+#define TRIANGLE_GRID_GRAIN 1024
+
+/**
+ * The triangle grid resolution along the longest axis: the smallest one whose cells over
+ * the mesh bounds number at least TRIANGLE_GRID_DENSITY per triangle. Cells are counted
+ * per axis rather than by volume, so a flat mesh gets a fine single layer instead of a
+ * few huge cells.
+ */
+int triangleGridSize(float* prims, int primCount)
+{
+    Bounds bounds = computePrimBounds(prims, primCount);
+    Vec3 extents = bounds.max - bounds.min;
+    float maxExtent = extents.maxComponent();
+    double target = TRIANGLE_GRID_DENSITY * primCount;
+    for(int size = 2; size < TRIANGLE_GRID_MAX_SIZE; size++)
+    {
+        float cellSize = maxExtent / (float)size;
+        double cellCount = 1.0;
+        for(int a = 0; a < 3; a++) cellCount *= std::max(1.0, std::ceil((double)extents[a] / cellSize));
+        if(cellCount >= target) return size;
+    }
+    return TRIANGLE_GRID_MAX_SIZE;
+}
+
+/**
+ * Bins the triangles into the cells of props they overlap, the same test initGrid uses,
+ * as compressed sparse rows: the triangles of cell c are triangles[cellStarts[c]] up to
+ * triangles[cellStarts[c + 1]], in ascending order. Cells are indexed x-major.
+ */
+void buildTriangleGrid(float* prims, int primCount, GridProperties props, std::vector<uint32_t>* cellStarts, std::vector<uint32_t>* triangles)
+{
+    int* gridSize = props.gridSize;
+    size_t cellCount = (size_t)gridSize[0] * gridSize[1] * gridSize[2];
+    int chunkCount = (primCount + TRIANGLE_GRID_GRAIN - 1) / TRIANGLE_GRID_GRAIN;
+    // (cell, triangle) pairs per chunk of triangles.
+    std::vector<std::vector<uint32_t>> chunkPairs(chunkCount);
+    float margin = props.voxelSize * TRIANGLE_GRID_MARGIN;
+    parallelFor(0, chunkCount, [&](int c)
+    {
+        std::vector<uint32_t>& pairs = chunkPairs[c];
+        int end = std::min(primCount, (c + 1) * TRIANGLE_GRID_GRAIN);
+        for(int i = c * TRIANGLE_GRID_GRAIN; i < end; i++)
+        {
+            forEachOverlappedVoxel(props, prims + i * 9, fullVoxelRange(props), [&](int x, int y, int z)
+            {
+                pairs.push_back(((uint32_t)x * gridSize[1] + y) * gridSize[2] + z);
+                pairs.push_back((uint32_t)i);
+            }, margin);
+        }
+    });
+    cellStarts->assign(cellCount + 1, 0);
+    for(const std::vector<uint32_t>& pairs : chunkPairs)
+    {
+        for(size_t p = 0; p < pairs.size(); p += 2) (*cellStarts)[pairs[p] + 1]++;
+    }
+    for(size_t c = 0; c < cellCount; c++) (*cellStarts)[c + 1] += (*cellStarts)[c];
+    triangles->resize(cellStarts->back());
+    std::vector<uint32_t> cursor(cellStarts->begin(), cellStarts->end() - 1);
+    for(const std::vector<uint32_t>& pairs : chunkPairs)
+    {
+        for(size_t p = 0; p < pairs.size(); p += 2) (*triangles)[cursor[pairs[p]]++] = pairs[p + 1];
+    }
+}
+
+int writeVoxelGridHeader(float* result, GridProperties props)
+{
+    result[0] = props.min.x;
+    result[1] = props.min.y;
+    result[2] = props.min.z;
+    memcpy(result + 3, props.gridSize, 3 * sizeof(int));
+    result[6] = props.voxelSize;
+    return 7;
+}
+
+// Writes the voxels of the range in x-fastest order, four floats each: the average normal
+// followed by the filled flag as an int.
+void writeVoxelRangeNormals(float* result, Voxel* grid, GridProperties props, VoxelRange range)
+{
+    int* gridSize = props.gridSize;
+    size_t xMultiplier = (size_t)gridSize[1] * gridSize[2];
+    size_t yMultiplier = gridSize[2];
+    size_t rangeSize[3];
+    for(int i = 0; i < 3; i++) rangeSize[i] = range.max[i] - range.min[i] + 1;
+    for(int z = range.min[2]; z <= range.max[2]; z++)
+    {
+        for(int y = range.min[1]; y <= range.max[1]; y++)
+        {
+            for(int x = range.min[0]; x <= range.max[0]; x++)
+            {
+                Voxel vx = grid[x * xMultiplier + y * yMultiplier + z];
+                size_t rx = x - range.min[0];
+                size_t ry = y - range.min[1];
+                size_t rz = z - range.min[2];
+                size_t index = ((rz * rangeSize[1] + ry) * rangeSize[0] + rx) * 4;
+                int isFilled = vx.childCount > 0 ? 1 : 0;
+                Vec3 avgNormal = vx.childCount > 0 ? vx.normalSum / (float)vx.childCount : vx.normalSum;
+                result[index] = avgNormal.x;
+                result[index+1] = avgNormal.y;
+                result[index+2] = avgNormal.z;
+                memcpy(result + index + 3, &isFilled, sizeof(int));
+            }
+        }
+    }
+}
+
+// Writes the dual contouring layout of gridVoxelization.js: the vertex position followed
+// by (isFilled | edgeMask << 1) as an int.
+void writeVoxelGridDualContouring(float* result, Voxel* grid, DualContouringVoxel* dcVoxels, GridProperties props)
+{
+    int* gridSize = props.gridSize;
+    int xMultiplier = gridSize[1] * gridSize[2];
+    int yMultiplier = gridSize[2];
+    for(int z = 0; z < gridSize[2]; z++)
+    {
+        for(int y = 0; y < gridSize[1]; y++)
+        {
+            for(int x = 0; x < gridSize[0]; x++)
+            {
+                int gridIndex = x * xMultiplier + y * yMultiplier + z;
+                int index = (z * gridSize[0] * gridSize[1] + y * gridSize[0] + x) * 4;
+                DualContouringVoxel dc = dcVoxels[gridIndex];
+                int packed = (grid[gridIndex].childCount > 0 ? 1 : 0) | (dc.edgeMask << 1);
+                result[index] = dc.vertex.x;
+                result[index+1] = dc.vertex.y;
+                result[index+2] = dc.vertex.z;
+                memcpy(result + index + 3, &packed, sizeof(int));
+            }
+        }
+    }
+}
+
+void writeVoxelGridNormals(float* result, Voxel* grid, GridProperties props)
+{
+    writeVoxelRangeNormals(result, grid, props, fullVoxelRange(props));
+}
+
+void writeVoxelGridPacked(unsigned int* result, Voxel* grid, GridProperties props, int bitsPerVoxel)
+{
+    int* gridSize = props.gridSize;
+    int xMultiplier = gridSize[1] * gridSize[2];
+    int yMultiplier = gridSize[2];
+    int bitsPerAxis = (bitsPerVoxel - 1) / 2;
+    int voxelsPerWord = 32 / bitsPerVoxel;
+    for(int z = 0; z < gridSize[2]; z++)
+    {
+        for(int y = 0; y < gridSize[1]; y++)
+        {
+            for(int x = 0; x < gridSize[0]; x++)
+            {
+                Voxel vx = grid[x * xMultiplier + y * yMultiplier + z];
+                size_t index = ((size_t)z * gridSize[1] + y) * gridSize[0] + x;
+                unsigned int packed = packOctahedral(vx.normalSum, vx.childCount > 0, bitsPerAxis);
+                int shift = (index % voxelsPerWord) * bitsPerVoxel;
+                result[index / voxelsPerWord] |= packed << shift;
+            }
+        }
+    }
+}
+
+extern "C"
+{
+float* constructVoxelGrid(float* prims, int primCount, int size, int contouringMethod)
+{
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    Voxel* grid = initGrid(prims, primCount, props);
+    int totalGridSize = props.gridSize[0] * props.gridSize[1] * props.gridSize[2];
+    float* result = new float[(totalGridSize * 4) + 7];
+    int offset = writeVoxelGridHeader(result, props);
+    if(contouringMethod == DualContouring)
+    {
+        DualContouringVoxel* dcVoxels = computeDualContouring(prims, primCount, props);
+        writeVoxelGridDualContouring(result + offset, grid, dcVoxels, props);
+        delete[] dcVoxels;
+    }
+    else
+    {
+        writeVoxelGridNormals(result + offset, grid, props);
+    }
+    delete[] grid;
+    return result;
+}
+
+/**
+ * Same header as constructVoxelGrid, followed by one octahedral-encoded normal per voxel
+ * (see octahedral.h) instead of four floats. bitsPerVoxel is 32 (one uint32 per voxel)
+ * or 16 (two voxels per uint32, lower half first); other values return nullptr.
+ */
+float* constructCompactVoxelGrid(float* prims, int primCount, int size, int bitsPerVoxel)
+{
+    if(bitsPerVoxel != 16 && bitsPerVoxel != 32)
+    {
+        fprintf(stderr, "constructCompactVoxelGrid: %d bits per voxel, expected 16 or 32\n", bitsPerVoxel);
+        return nullptr;
+    }
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    Voxel* grid = initGrid(prims, primCount, props);
+    size_t totalGridSize = (size_t)props.gridSize[0] * props.gridSize[1] * props.gridSize[2];
+    size_t wordCount = bitsPerVoxel == 32 ? totalGridSize : (totalGridSize + 1) / 2;
+    float* result = new float[wordCount + 7];
+    int offset = writeVoxelGridHeader(result, props);
+    memset(result + offset, 0, wordCount * sizeof(unsigned int));
+    writeVoxelGridPacked((unsigned int*)(result + offset), grid, props, bitsPerVoxel);
+    delete[] grid;
+    return result;
+}
+
+/**
+ * Same layout as constructVoxelGrid, followed by ceil(totalGridSize / 32) uint32 words of
+ * occupancy bits. Bit (index & 31) of word (index >> 5) is set when the voxel at
+ * index = z * sizeX * sizeY + y * sizeX + x is on the surface or inside the mesh.
+ */
+float* constructSolidVoxelGrid(float* prims, int primCount, int size)
+{
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    Voxel* grid = initGrid(prims, primCount, props);
+    unsigned char* solid = initSolidGrid(prims, primCount, props, grid);
+    int* gridSize = props.gridSize;
+    int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
+    int wordCount = (totalGridSize + 31) / 32;
+    float* result = new float[(totalGridSize * 4) + 7 + wordCount];
+    int offset = writeVoxelGridHeader(result, props);
+    writeVoxelGridNormals(result + offset, grid, props);
+    unsigned int* occupancy = (unsigned int*)(result + offset + totalGridSize * 4);
+    packOccupancyBits(occupancy, solid, props);
+    delete[] solid;
+    delete[] grid;
+    return result;
+}
+
+/**
+ * Same header as constructVoxelGrid, followed by one float per voxel holding the signed
+ * distance from the voxel center to the mesh, negative inside. With bandWidth > 0 only
+ * voxels within bandWidth voxels of a triangle get exact distances and the rest are clamped
+ * to +-bandWidth * voxelSize; with bandWidth <= 0 the full field is propagated from a one
+ * voxel band of exact distances by the fast sweeping of sweepDistanceField.
+ */
+float* constructSignedDistanceField(float* prims, int primCount, int size, int bandWidth)
+{
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    int* gridSize = props.gridSize;
+    int totalGridSize = gridSize[0] * gridSize[1] * gridSize[2];
+    bool fullField = bandWidth <= 0;
+    SDFSeeds seeds = seedDistanceField(prims, primCount, props, fullField ? 1 : bandWidth);
+    if(fullField)
+    {
+        sweepDistanceField(prims, props, seeds);
+    }
+    unsigned char* solid = initSolidGrid(prims, primCount, props, nullptr);
+    float bandLimit = fullField ? INFINITY : bandWidth * props.voxelSize;
+    float* result = new float[totalGridSize + 7];
+    int offset = writeVoxelGridHeader(result, props);
+    int xMultiplier = gridSize[1] * gridSize[2];
+    int yMultiplier = gridSize[2];
+    parallelFor(0, gridSize[2], [&](int z)
+    {
+        for(int y = 0; y < gridSize[1]; y++)
+        {
+            for(int x = 0; x < gridSize[0]; x++)
+            {
+                int index = x * xMultiplier + y * yMultiplier + z;
+                float distance = std::min(seeds.distance[index], bandLimit);
+                result[offset + z * gridSize[0] * gridSize[1] + y * gridSize[0] + x] = solid[index] ? -distance : distance;
+            }
+        }
+    });
+    delete[] solid;
+    delete[] seeds.closestTriangle;
+    delete[] seeds.distance;
+    return result;
+}
+
+typedef void (*VoxelSlabCallback)(int zStart, int zCount, float* slabData, void* userData);
+
+/**
+ * Voxelizes the mesh like constructVoxelGrid, one slab of slabDepth z layers at a time.
+ * Triangles are first bucketed by the slabs their z range covers. Each slab is then
+ * voxelized from its bucket alone and handed to callback in the constructVoxelGrid
+ * per-voxel layout (x fastest, then y, then z) before the next one is started, so peak
+ * memory is one slab plus the bucket indices instead of the whole grid.
+ */
+void streamVoxelGrid(float* prims, int primCount, int size, int slabDepth, VoxelSlabCallback callback, void* userData)
+{
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    int* gridSize = props.gridSize;
+    slabDepth = std::max(1, std::min(slabDepth, gridSize[2]));
+    int slabCount = (gridSize[2] + slabDepth - 1) / slabDepth;
+    std::vector<std::vector<int>> buckets(slabCount);
+    for(int i = 0; i < primCount; i++)
+    {
+        const float* tri = prims + i * 9;
+        int zMin = getIndices(Vec3(0, 0, tripleMin(tri[2], tri[5], tri[8])), props.min, props.voxelSize).z;
+        int zMax = getIndices(Vec3(0, 0, tripleMax(tri[2], tri[5], tri[8])), props.min, props.voxelSize).z;
+        zMin = std::max(zMin, 0);
+        zMax = std::min(zMax, gridSize[2] - 1);
+        for(int slab = zMin / slabDepth; slab <= zMax / slabDepth; slab++)
+        {
+            buckets[slab].push_back(i);
+        }
+    }
+
+    size_t slabVoxelCount = (size_t)gridSize[0] * gridSize[1] * slabDepth;
+    Voxel* slabGrid = new Voxel[slabVoxelCount];
+    float* slabData = new float[slabVoxelCount * 4];
+    for(int slab = 0; slab < slabCount; slab++)
+    {
+        int zStart = slab * slabDepth;
+        int zCount = std::min(slabDepth, gridSize[2] - zStart);
+        GridProperties slabProps = props;
+        slabProps.gridSize[2] = zCount;
+        std::fill(slabGrid, slabGrid + slabVoxelCount, Voxel());
+        VoxelRange window = fullVoxelRange(props);
+        window.min[2] = zStart;
+        window.max[2] = zStart + zCount - 1;
+        for(int triIndex : buckets[slab])
+        {
+            const float* tri = prims + triIndex * 9;
+            Vec3 p1(tri[0], tri[1], tri[2]);
+            Vec3 p2(tri[3], tri[4], tri[5]);
+            Vec3 p3(tri[6], tri[7], tri[8]);
+            Vec3 normal = (p3 - p1).cross(p2 - p1).normalized();
+            forEachOverlappedVoxel(props, tri, window, [&](int x, int y, int z)
+            {
+                Voxel& vx = slabGrid[((size_t)x * gridSize[1] + y) * zCount + (z - zStart)];
+                vx.childCount++;
+                vx.normalSum.add(normal);
+            });
+        }
+        std::vector<int>().swap(buckets[slab]);
+        writeVoxelGridNormals(slabData, slabGrid, slabProps);
+        callback(zStart, zCount, slabData, userData);
+    }
+    delete[] slabGrid;
+    delete[] slabData;
+}
+
+struct SlabFileWriter
+{
+    FILE* file;
+    int floatsPerLayer;
+    bool failed;
+};
+
+void writeSlabToFile(int, int zCount, float* slabData, void* userData)
+{
+    SlabFileWriter* writer = (SlabFileWriter*)userData;
+    if(writer->failed) return;
+    size_t count = (size_t)zCount * writer->floatsPerLayer;
+    writer->failed = fwrite(slabData, sizeof(float), count, writer->file) != count;
+}
+
+/**
+ * Streams the voxel grid into a file with the same contents as the constructVoxelGrid
+ * result: the 7 float header followed by the voxels. Returns 0 on success, -1 if the file
+ * could not be written. Native builds only: in wasm, fopen writes to Emscripten's default
+ * in-memory file system, where the file would neither leave the heap nor be reachable from
+ * JS, so emscriptencommand.txt does not export it.
+ */
+int streamVoxelGridToFile(float* prims, int primCount, int size, int slabDepth, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == nullptr) return -1;
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    float header[7];
+    writeVoxelGridHeader(header, props);
+    SlabFileWriter writer = {file, props.gridSize[0] * props.gridSize[1] * 4, false};
+    writer.failed = fwrite(header, sizeof(float), 7, file) != 7;
+    if(!writer.failed)
+    {
+        streamVoxelGrid(prims, primCount, size, slabDepth, writeSlabToFile, &writer);
+    }
+    bool closed = fclose(file) == 0;
+    return (writer.failed || !closed) ? -1 : 0;
+}
+
+/**
+ * Same header as constructVoxelGrid, followed by the level count and, per level, its size
+ * (3 ints) and the float offset of its data from the start of the result. Every level stores
+ * 4 floats per voxel, x fastest: the coverage-weighted average normal and the coverage, the
+ * fraction of level 0 voxels below it that are filled. A voxel is occupied when its coverage
+ * is above 0. Level l has voxel size voxelSize * 2^l; maxLevels <= 0 builds the full chain
+ * down to a single voxel.
+ */
+float* constructVoxelGridMips(float* prims, int primCount, int size, int maxLevels)
+{
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    Voxel* grid = initGrid(prims, primCount, props);
+    std::vector<std::array<int, 3>> levelSizes;
+    std::array<int, 3> levelSize = {props.gridSize[0], props.gridSize[1], props.gridSize[2]};
+    levelSizes.push_back(levelSize);
+    while((maxLevels <= 0 || (int)levelSizes.size() < maxLevels) && (levelSize[0] > 1 || levelSize[1] > 1 || levelSize[2] > 1))
+    {
+        for(int i = 0; i < 3; i++) levelSize[i] = (levelSize[i] + 1) / 2;
+        levelSizes.push_back(levelSize);
+    }
+    int levelCount = (int)levelSizes.size();
+    std::vector<int> levelOffsets(levelCount);
+    int totalSize = 8 + levelCount * 4;
+    for(int l = 0; l < levelCount; l++)
+    {
+        levelOffsets[l] = totalSize;
+        totalSize += levelSizes[l][0] * levelSizes[l][1] * levelSizes[l][2] * 4;
+    }
+    float* result = new float[totalSize];
+    writeVoxelGridHeader(result, props);
+    memcpy(result + 7, &levelCount, sizeof(int));
+    for(int l = 0; l < levelCount; l++)
+    {
+        memcpy(result + 8 + l * 4, levelSizes[l].data(), 3 * sizeof(int));
+        memcpy(result + 8 + l * 4 + 3, &levelOffsets[l], sizeof(int));
+    }
+
+    int* gridSize = props.gridSize;
+    float* base = result + levelOffsets[0];
+    for(int z = 0; z < gridSize[2]; z++)
+    {
+        for(int y = 0; y < gridSize[1]; y++)
+        {
+            for(int x = 0; x < gridSize[0]; x++)
+            {
+                Voxel vx = grid[x * gridSize[1] * gridSize[2] + y * gridSize[2] + z];
+                float* out = base + (z * gridSize[0] * gridSize[1] + y * gridSize[0] + x) * 4;
+                Vec3 avgNormal = vx.childCount > 0 ? vx.normalSum / (float)vx.childCount : vx.normalSum;
+                out[0] = avgNormal.x;
+                out[1] = avgNormal.y;
+                out[2] = avgNormal.z;
+                out[3] = vx.childCount > 0 ? 1.f : 0.f;
+            }
+        }
+    }
+    delete[] grid;
+
+    for(int l = 1; l < levelCount; l++)
+    {
+        std::array<int, 3> fine = levelSizes[l - 1];
+        std::array<int, 3> coarse = levelSizes[l];
+        float* fineData = result + levelOffsets[l - 1];
+        float* coarseData = result + levelOffsets[l];
+        parallelFor(0, coarse[2], [&](int z)
+        {
+            for(int y = 0; y < coarse[1]; y++)
+            {
+                for(int x = 0; x < coarse[0]; x++)
+                {
+                    Vec3 weightedNormal;
+                    float coverageSum = 0;
+                    for(int c = 0; c < 8; c++)
+                    {
+                        int fx = x * 2 + (c & 1);
+                        int fy = y * 2 + ((c >> 1) & 1);
+                        int fz = z * 2 + ((c >> 2) & 1);
+                        if(fx >= fine[0] || fy >= fine[1] || fz >= fine[2]) continue;
+                        float* child = fineData + (fz * fine[0] * fine[1] + fy * fine[0] + fx) * 4;
+                        weightedNormal.add(Vec3(child[0], child[1], child[2]) * child[3]);
+                        coverageSum += child[3];
+                    }
+                    float* out = coarseData + (z * coarse[0] * coarse[1] + y * coarse[0] + x) * 4;
+                    Vec3 avgNormal = coverageSum > 0 ? weightedNormal / coverageSum : weightedNormal;
+                    out[0] = avgNormal.x;
+                    out[1] = avgNormal.y;
+                    out[2] = avgNormal.z;
+                    out[3] = coverageSum / 8.f;
+                }
+            }
+        });
+    }
+    return result;
+}
+
+/**
+ * Picks the mip level whose voxels match the footprint of a ray cone: a ray that has
+ * travelled distance with a spread of pixelAngle radians per pixel covers about
+ * distance * pixelAngle, and level l has voxels of size voxelSize * 2^l.
+ */
+int selectVoxelMipLevel(float distance, float pixelAngle, float voxelSize, int levelCount)
+{
+    float footprint = distance * pixelAngle;
+    if(footprint <= voxelSize || levelCount <= 1) return 0;
+    int level = (int)std::floor(std::log2(footprint / voxelSize));
+    return level < levelCount - 1 ? level : levelCount - 1;
+}
+
+struct VoxelGridHandle
+{
+    GridProperties props;
+    Voxel* grid;
+    std::vector<float> triangles;
+    std::vector<unsigned char> alive;
+};
+
+/**
+ * Voxelizes the mesh like constructVoxelGrid but keeps the grid and a copy of the
+ * triangles alive, so later edits can be applied with updateVoxelGridRegion. The grid
+ * bounds are fixed at creation; geometry moved outside of them is clipped.
+ */
+VoxelGridHandle* createVoxelGridHandle(float* prims, int primCount, int size)
+{
+    VoxelGridHandle* handle = new VoxelGridHandle();
+    handle->props = computeGridProperties(prims, primCount, size);
+    handle->grid = initGrid(prims, primCount, handle->props);
+    handle->triangles.assign(prims, prims + primCount * 9);
+    handle->alive.assign(primCount, 1);
+    return handle;
+}
+
+// Returns the whole grid in the constructVoxelGrid layout.
+float* getVoxelGridHandleData(VoxelGridHandle* handle)
+{
+    GridProperties props = handle->props;
+    int totalGridSize = props.gridSize[0] * props.gridSize[1] * props.gridSize[2];
+    float* result = new float[(totalGridSize * 4) + 7];
+    int offset = writeVoxelGridHeader(result, props);
+    writeVoxelGridNormals(result + offset, handle->grid, props);
+    return result;
+}
+
+/**
+ * Replaces the triangles at changedIndices with changedTriangles (9 floats each; an index
+ * past the current triangle count appends) and removes the triangles at removedIndices.
+ * Only the contributions of those triangles are subtracted from and added to the grid.
+ * Returns the dirty voxel range as 6 ints (min xyz, max xyz, inclusive; min > max if
+ * nothing changed) followed by the voxels of that range in the constructVoxelGrid
+ * per-voxel layout, x fastest, ready to be uploaded as a sub-box.
+ */
+float* updateVoxelGridRegion(VoxelGridHandle* handle, int* changedIndices, float* changedTriangles, int changedCount, int* removedIndices, int removedCount)
+{
+    VoxelRange dirty = emptyVoxelRange();
+    for(int i = 0; i < removedCount; i++)
+    {
+        int index = removedIndices[i];
+        if(index < 0 || index >= (int)handle->alive.size() || !handle->alive[index]) continue;
+        dirty.unionWith(addTriangleToGrid(handle->grid, handle->props, handle->triangles.data() + index * 9, -1));
+        handle->alive[index] = 0;
+    }
+    for(int i = 0; i < changedCount; i++)
+    {
+        int index = changedIndices[i];
+        if(index < 0) continue;
+        if(index >= (int)handle->alive.size())
+        {
+            handle->alive.resize(index + 1, 0);
+            handle->triangles.resize((index + 1) * 9, 0.f);
+        }
+        float* tri = handle->triangles.data() + index * 9;
+        if(handle->alive[index])
+        {
+            dirty.unionWith(addTriangleToGrid(handle->grid, handle->props, tri, -1));
+        }
+        memcpy(tri, changedTriangles + i * 9, 9 * sizeof(float));
+        dirty.unionWith(addTriangleToGrid(handle->grid, handle->props, tri, 1));
+        handle->alive[index] = 1;
+    }
+    int dirtyCount = 0;
+    if(!dirty.isEmpty())
+    {
+        dirtyCount = (dirty.max[0] - dirty.min[0] + 1) * (dirty.max[1] - dirty.min[1] + 1) * (dirty.max[2] - dirty.min[2] + 1);
+    }
+    float* result = new float[dirtyCount * 4 + 6];
+    memcpy(result, dirty.min, 3 * sizeof(int));
+    memcpy(result + 3, dirty.max, 3 * sizeof(int));
+    if(dirtyCount > 0)
+    {
+        writeVoxelRangeNormals(result + 6, handle->grid, handle->props, dirty);
+    }
+    return result;
+}
+
+void destroyVoxelGridHandle(VoxelGridHandle* handle)
+{
+    delete[] handle->grid;
+    delete handle;
+}
+
+float* constructSVO(float* prims, int primCount, int depth, int contouringMethod)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod);
+    return encodeSVOWithProperties(levels, props);
+}
+
+/**
+ * constructSVO followed by simplifySVOLevels. maxNormalAngle is in radians and
+ * maxGeometricError in world units; targetNodeCount <= 0 uses the budgets as hard limits.
+ * The number of removed nodes is written to removedNodeCount.
+ */
+float* constructSimplifiedSVO(float* prims, int primCount, int depth, int contouringMethod, float maxNormalAngle, float maxGeometricError, int targetNodeCount, int* removedNodeCount)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod);
+    SVOSimplifyOptions options = {maxNormalAngle, maxGeometricError, targetNodeCount};
+    *removedNodeCount = simplifySVOLevels(levels, props, contouringMethod, options);
+    return encodeSVOWithProperties(levels, props);
+}
+
+/**
+ * Builds the octree like constructSVO and merges its identical subtrees into a sparse
+ * voxel DAG (see svodag.h). Layout: min, max, size, depth, node word count, attribute
+ * count and attribute format (OctahedralNormal, or CubeRelativeVertex for dual
+ * contouring), followed by the node words and one attribute word per leaf.
+ */
+float* constructSVODAG(float* prims, int primCount, int depth, int contouringMethod)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod);
+    int attributeFormat = contouringMethod == DualContouring ? CubeRelativeVertex : OctahedralNormal;
+    SVODAG dag = buildSVODAG(levels, attributeFormat, props.min, props.voxelSize);
+    int offset = 11;
+    int nodeWordCount = (int)dag.nodes.size();
+    int attributeCount = (int)dag.attributes.size();
+    float* result = new float[offset + nodeWordCount + attributeCount];
+    result[0] = props.min.x;
+    result[1] = props.min.y;
+    result[2] = props.min.z;
+    for(int i = 0; i < 3; i++) result[3 + i] = props.min[i] + props.voxelSize * props.gridSize[0];
+    memcpy(result + 6, &props.gridSize[0], sizeof(int));
+    memcpy(result + 7, &depth, sizeof(int));
+    memcpy(result + 8, &nodeWordCount, sizeof(int));
+    memcpy(result + 9, &attributeCount, sizeof(int));
+    memcpy(result + 10, &attributeFormat, sizeof(int));
+    memcpy(result + offset, dag.nodes.data(), nodeWordCount * sizeof(uint32_t));
+    memcpy(result + offset + nodeWordCount, dag.attributes.data(), attributeCount * sizeof(uint32_t));
+    return result;
+}
+
+/**
+ * Builds the octree like constructSVO and writes it as split topology and attribute
+ * streams (see encodeSVOStreams). Layout: min, max, size, depth, entry count, attribute
+ * count and attribute format (OctahedralNormal, or CubeRelativeVertex for dual
+ * contouring), followed by the topology words and the attribute words.
+ */
+float* constructSVOStreams(float* prims, int primCount, int depth, int contouringMethod, int includeInteriorAttributes)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod);
+    int attributeFormat = contouringMethod == DualContouring ? CubeRelativeVertex : OctahedralNormal;
+    SVOStreams streams;
+    if(!encodeSVOStreams(levels, props, attributeFormat, includeInteriorAttributes != 0, &streams)) return nullptr;
+    int offset = 11;
+    int entryCount = (int)streams.topology.size();
+    int attributeCount = (int)streams.attributes.size();
+    float* result = new (std::nothrow) float[(size_t)offset + entryCount + attributeCount];
+    if(result == nullptr)
+    {
+        fprintf(stderr, "constructSVOStreams: out of memory for %d entries\n", entryCount);
+        return nullptr;
+    }
+    result[0] = props.min.x;
+    result[1] = props.min.y;
+    result[2] = props.min.z;
+    for(int i = 0; i < 3; i++) result[3 + i] = props.min[i] + props.voxelSize * props.gridSize[0];
+    memcpy(result + 6, &props.gridSize[0], sizeof(int));
+    memcpy(result + 7, &depth, sizeof(int));
+    memcpy(result + 8, &entryCount, sizeof(int));
+    memcpy(result + 9, &attributeCount, sizeof(int));
+    memcpy(result + 10, &attributeFormat, sizeof(int));
+    memcpy(result + offset, streams.topology.data(), (size_t)entryCount * sizeof(uint32_t));
+    memcpy(result + offset + entryCount, streams.attributes.data(), (size_t)attributeCount * sizeof(uint32_t));
+    return result;
+}
+
+/**
+ * Starts building an octree of the given depth top-down and returns once levels
+ * 0..firstDepth exist, so a coarse tree can be rendered right away. The triangles are
+ * copied. refineProgressiveSVOLevel calls add the levels below, getProgressiveSVO returns
+ * the tree built so far.
+ */
+ProgressiveSVOHandle* createProgressiveSVO(float* prims, int primCount, int depth, int firstDepth, int contouringMethod)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    ProgressiveSVOHandle* handle = new ProgressiveSVOHandle();
+    handle->props = computeSVOProperties(prims, primCount, depth);
+    handle->depth = depth;
+    handle->contouringMethod = contouringMethod;
+    handle->hasStaleLeaves = false;
+    handle->triangles.assign(prims, prims + primCount * 9);
+    seedProgressiveSVO(handle, std::max(0, std::min(firstDepth, depth)));
+    return handle;
+}
+
+/**
+ * Does up to maxNodes nodes of work on the next level, or all of it when maxNodes <= 0, so
+ * a caller on the main thread can yield between calls. Returns the depth of the tree built
+ * so far, which grows by one once a level is complete.
+ */
+int refineProgressiveSVOLevel(ProgressiveSVOHandle* handle, int maxNodes)
+{
+    if(handle->level < handle->depth) refineProgressiveSVO(handle, maxNodes);
+    return handle->level;
+}
+
+/**
+ * The tree built so far in the constructSVO layout. Its leaves are the deepest level and
+ * its interior nodes hold the average of their children. A level read right after the one
+ * above it is appended to the previous result (see appendProgressiveSVOLevel), so reading
+ * every level costs about as much as one constructSVO encoding. Nodes that got no children
+ * stay coarse leaves until the full depth, where the result equals constructSVO's.
+ */
+float* getProgressiveSVO(ProgressiveSVOHandle* handle)
+{
+    if(!appendProgressiveSVOLevel(handle) && !encodeProgressiveSVO(handle)) return nullptr;
+    float* result = new (std::nothrow) float[handle->encoded.size()];
+    if(result == nullptr)
+    {
+        fprintf(stderr, "getProgressiveSVO: out of memory for %lld entries\n", (long long)handle->layout.entryCount);
+        return nullptr;
+    }
+    memcpy(result, handle->encoded.data(), handle->encoded.size() * sizeof(float));
+    return result;
+}
+
+void destroyProgressiveSVO(ProgressiveSVOHandle* handle)
+{
+    delete handle;
+}
+
+/**
+ * Builds the octree like constructSVO and keeps it for editing with insertSVOVoxels,
+ * removeSVOVoxels and setSVONormals. The bounds are fixed at creation.
+ */
+DynamicSVOHandle* createDynamicSVO(float* prims, int primCount, int depth, int contouringMethod)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    Vec3 max = props.min;
+    max.add(props.voxelSize * props.gridSize[0]);
+    DynamicSVOHandle* handle = new DynamicSVOHandle{props, EditableSVO(props.min, max, depth)};
+    handle->svo.build(buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod));
+    return handle;
+}
+
+/**
+ * The whole encoding in the constructSVO layout. Its entry count includes the slack of the
+ * blocks and the released blocks, which are never reached from the root.
+ */
+float* getDynamicSVO(DynamicSVOHandle* handle)
+{
+    const std::vector<float>& data = handle->svo.data;
+    float* result = new float[data.size()];
+    memcpy(result, data.data(), data.size() * sizeof(float));
+    return result;
+}
+
+/**
+ * Sets the leaves at voxels (three coordinates each) to normals (three floats each),
+ * creating them and their missing ancestors. Coordinates outside the grid are skipped.
+ * Returns the rewritten ranges (see updateDynamicSVO), or nullptr when the edits could
+ * exceed the encoding.
+ */
+float* insertSVOVoxels(DynamicSVOHandle* handle, int* voxels, float* normals, int count)
+{
+    if(!validateSVOEditCount(handle, count, "insertSVOVoxels")) return nullptr;
+    std::vector<uint32_t> edited;
+    for(int i = 0; i < count; i++)
+    {
+        const int* voxel = voxels + i * 3;
+        if(!validSVOVoxel(handle, voxel)) continue;
+        handle->svo.tree.insertVoxel(voxel[0], voxel[1], voxel[2], Vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]));
+        edited.insert(edited.end(), voxel, voxel + 3);
+    }
+    return updateDynamicSVO(handle, edited);
+}
+
+/**
+ * Removes the leaves at voxels along with the ancestors left empty. Missing leaves are
+ * skipped. Returns the rewritten ranges (see updateDynamicSVO).
+ */
+float* removeSVOVoxels(DynamicSVOHandle* handle, int* voxels, int count)
+{
+    std::vector<uint32_t> edited;
+    std::vector<uint32_t> released;
+    for(int i = 0; i < count; i++)
+    {
+        const int* voxel = voxels + i * 3;
+        if(!validSVOVoxel(handle, voxel)) continue;
+        released.clear();
+        if(!handle->svo.tree.removeVoxel(voxel[0], voxel[1], voxel[2], &released)) continue;
+        for(uint32_t node : released) handle->svo.releaseBlock(node);
+        edited.insert(edited.end(), voxel, voxel + 3);
+    }
+    return updateDynamicSVO(handle, edited);
+}
+
+/**
+ * Replaces the normals (the vertices with dual contouring) of existing leaves. Missing
+ * leaves are skipped. Returns the rewritten ranges (see updateDynamicSVO).
+ */
+float* setSVONormals(DynamicSVOHandle* handle, int* voxels, float* normals, int count)
+{
+    std::vector<uint32_t> edited;
+    for(int i = 0; i < count; i++)
+    {
+        const int* voxel = voxels + i * 3;
+        uint32_t leaf;
+        if(!validSVOVoxel(handle, voxel) || !handle->svo.tree.findVoxel(voxel[0], voxel[1], voxel[2], &leaf)) continue;
+        handle->svo.tree.nodes[leaf].normal = Vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+        edited.insert(edited.end(), voxel, voxel + 3);
+    }
+    return updateDynamicSVO(handle, edited);
+}
+
+void destroyDynamicSVO(DynamicSVOHandle* handle)
+{
+    delete handle;
+}
+
+/**
+ * Builds an octree of the given depth for rendering out of core: the subtrees below
+ * cutLevel become pages written to the file at pagePath, and only the top tree and at most
+ * cachePageCount pages are kept in memory. Returns nullptr with a message on stderr when
+ * the levels are out of range or the page file cannot be written. The page file only
+ * leaves memory in native builds: the wasm builds of emscriptencommand.txt mount no file
+ * system, so pagePath lands in Emscripten's in-memory MEMFS and the pages stay on the JS
+ * heap. There the cache bounds what the encoder and traversal hold, not the total.
+ */
+PagedSVOHandle* createPagedSVO(float* prims, int primCount, int depth, int cutLevel, int contouringMethod, const char* pagePath, int cachePageCount)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    if(cutLevel < 1 || cutLevel >= depth || cutLevel > SVO_MAX_PAGE_CUT_LEVEL)
+    {
+        fprintf(stderr, "createPagedSVO: cut level %d is outside the supported range 1..%d\n", cutLevel, std::min(depth - 1, SVO_MAX_PAGE_CUT_LEVEL));
+        return nullptr;
+    }
+    FILE* file = fopen(pagePath, "w+b");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "createPagedSVO: cannot open page file %s\n", pagePath);
+        return nullptr;
+    }
+    PagedSVOHandle* handle = new PagedSVOHandle();
+    handle->props = computeSVOProperties(prims, primCount, depth);
+    handle->depth = depth;
+    handle->cutLevel = cutLevel;
+    handle->attributeFormat = contouringMethod == DualContouring ? CubeRelativeVertex : OctahedralNormal;
+    handle->maxPageWordCount = 0;
+    handle->cache.file = file;
+    handle->cache.capacity = std::max(1, cachePageCount);
+    SVOLevel cut;
+    bool built = writeSVOPages(prims, primCount, contouringMethod, handle, &cut);
+    if(built)
+    {
+        GridProperties topProps = handle->props;
+        topProps.voxelSize *= (float)(1u << (depth - cutLevel));
+        built = encodeSVOStreams(buildSVOLevels(std::move(cut), cutLevel), topProps, handle->attributeFormat, false, &handle->top);
+    }
+    if(!built)
+    {
+        fclose(file);
+        delete handle;
+        return nullptr;
+    }
+    return handle;
+}
+
+/**
+ * The resident part of a paged octree. Layout: min, max, size, depth, cut level, page
+ * count, the largest page's word count (a slot size that fits every page), entry count,
+ * attribute count and attribute format, followed by the top tree's topology and attribute
+ * words.
+ */
+float* getPagedSVOTopTree(PagedSVOHandle* handle)
+{
+    GridProperties props = handle->props;
+    int offset = 14;
+    int entryCount = (int)handle->top.topology.size();
+    int attributeCount = (int)handle->top.attributes.size();
+    int pageCount = (int)handle->cache.pages.size();
+    float* result = new float[offset + entryCount + attributeCount];
+    result[0] = props.min.x;
+    result[1] = props.min.y;
+    result[2] = props.min.z;
+    for(int i = 0; i < 3; i++) result[3 + i] = props.min[i] + props.voxelSize * props.gridSize[0];
+    memcpy(result + 6, &props.gridSize[0], sizeof(int));
+    memcpy(result + 7, &handle->depth, sizeof(int));
+    memcpy(result + 8, &handle->cutLevel, sizeof(int));
+    memcpy(result + 9, &pageCount, sizeof(int));
+    memcpy(result + 10, &handle->maxPageWordCount, sizeof(uint32_t));
+    memcpy(result + 11, &entryCount, sizeof(int));
+    memcpy(result + 12, &attributeCount, sizeof(int));
+    memcpy(result + 13, &handle->attributeFormat, sizeof(int));
+    memcpy(result + offset, handle->top.topology.data(), entryCount * sizeof(uint32_t));
+    memcpy(result + offset + entryCount, handle->top.attributes.data(), attributeCount * sizeof(uint32_t));
+    return result;
+}
+
+/**
+ * Page request feedback: pageIds lists the pages the renderer needed, most important
+ * first. Requested pages count as used, missing ones are read into the cache and the least
+ * recently used pages not requested are evicted for them. Requests beyond the cache
+ * capacity, duplicates and invalid ids are skipped. The result holds the loaded, evicted
+ * and skipped counts, the evicted page ids, then per loaded page its id followed by its
+ * words in the svopages.h layout.
+ */
+float* requestSVOPages(PagedSVOHandle* handle, int* pageIds, int count)
+{
+    SVOPageCache& cache = handle->cache;
+    std::vector<int> requested;
+    std::vector<uint8_t> seen(cache.pages.size(), 0);
+    int skippedCount = 0;
+    for(int i = 0; i < count; i++)
+    {
+        int id = pageIds[i];
+        if(id < 0 || id >= (int)cache.pages.size() || seen[id] || (int)requested.size() >= cache.capacity)
+        {
+            skippedCount++;
+            continue;
+        }
+        seen[id] = 1;
+        requested.push_back(id);
+    }
+    for(int id : requested) cache.touch(id);
+    std::vector<int> evicted;
+    std::vector<std::pair<int, const std::vector<uint32_t>*>> loaded;
+    size_t wordCount = 3;
+    for(int id : requested)
+    {
+        if(cache.isResident(id)) continue;
+        const std::vector<uint32_t>* words = cache.load(id, &evicted);
+        if(words == nullptr)
+        {
+            skippedCount++;
+            continue;
+        }
+        loaded.push_back({id, words});
+        wordCount += 1 + words->size();
+    }
+    wordCount += evicted.size();
+    float* result = new float[wordCount];
+    int header[3] = {(int)loaded.size(), (int)evicted.size(), skippedCount};
+    memcpy(result, header, sizeof(header));
+    float* out = result + 3;
+    memcpy(out, evicted.data(), evicted.size() * sizeof(int));
+    out += evicted.size();
+    for(auto& page : loaded)
+    {
+        memcpy(out, &page.first, sizeof(int));
+        memcpy(out + 1, page.second->data(), page.second->size() * sizeof(uint32_t));
+        out += 1 + page.second->size();
+    }
+    return result;
+}
+
+// Closes the page file; the file itself is left for the caller to remove.
+void destroyPagedSVO(PagedSVOHandle* handle)
+{
+    fclose(handle->cache.file);
+    delete handle;
+}
+
+/**
+ * Casts rays against a constructSVO (or constructSimplifiedSVO) result with SVOTraversal.
+ * rays holds origin and direction per ray; the result holds the hit distance (-1 on a
+ * miss), the leaf's entry index as an int (-1 on a miss) and its normal per ray. When
+ * fetchStats is not null it receives the average number of entry reads per ray, the
+ * average distance in entries between consecutive reads and the fraction of reads within
+ * SVO_NEAR_FETCH_DISTANCE of the previous one.
+ */
+float* castRaysSVO(float* svo, float* rays, int rayCount, float* fetchStats)
+{
+    SVOTraversal traversal;
+    traversal.entries = svo + 8;
+    traversal.min = Vec3(svo[0], svo[1], svo[2]);
+    traversal.size = svo[3] - svo[0];
+    return castRaysWithTraversal(traversal, traversal, rays, rayCount, fetchStats, 3);
+}
+
+/**
+ * castRaysSVO against a constructSVOWithRopes result with the stackless SVORopeTraversal.
+ * fetchStats receives the three castRaysSVO read statistics and the average number of
+ * rope words read per ray.
+ */
+float* castRaysSVORopes(float* svo, float* rays, int rayCount, float* fetchStats)
+{
+    SVORopeTraversal traversal;
+    traversal.nodes.entries = svo + 8;
+    traversal.nodes.min = Vec3(svo[0], svo[1], svo[2]);
+    traversal.nodes.size = svo[3] - svo[0];
+    int size, entryCount;
+    memcpy(&size, svo + 6, sizeof(int));
+    memcpy(&entryCount, svo + 7, sizeof(int));
+    traversal.depth = __builtin_ctz((unsigned int)size);
+    uint32_t* ropes = (uint32_t*)(svo + 8 + (size_t)entryCount * 4);
+    traversal.ropes = ropes;
+    return castRaysWithTraversal(traversal, traversal.nodes, rays, rayCount, fetchStats, 4);
+}
+
+#define SVO_LAYOUT_PROBE_RAYS 4096
+
+/**
+ * constructSVO with the entries in the given SVONodeLayout; topLevels and blockSize (in
+ * entries) configure SubtreeBlockLayout. A fixed set of probe rays, aimed from around
+ * the bounds at its central half, is cast through the result and fetchStats receives the
+ * three castRaysSVO read statistics.
+ */
+float* constructSVOWithLayout(float* prims, int primCount, int depth, int contouringMethod, int layout, int topLevels, int blockSize, float* fetchStats)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod);
+    SVOLayoutOptions options = {layout, topLevels, blockSize};
+    float* result = encodeSVOWithProperties(levels, props, options);
+    if(result == nullptr) return nullptr;
+
+    float size = result[3] - result[0];
+    Vec3 center = props.min;
+    center.add(size / 2);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<float> rays(SVO_LAYOUT_PROBE_RAYS * 6);
+    for(int r = 0; r < SVO_LAYOUT_PROBE_RAYS; r++)
+    {
+        Vec3 onSphere;
+        do
+        {
+            onSphere = Vec3(uniform(rng), uniform(rng), uniform(rng));
+        }
+        while(onSphere.length() > 1.f || onSphere.length() < 0.01f);
+        Vec3 origin = center + onSphere.normalized() * size;
+        Vec3 target = center + Vec3(uniform(rng), uniform(rng), uniform(rng)) * (size / 4);
+        Vec3 direction = (target - origin).normalized();
+        float* ray = rays.data() + r * 6;
+        ray[0] = origin.x;
+        ray[1] = origin.y;
+        ray[2] = origin.z;
+        ray[3] = direction.x;
+        ray[4] = direction.y;
+        ray[5] = direction.z;
+    }
+    delete[] castRaysSVO(result, rays.data(), SVO_LAYOUT_PROBE_RAYS, fetchStats);
+    return result;
+}
+
+/**
+ * constructSVO followed by the neighbor ropes of every entry (see computeSVORopes): six
+ * words per entry after the entries, read by castRaysSVORopes.
+ */
+float* constructSVOWithRopes(float* prims, int primCount, int depth, int contouringMethod)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, contouringMethod);
+    std::vector<uint32_t> ropes;
+    if(!computeSVORopes(levels, computeSVOLayout(levels), &ropes)) return nullptr;
+    float* svo = encodeSVOWithProperties(levels, props);
+    if(svo == nullptr) return nullptr;
+    size_t entryFloats = 8 + ropes.size() / 6 * 4;
+    float* result = new (std::nothrow) float[entryFloats + ropes.size()];
+    if(result == nullptr)
+    {
+        fprintf(stderr, "constructSVOWithRopes: out of memory for %zu ropes\n", ropes.size());
+        delete[] svo;
+        return nullptr;
+    }
+    memcpy(result, svo, entryFloats * sizeof(float));
+    memcpy(result + entryFloats, ropes.data(), ropes.size() * sizeof(uint32_t));
+    delete[] svo;
+    return result;
+}
+
+/**
+ * constructSVO with average normals whose leaves also reference the triangles overlapping
+ * them (see encodeHybridSVO), so rays can skip empty space in the octree and still
+ * intersect the mesh exactly with castRaysSVOHybrid.
+ */
+float* constructHybridSVO(float* prims, int primCount, int depth)
+{
+    if(!validateSVODepth(depth)) return nullptr;
+    GridProperties props = computeSVOProperties(prims, primCount, depth);
+    SVOTriangleLists leafTriangles;
+    std::vector<SVOLevel> levels = buildSVOLevelsParallel(prims, primCount, props, depth, AverageNormals, &leafTriangles);
+    return encodeHybridSVO(levels, props, leafTriangles);
+}
+
+// Fraction of a leaf by which a triangle hit may lie outside the leaf's span of t.
+#define SVO_HYBRID_SPAN_TOLERANCE 0.01f
+
+/**
+ * Casts rays against a constructHybridSVO result and the triangles prims it was built
+ * from. The octree traversal stops at the first leaf that holds a triangle hit inside the
+ * leaf's cube, so the result is the nearest triangle hit. Per ray it holds the hit
+ * distance (-1 on a miss), the triangle index as an int (-1 on a miss) and the triangle's
+ * normal. When fetchStats is not null it receives the average entry reads and the average
+ * ray-triangle tests per ray.
+ */
+float* castRaysSVOHybrid(float* svo, float* prims, float* rays, int rayCount, float* fetchStats)
+{
+    SVOTraversal traversal;
+    traversal.entries = svo + 8;
+    traversal.min = Vec3(svo[0], svo[1], svo[2]);
+    traversal.size = svo[3] - svo[0];
+    int size, entryCount;
+    memcpy(&size, svo + 6, sizeof(int));
+    memcpy(&entryCount, svo + 7, sizeof(int));
+    const int* triangleIndices = (const int*)(svo + 8 + (size_t)entryCount * 4 + 1);
+    float leafSize = traversal.size / (float)size;
+    float* result = new float[rayCount * 5];
+    std::vector<SVOTraversalStats> rayStats(rayCount, SVOTraversalStats{0, 0, 0, 0});
+    std::vector<int64_t> triangleTests(rayCount, 0);
+    parallelFor(0, rayCount, [&](int r)
+    {
+        const float* ray = rays + r * 6;
+        Vec3 origin(ray[0], ray[1], ray[2]);
+        Vec3 direction(ray[3], ray[4], ray[5]);
+        float tolerance = SVO_HYBRID_SPAN_TOLERANCE * leafSize / direction.length();
+        int hitTriangle = -1;
+        Vec3 hitNormal;
+        SVOHit hit = traversal.castRayFiltered(origin, direction, INFINITY, fetchStats != nullptr ? &rayStats[r] : nullptr, [&](int64_t node, float tEnter, float tExit, float* t)
+        {
+            uint32_t list[2];
+            memcpy(list, traversal.entries + node * 4 + 1, sizeof(list));
+            float tBest = tExit + tolerance;
+            for(uint32_t i = list[0]; i < list[0] + list[1]; i++)
+            {
+                const float* v = prims + triangleIndices[i] * 9;
+                Triangle triangle = {Vec3(v[0], v[1], v[2]), Vec3(v[3], v[4], v[5]), Vec3(v[6], v[7], v[8])};
+                Intersection candidate = triangle.intersectRay(origin, direction, std::fmax(0.f, tEnter - tolerance), tBest);
+                triangleTests[r]++;
+                if(!candidate.hit) continue;
+                tBest = candidate.t;
+                hitTriangle = triangleIndices[i];
+                hitNormal = candidate.normal;
+            }
+            *t = tBest;
+            return hitTriangle >= 0;
+        });
+        if(!hit.hit) hitTriangle = -1;
+        result[r * 5] = hit.hit ? hit.t : -1.f;
+        memcpy(result + r * 5 + 1, &hitTriangle, sizeof(int));
+        result[r * 5 + 2] = hitNormal.x;
+        result[r * 5 + 3] = hitNormal.y;
+        result[r * 5 + 4] = hitNormal.z;
+    }, 64);
+    if(fetchStats != nullptr)
+    {
+        int64_t fetchCount = 0;
+        int64_t testCount = 0;
+        for(int r = 0; r < rayCount; r++)
+        {
+            fetchCount += rayStats[r].fetchCount;
+            testCount += triangleTests[r];
+        }
+        fetchStats[0] = rayCount > 0 ? (float)fetchCount / rayCount : 0.f;
+        fetchStats[1] = rayCount > 0 ? (float)testCount / rayCount : 0.f;
+    }
+    return result;
+}
+
+/**
+ * Builds a uniform grid of triangle lists over prims for ray casting with
+ * castRaysTriangleGrid. size is the cell count along the longest axis; 0 or less picks it
+ * from the triangle count (see triangleGridSize). The result is the writeVoxelGridHeader
+ * header, gridSize[0] * gridSize[1] * gridSize[2] + 1 cell offsets and the triangle
+ * indices of the cells (see buildTriangleGrid), all as uints.
+ */
+float* constructTriangleGrid(float* prims, int primCount, int size)
+{
+    if(size <= 0) size = triangleGridSize(prims, primCount);
+    if(size < 2)
+    {
+        fprintf(stderr, "constructTriangleGrid: size %d is below 2\n", size);
+        return nullptr;
+    }
+    GridProperties props = computeGridProperties(prims, primCount, size);
+    std::vector<uint32_t> cellStarts;
+    std::vector<uint32_t> triangles;
+    buildTriangleGrid(prims, primCount, props, &cellStarts, &triangles);
+    float* result = new (std::nothrow) float[7 + cellStarts.size() + triangles.size()];
+    if(result == nullptr)
+    {
+        fprintf(stderr, "constructTriangleGrid: out of memory for %zu cells and %zu triangle references\n", cellStarts.size() - 1, triangles.size());
+        return nullptr;
+    }
+    int offset = writeVoxelGridHeader(result, props);
+    memcpy(result + offset, cellStarts.data(), cellStarts.size() * sizeof(uint32_t));
+    memcpy(result + offset + cellStarts.size(), triangles.data(), triangles.size() * sizeof(uint32_t));
+    return result;
+}
+
+/**
+ * Casts rays against a constructTriangleGrid result and the triangles prims it was built
+ * from with TriangleGridTraversal. Per ray the result holds the hit distance (-1 on a
+ * miss), the triangle index as an int (-1 on a miss) and the triangle's normal. When
+ * traversalStats is not null it receives the average cells visited and the average
+ * ray-triangle tests per ray.
+ */
+float* castRaysTriangleGrid(float* grid, float* prims, float* rays, int rayCount, float* traversalStats)
+{
+    TriangleGridTraversal traversal;
+    traversal.min = Vec3(grid[0], grid[1], grid[2]);
+    memcpy(traversal.gridSize, grid + 3, 3 * sizeof(int));
+    traversal.cellSize = grid[6];
+    size_t cellCount = (size_t)traversal.gridSize[0] * traversal.gridSize[1] * traversal.gridSize[2];
+    traversal.cellStarts = (const uint32_t*)(grid + 7);
+    traversal.triangles = traversal.cellStarts + cellCount + 1;
+    traversal.prims = prims;
+    float* result = new float[rayCount * 5];
+    std::vector<TriangleGridStats> rayStats(rayCount, TriangleGridStats{0, 0});
+    parallelFor(0, rayCount, [&](int r)
+    {
+        const float* ray = rays + r * 6;
+        TriangleGridHit hit = traversal.castRay(Vec3(ray[0], ray[1], ray[2]), Vec3(ray[3], ray[4], ray[5]), INFINITY, &rayStats[r]);
+        result[r * 5] = hit.hit ? hit.t : -1.f;
+        memcpy(result + r * 5 + 1, &hit.triangle, sizeof(int));
+        result[r * 5 + 2] = hit.normal.x;
+        result[r * 5 + 3] = hit.normal.y;
+        result[r * 5 + 4] = hit.normal.z;
+    }, 64);
+    if(traversalStats != nullptr)
+    {
+        int64_t cellCount = 0;
+        int64_t testCount = 0;
+        for(const TriangleGridStats& stats : rayStats)
+        {
+            cellCount += stats.cellCount;
+            testCount += stats.triangleTestCount;
+        }
+        traversalStats[0] = rayCount > 0 ? (float)cellCount / rayCount : 0.f;
+        traversalStats[1] = rayCount > 0 ? (float)testCount / rayCount : 0.f;
+    }
+    return result;
+}
+
+/**
+ * Reference ray casts against a constructSVODAG result. rays holds origin and direction
+ * per ray; the result holds the hit distance (-1 on a miss) and the attribute index as an
+ * int per ray.
+ */
+float* castRaysSVODAG(float* dag, float* rays, int rayCount)
+{
+    SVODAGTraversal traversal;
+    traversal.nodes = (const uint32_t*)(dag + 11);
+    memcpy(&traversal.depth, dag + 7, sizeof(int));
+    traversal.min = Vec3(dag[0], dag[1], dag[2]);
+    traversal.size = dag[3] - dag[0];
+    float* result = new float[rayCount * 2];
+    parallelFor(0, rayCount, [&](int r)
+    {
+        const float* ray = rays + r * 6;
+        SVODAGHit hit = traversal.castRay(Vec3(ray[0], ray[1], ray[2]), Vec3(ray[3], ray[4], ray[5]), INFINITY);
+        int attributeIndex = hit.hit ? hit.attributeIndex : -1;
+        result[r * 2] = hit.hit ? hit.t : -1.f;
+        memcpy(result + r * 2 + 1, &attributeIndex, sizeof(int));
+    }, 64);
     return result;
 }
 }
\ No newline at end of file